@@ -1,13 +1,11 @@
 /*
-** This program implements decoding for most variants of the mov instruction
-** and of some arithmetic instructions for the 8086 architecture. All other
- ** instructions are ignored.
-** Malformed instructions (the ones that are missing non-optional bytes) are not
-** handled gracefully.
+** This program disassembles 8086 machine code into NASM-compatible assembly.
+** Decoding is table-driven (see dec8086_decode.c) and covers the whole instruction
+** set. Bytes that don't start a valid instruction are emitted with "db".
+** With -blocks it prints the control-flow graph of the code instead (see dec8086_cfg.h).
 */
 
 #include <assert.h>
-#include <stdarg.h>
 #include <stdlib.h>
 #include <memory.h>
 #include <stdint.h>
@@ -80,555 +78,525 @@ static int digit_count_i8(i8 n) {
 	return count;
 }
 
-static int xor_digits_i32(i32 n) {
-	int result = 0;
-	
-	do {
-		int d = n % 10;
-		n /= 10;
-		
-		result ^= d;
-	} while (n != 0);
-	
-	return result;
-}
-
 //
-// Basic temp storage
+// Output buffer
 //
 
-static u8 *temp_ptr = 0;
-static i64 temp_pos = 0;
-static i64 temp_cap = 0;
+// NOTE(ema): All the text goes through a fixed buffer that is handed to fwrite when it fills up,
+// so the memory used doesn't depend on the size of the binary. Callers reserve room for a whole
+// line up front and then append without further checks.
+typedef struct Output_Buffer Output_Buffer;
+struct Output_Buffer {
+	char *data;
+	int   len;
+	int   cap;
+	FILE *file;
+};
 
-static void temp_init() {
-	temp_cap = 1024 * 1024 * 4;
-	temp_ptr = calloc(1, temp_cap);
-}
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+#define OUTPUT_LINE_MAX    256
 
-static void *temp_push_nozero(i64 size) {
-	void *ptr = 0;
-	
-	if (temp_pos + size < temp_cap) {
-		ptr = temp_ptr + temp_pos;
-		temp_pos += size;
+static void output_flush(Output_Buffer *out) {
+	if (out->len > 0) {
+		fwrite(out->data, 1, out->len, out->file);
+		out->len = 0;
 	}
-	
-	assert(ptr);
-	
-	return ptr;
 }
 
-static void *temp_push(i64 size) {
-	void  *ptr = temp_push_nozero(size);
-	memset(ptr, 0, size);
-	return ptr;
+static void output_reserve(Output_Buffer *out, int size) {
+	assert(size <= out->cap);
+	if (out->len + size > out->cap) {
+		output_flush(out);
+	}
 }
 
-static void temp_reset() { temp_pos = 0; }
-
-//
-// String helpers
-//
+static void output_char(Output_Buffer *out, char c) {
+	assert(out->len < out->cap);
+	out->data[out->len] = c;
+	out->len += 1;
+}
 
-static int antoi(char *str, size_t len) {
-	char *cstr = temp_push(sizeof(char) * (len + 1));
-	memcpy(cstr, str, sizeof(char) * len);
-	cstr[len] = '\0';
-	
-	int i = atoi(cstr);
-	return i;
+static void output_string(Output_Buffer *out, char *s) {
+	int len = (int) strlen(s);
+	assert(out->len + len <= out->cap);
+	memcpy(out->data + out->len, s, len);
+	out->len += len;
 }
 
-static char *asprintf(char *fmt, ...) {
-	va_list args;
-	va_start(args, fmt);
+static void output_unsigned(Output_Buffer *out, u32 value) {
+	char digits[10];
+	int  count = 0;
 	
-	size_t needed = vsnprintf(0, 0, fmt, args) + 1;
-    char  *buffer = malloc(sizeof(char) * needed);
-    vsnprintf(buffer, needed, fmt, args);
-    buffer[needed] = '\0';
+	do {
+		digits[count] = (char)('0' + value % 10);
+		value /= 10;
+		count += 1;
+	} while (value != 0);
 	
-	va_end(args);
-	return buffer;
+	assert(out->len + count <= out->cap);
+	while (count > 0) {
+		count -= 1;
+		out->data[out->len] = digits[count];
+		out->len += 1;
+	}
 }
 
-static char *tsprintf(char *fmt, ...) {
-	va_list args;
-	va_start(args, fmt);
-	
-	size_t needed = vsnprintf(0, 0, fmt, args) + 1;
-    char  *buffer = temp_push(sizeof(char) * needed);
-    vsnprintf(buffer, needed, fmt, args);
-    buffer[needed] = '\0';
-	
-	va_end(args);
-	return buffer;
+static void output_signed(Output_Buffer *out, i32 value) {
+	if (value < 0) {
+		output_char(out, '-');
+		output_unsigned(out, (u32) -(i64) value);
+	} else {
+		output_unsigned(out, (u32) value);
+	}
 }
 
 //
 // Label table
 //
 
-typedef struct Label_Node Label_Node;
-struct Label_Node {
-	Label_Node *next;
-	char *label;
-	int   addr;
-};
-
-typedef struct Label_List Label_List;
-struct Label_List {
-	Label_Node *head;
+// NOTE(ema): Labels are just the sorted, deduplicated list of jump targets; label_N is the
+// N-th target in address order, so no names are stored.
+typedef struct Label_Table Label_Table;
+struct Label_Table {
+	u32 *addresses;
+	int  count;
+	int  cap;
 };
 
-static i8 label_counter = 0;
-static Label_List labels[32];
-
-static char *label_from_absolute_address(int addr, bool create_if_missing) {
-	int hash = xor_digits_i32(addr);
-	int slot = hash % array_count(labels);
-	Label_List *list = &labels[slot];
-	Label_Node *node = list->head;
-	while (node) {
-		if (node->addr == addr)
-			break;
-		node = node->next;
+static bool add_label(Label_Table *labels, u32 address) {
+	bool ok = 1;
+	
+	if (labels->count == labels->cap) {
+		int  new_cap = labels->cap ? labels->cap * 2 : 1024;
+		u32 *new_addresses = realloc(labels->addresses, sizeof(u32) * new_cap);
+		if (new_addresses) {
+			labels->addresses = new_addresses;
+			labels->cap = new_cap;
+		} else {
+			ok = 0;
+		}
 	}
 	
-	char *label = 0;
-	if (!node && create_if_missing) {
-		node = malloc(sizeof(Label_Node));
-		node->label = asprintf("label_%i", label_counter);
-		node->addr  = addr;
-		
-		if (list->head)  node->next = list->head;
-		else             node->next = 0;
-		list->head = node;
-		
-		label_counter += 1;
+	if (ok) {
+		labels->addresses[labels->count] = address;
+		labels->count += 1;
 	}
 	
-	if (node) label = node->label;
+	return ok;
+}
+
+static int compare_addresses(const void *a, const void *b) {
+	u32 x = *(u32 *) a;
+	u32 y = *(u32 *) b;
+	return (x > y) - (x < y);
+}
+
+static void sort_labels(Label_Table *labels) {
+	if (labels->count > 0) {
+		qsort(labels->addresses, labels->count, sizeof(u32), compare_addresses);
+		
+		int unique = 1;
+		for (int idx = 1; idx < labels->count; idx += 1) {
+			if (labels->addresses[idx] != labels->addresses[unique - 1]) {
+				labels->addresses[unique] = labels->addresses[idx];
+				unique += 1;
+			}
+		}
+		labels->count = unique;
+	}
+}
+
+// Returns the index of the label at `address`, or -1.
+static int find_label(Label_Table *labels, u32 address) {
+	int lo = 0;
+	int hi = labels->count;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (labels->addresses[mid] < address) lo = mid + 1;
+		else                                  hi = mid;
+	}
 	
-	return label;
+	int result = (lo < labels->count && labels->addresses[lo] == address) ? lo : -1;
+	return result;
 }
 
 //
 // Main decoder
 //
 
-static char *arithmetic_mnemonic_from_3bit_opcode(u8 opcode) {
-	char *mnemonic = 0;
-	switch (opcode) {
-		case 0b000: { mnemonic = "add"; } break;
-		case 0b010: { mnemonic = "adc"; } break;
-		case 0b101: { mnemonic = "sub"; } break;
-		case 0b011: { mnemonic = "sbb"; } break;
-		case 0b111: { mnemonic = "cmp"; } break;
-		case 0b100: { mnemonic = "and"; } break;
-		case 0b001: { mnemonic = "or "; } break;
-		case 0b110: { mnemonic = "xor"; } break;
-		default: break;
-	}
-	return mnemonic;
+#include "dec8086_decode.h"
+#include "dec8086_decode.c"
+#include "dec8086_cfg.h"
+#include "dec8086_cfg.c"
+
+// NOTE(ema): The binary is read in chunks, and the unread tail is moved to the front before
+// each refill, so there are always at least DEC8086_MAX_INSTRUCTION_SIZE bytes to decode from
+// until the end of the file.
+typedef struct Input_Window Input_Window;
+struct Input_Window {
+	FILE *file;
+	u8   *data;
+	int   len;
+	int   pos;
+	int   cap;
+	int   address; // Of data[pos], from the start of the file
+	bool  eof;
+};
+
+#define INPUT_WINDOW_SIZE (64 * 1024)
+
+static void input_rewind(Input_Window *in) {
+	fseek(in->file, 0, SEEK_SET);
+	in->len = 0;
+	in->pos = 0;
+	in->address = 0;
+	in->eof = 0;
 }
 
-static char *unconditional_jump_mnemonic_from_opcode(u8 opcode) {
-	char *mnemonic = 0;
-	switch (opcode) {
-		case 0b01110100: { mnemonic = "jz    "; } break;
-		case 0b01111100: { mnemonic = "jl    "; } break;
-		case 0b01111110: { mnemonic = "jle   "; } break;
-		case 0b01110010: { mnemonic = "jb    "; } break;
-		case 0b01110110: { mnemonic = "jbe   "; } break;
-		case 0b01111010: { mnemonic = "jp    "; } break;
-		case 0b01110000: { mnemonic = "jo    "; } break;
-		case 0b01111000: { mnemonic = "js    "; } break;
-		case 0b01110101: { mnemonic = "jnz   "; } break;
-		case 0b01111101: { mnemonic = "jge   "; } break;
-		case 0b01111111: { mnemonic = "jg    "; } break;
-		case 0b01110011: { mnemonic = "jae   "; } break;
-		case 0b01110111: { mnemonic = "ja    "; } break;
-		case 0b01111011: { mnemonic = "jnp   "; } break;
-		case 0b01110001: { mnemonic = "jno   "; } break;
-		case 0b01111001: { mnemonic = "jns   "; } break;
+// Returns the number of bytes available at data[pos], which is only less than
+// DEC8086_MAX_INSTRUCTION_SIZE near the end of the file.
+static int input_refill(Input_Window *in) {
+	int available = in->len - in->pos;
+	if (available < DEC8086_MAX_INSTRUCTION_SIZE && !in->eof) {
+		memmove(in->data, in->data + in->pos, available);
+		in->len = available;
+		in->pos = 0;
+		
+		size_t read = fread(in->data + in->len, 1, in->cap - in->len, in->file);
+		if (read == 0) {
+			in->eof = 1;
+		}
 		
-		case 0b11100010: { mnemonic = "loop  "; } break;
-		case 0b11100001: { mnemonic = "loopz "; } break;
-		case 0b11100000: { mnemonic = "loopnz"; } break;
-		case 0b11100011: { mnemonic = "jcxz  "; } break;
-		default: break;
+		in->len += (int) read;
+		available = in->len;
 	}
-	return mnemonic;
+	
+	return available;
 }
 
-static char ibuffer[1024 * 32] = {0};
-static int  ibuffer_cap = array_count(ibuffer);
-static int  ibuffer_len = 0;
-static int  ibuffer_idx = 0;
+static void input_advance(Input_Window *in, int size) {
+	in->pos += size;
+	in->address += size;
+}
 
-static void decode_8086(char *name, u8 *data, int len, bool print_labels) {
-	printf("; %s disassembly:\nbits 16\n", name);
-	
-	char *nreg_table[] = { "al", "cl", "dl", "bl", "ah", "ch", "dh", "bh", }; // Narrow registers
-	char *wreg_table[] = { "ax", "cx", "dx", "bx", "sp", "bp", "si", "di", }; // Wide registers
-	
-	char *addr_table[] = { // Effective address calculations
-		"bx + si", "bx + di", "bp + si", "bp + di", "si", "di", "bp", "bx"
-	};
+static bool is_shift_mnemonic(u8 mnemonic) {
+	bool result = (mnemonic == Mnemonic_shl || mnemonic == Mnemonic_shr || mnemonic == Mnemonic_sar ||
+				   mnemonic == Mnemonic_rol || mnemonic == Mnemonic_ror ||
+				   mnemonic == Mnemonic_rcl || mnemonic == Mnemonic_rcr);
+	return result;
+}
+
+static bool is_string_mnemonic(u8 mnemonic) {
+	bool result = (mnemonic == Mnemonic_movs || mnemonic == Mnemonic_cmps || mnemonic == Mnemonic_scas ||
+				   mnemonic == Mnemonic_lods || mnemonic == Mnemonic_stos);
+	return result;
+}
+
+static bool is_memory_operand(Decoded_Operand *operand) {
+	bool result = (operand->kind == Arg_Mem || operand->kind == Arg_Mem_Disp8 ||
+				   operand->kind == Arg_Mem_Disp16 || operand->kind == Arg_Direct);
+	return result;
+}
+
+static int jump_target_from_instruction(Decoded_Instruction *inst, int address) {
+	int target = address + inst->size + (i16) inst->operands[0].value;
+	return target;
+}
+
+static void format_operand(Output_Buffer *out, Decoded_Instruction *inst, int operand_index, int address, Label_Table *labels) {
+	Decoded_Operand *operand = &inst->operands[operand_index];
 	
-	memset(ibuffer, 0, sizeof(ibuffer));
-	ibuffer_len = 0;
-	ibuffer_idx = 0;
+	if (is_memory_operand(operand) && (inst->flags & Prefix_Segment)) {
+		output_string(out, seg_names[inst->segment]);
+		output_char(out, ':');
+	}
 	
-	int idx = 0;
-	while (idx < len) {
-		ibuffer_len += snprintf(ibuffer + ibuffer_len, ibuffer_cap, "%i ", idx);
+	switch (operand->kind) {
+		case Arg_None: break;
 		
-		u8 b0 = data[idx];
-		idx += 1;
+		case Arg_Reg8:  { output_string(out, reg8_names[operand->reg]);  } break;
+		case Arg_Reg16: { output_string(out, reg16_names[operand->reg]); } break;
+		case Arg_Seg:   { output_string(out, seg_names[operand->reg]);   } break;
 		
-		if        ((b0 >> 2 == 0x22) || (b0 >> 1 == 0x63)) {
-			// Register/memory to/from register/memory OR Immediate to register/memory
-			assert(idx < len);
-			
-			u8 b1 = data[idx], b2 = 0, b3 = 0, b4 = 0, b5 = 0;
-			idx += 1;
-			
-			char **reg_table = 0;
-			
-			if (b0 & 0x01)  reg_table = wreg_table;
-			else            reg_table = nreg_table;
-			
-			char *dst = 0, *src = 0;
-			char *size = "byte";
-			
-			{
-				// First assume that the D flag is 0, then swap source and destination if it
-				// turns out to be 1.
-				
-				if (b0 >> 2 == 0x22) {
-					// The first variant of mov, the source is a register
-					src = reg_table[(b1 >> 3) & 0x07]; // Extract from Reg field
-				} else {
-					// The second variant of mov, the source is an immediate; do nothing for now
-					;
-				}
-				
-				if (b1 >> 6 == 0x03) {
-					// The destination is a register
-					dst = reg_table[b1 & 0x07]; // Extract from R/M field
-				} else {
-					// The destination is memory: extract the formula and the displacement
-					// by checking the Mod field and wether the R/M field is 110.
-					
-					if ((b1 >> 6) != 0x00) {
-						char sign = ' ';
-						i32  disp = 0;
-						
-						if ((b1 >> 6) == 0x02) {
-							assert(idx + 1 < len);
-							
-							b2 = data[idx], b3 = data[idx + 1];
-							idx += 2;
-							
-							disp = (i32) transmute_i16((u16) b2 | ((u16) b3 << 8));
-						} else {
-							assert(idx < len);
-							
-							b2 = data[idx];
-							idx += 1;
-							
-							disp = (i32) transmute_i8(b2); // Sign-extend by increasing the size *after* changing the signedness.
-						}
-						
-						// This is done to get the same exact formatting that appears in Casey's listings.
-						// The disp is stored as i32 to avoid overflow when flipping the sign.
-						sign = disp < 0 ? '-' : '+';
-						disp = disp < 0 ? -disp : disp;
-						
-						dst = tsprintf("[%s %c %i]", addr_table[b1 & 0x07], sign, disp);
-					} else if ((b1 & 0x07) == 0x06) {
-						assert(idx + 1 < len);
-						
-						b2 = data[idx], b3 = data[idx + 1];
-						idx += 2;
-						
-						// When the displacement is actually just a direct address, it only makes sense for it
-						// to be unsigned.
-						u16 disp = ((u16) b2 | ((u16) b3 << 8));
-						
-						dst = tsprintf("[%u]", disp);
-					} else {
-						dst = tsprintf("[%s]", addr_table[b1 & 0x07]);
-					}
-				}
-				
-				if (b0 >> 2 == 0x22) {
-					// The first variant of mov, the source has already been extracted
-					;
-				} else {
-					// The second variant of mov, extract the immediate
-					assert(idx < len);
-					
-					b4 = data[idx];
-					idx += 1;
-					
-					u16 imm = b4;
-					
-					if (b0 & 0x01) {
-						assert(idx < len);
-						
-						b5 = data[idx];
-						idx += 1;
-						
-						imm = imm | (b5 << 8);
-						size = "word";
-					}
-					
-					src = tsprintf("%u", (u32) imm);
-				}
-				
-				// If the D flag is set AND we're in the first variant of the mov:
-				if ((b0 >> 2 == 0x22) && (b0 & 0x02)) {
-					char *tmp = dst; dst = src; src = tmp;
-				}
-			}
-			
-			// If it is either a reg/mem->reg/mem or an imm->reg, no need for an explicit size
-			if ((b0 >> 2 == 0x22) || (b1 >> 6 == 0x03)) {
-				ibuffer_len += snprintf(ibuffer + ibuffer_len, ibuffer_cap, "mov %s, %s\n", dst, src);
+		case Arg_Mem: {
+			output_char(out, '[');
+			output_string(out, address_names[operand->reg]);
+			output_char(out, ']');
+		} break;
+		
+		case Arg_Mem_Disp8:
+		case Arg_Mem_Disp16: {
+			// This is done to get the same exact formatting that appears in Casey's listings.
+			// The disp is stored as i32 to avoid overflow when flipping the sign.
+			i32 disp = (i16) operand->value;
+			output_char(out, '[');
+			output_string(out, address_names[operand->reg]);
+			output_string(out, disp < 0 ? " - " : " + ");
+			output_unsigned(out, (u32)(disp < 0 ? -disp : disp));
+			output_char(out, ']');
+		} break;
+		
+		case Arg_Direct: {
+			output_char(out, '[');
+			output_unsigned(out, operand->value);
+			output_char(out, ']');
+		} break;
+		
+		case Arg_Imm8:
+		case Arg_Imm16: {
+			output_unsigned(out, operand->value);
+		} break;
+		
+		case Arg_Imm8_Signed: {
+			output_signed(out, (i16) operand->value);
+		} break;
+		
+		case Arg_Rel8:
+		case Arg_Rel16: {
+			i32 disp = (i16) operand->value;
+			int label = labels ? find_label(labels, jump_target_from_instruction(inst, address)) : -1;
+			if (label >= 0) {
+				output_string(out, "label_");
+				output_unsigned(out, label);
+				output_string(out, " ; ");
+				output_signed(out, disp);
 			} else {
-				ibuffer_len += snprintf(ibuffer + ibuffer_len, ibuffer_cap, "mov %s, %s %s\n", dst, size, src);
+				// Same as "$%+i"
+				i32 offset = disp + inst->size;
+				output_string(out, offset < 0 ? "$" : "$+");
+				output_signed(out, offset);
 			}
-		} else if (b0 >> 4 == 0x0B) { // Immediate to register
-			assert(idx < len);
-			
-			u8 b1 = data[idx], b2 = 0;
-			idx += 1;
-			
-			u16 imm = b1;
-			char **reg_table = 0;
-			
-			if (b0 & 0x08) {
-				assert(idx < len);
-				
-				b2 = data[idx];
-				idx += 1;
-				
-				imm = imm | (b2 << 8);
-				
-				reg_table = wreg_table;
-			} else {
-				reg_table = nreg_table;
+		} break;
+		
+		case Arg_Far: {
+			output_unsigned(out, inst->operands[1].value);
+			output_char(out, ':');
+			output_unsigned(out, operand->value);
+		} break;
+	}
+}
+
+// NOTE(ema): The size of a memory operand is spelled out when no register operand implies it.
+// It goes before the immediate if there is one, like in Casey's listings, otherwise before
+// the memory operand.
+static void format_instruction(Output_Buffer *out, Decoded_Instruction *inst, int address, Label_Table *labels) {
+	Decoded_Operand *operands = inst->operands;
+	
+	bool has_memory   = is_memory_operand(&operands[0]) || is_memory_operand(&operands[1]);
+	bool has_register = (operands[0].kind == Arg_Reg8 || operands[0].kind == Arg_Reg16 || operands[0].kind == Arg_Seg ||
+						 operands[1].kind == Arg_Reg8 || operands[1].kind == Arg_Reg16 || operands[1].kind == Arg_Seg);
+	bool is_transfer  = inst->mnemonic == Mnemonic_call || inst->mnemonic == Mnemonic_jmp;
+	bool is_shift     = is_shift_mnemonic(inst->mnemonic);
+	
+	int size_operand = -1;
+	if (has_memory && !is_transfer && inst->mnemonic != Mnemonic_esc && (!has_register || is_shift)) {
+		bool before_immediate = !is_shift && (operands[1].kind == Arg_Imm8 || operands[1].kind == Arg_Imm16 ||
+											  operands[1].kind == Arg_Imm8_Signed);
+		size_operand = before_immediate ? 1 : 0;
+	}
+	
+	if (inst->flags & Prefix_Lock)  output_string(out, "lock ");
+	if (inst->flags & Prefix_Rep)   output_string(out, "rep ");
+	if (inst->flags & Prefix_Repne) output_string(out, "repne ");
+	if ((inst->flags & Prefix_Segment) && !has_memory) {
+		output_string(out, seg_names[inst->segment]);
+		output_char(out, ' ');
+	}
+	
+	output_string(out, mnemonic_names[inst->mnemonic]);
+	if (is_string_mnemonic(inst->mnemonic)) {
+		output_char(out, (inst->flags & Decoded_Wide) ? 'w' : 'b');
+	}
+	if (is_transfer && (inst->flags & Decoded_Far)) {
+		output_string(out, " far");
+	}
+	
+	char *separator = " ";
+	int operand_count = (operands[0].kind == Arg_Far) ? 1 : 2;
+	for (int operand_index = 0; operand_index < operand_count; operand_index += 1) {
+		if (operands[operand_index].kind != Arg_None) {
+			output_string(out, separator);
+			separator = ", ";
+			
+			if (operand_index == size_operand) {
+				output_string(out, (inst->flags & Decoded_Wide) ? "word " : "byte ");
 			}
 			
-			char *dst = reg_table[b0 & 0x07];
-			
-			ibuffer_len += snprintf(ibuffer + ibuffer_len, ibuffer_cap, "mov %s, %u\n", dst, (u32) imm);
-		} else if (b0 >> 2 == 0x28) { // Memory to accumulator/Accumulator to memory
-			assert(idx + 1 < len);
-			
-			u8 b1 = data[idx], b2 = data[idx + 1];
-			idx += 2;
-			
-			u16  addr = b1 | (b2 << 8);
-			char *fmt = (b0 & 0x02) ? "mov [%u], ax\n" : "mov ax, [%u]\n";
-			
-			ibuffer_len += snprintf(ibuffer + ibuffer_len, ibuffer_cap, fmt, (u32) addr);
-		} else if (((b0 >> 2) & ~0b00001110) == 0 || ((b0 >> 2) & ~0b00001110) == 0x20) {
-			// Register/memory to/from register/memory OR Immediate to register/memory
-			assert(idx < len);
-			
-			u8 b1 = data[idx], b2 = 0, b3 = 0, b4 = 0, b5 = 0;
-			idx += 1;
-			
-			u8 opcode = 0;
-			if ((b0 & 0x80) == 0) { opcode = (b0 >> 3) & 0x07; }
-			else                  { opcode = (b1 >> 3) & 0x07; }
-			
-			char *mnemonic = arithmetic_mnemonic_from_3bit_opcode(opcode);
-			
-			char **reg_table = 0;
-			
-			if (b0 & 0x01)  reg_table = wreg_table;
-			else            reg_table = nreg_table;
-			
-			char *dst = 0, *src = 0;
-			char *size = "byte";
-			
-			bool is_1st_variant = ((b0 >> 2) & ~0b1110) == 0;
-			
-			{
-				// First assume that the D flag is 0, then swap source and destination if it
-				// turns out to be 1.
-				
-				if (is_1st_variant) {
-					// The first variant of instruction, the source is a register
-					src = reg_table[(b1 >> 3) & 0x07]; // Extract from Reg field
-				} else {
-					// The second variant of instruction, the source is an immediate; do nothing for now
-					;
-				}
-				
-				if (b1 >> 6 == 0x03) {
-					// The destination is a register
-					dst = reg_table[b1 & 0x07]; // Extract from R/M field
-				} else {
-					// The destination is memory: extract the formula and the displacement
-					// by checking the Mod field and wether the R/M field is 110.
-					
-					if ((b1 >> 6) != 0x00) {
-						char sign = ' ';
-						i32  disp = 0;
-						
-						if ((b1 >> 6) == 0x02) {
-							assert(idx + 1 < len);
-							
-							b2 = data[idx], b3 = data[idx + 1];
-							idx += 2;
-							
-							disp = (i32) transmute_i16((u16) b2 | ((u16) b3 << 8));
-						} else {
-							assert(idx < len);
-							
-							b2 = data[idx];
-							idx += 1;
-							
-							disp = (i32) transmute_i8(b2); // Sign-extend by increasing the size *after* changing the signedness.
-						}
-						
-						// This is done to get the same exact formatting that appears in Casey's listings.
-						// The disp is stored as i32 to avoid overflow when flipping the sign.
-						sign = disp < 0 ? '-' : '+';
-						disp = disp < 0 ? -disp : disp;
-						
-						dst = tsprintf("[%s %c %i]", addr_table[b1 & 0x07], sign, disp);
-					} else if ((b1 & 0x07) == 0x06) {
-						assert(idx + 1 < len);
-						
-						b2 = data[idx], b3 = data[idx + 1];
-						idx += 2;
-						
-						// When the displacement is actually just a direct address, it only makes sense for it
-						// to be unsigned.
-						u16 disp = ((u16) b2 | ((u16) b3 << 8));
-						
-						dst = tsprintf("[%u]", disp);
-					} else {
-						dst = tsprintf("[%s]", addr_table[b1 & 0x07]);
-					}
-				}
-				
-				if (is_1st_variant) {
-					// The first variant of mov, the source has already been extracted
-					;
-				} else {
-					// The second variant of mov, extract the immediate
-					assert(idx < len);
-					
-					b4 = data[idx];
-					idx += 1;
-					
-					u16 imm = b4;
-					
-					if ((b0 & 0x02) == 0x01) {
-						assert(idx < len);
-						
-						b5 = data[idx];
-						idx += 1;
-						
-						imm = imm | (b5 << 8);
-						size = "word";
-					}
-					
-					src = tsprintf("%u", (u32) imm);
-				}
-				
-				// If the D flag is set AND we're in the first variant of the instruction:
-				if (is_1st_variant && (b0 & 0x02)) {
-					char *tmp = dst; dst = src; src = tmp;
+			format_operand(out, inst, operand_index, address, labels);
+		}
+	}
+}
+
+// NOTE(ema): Labels have to be known before the instruction they point to is printed, so a
+// first pass only decodes and records the jump targets. Targets outside the file can't be
+// labeled and are printed relative to the instruction instead.
+static bool collect_labels(Input_Window *in, Label_Table *labels) {
+	bool ok = 1;
+	
+	int available = input_refill(in);
+	while (ok && available > 0) {
+		Decoded_Instruction inst;
+		int size = decode_instruction(in->data + in->pos, available, &inst);
+		
+		if (size) {
+			u8 kind = inst.operands[0].kind;
+			if (kind == Arg_Rel8 || kind == Arg_Rel16) {
+				int target = jump_target_from_instruction(&inst, in->address);
+				if (target >= 0) {
+					ok = add_label(labels, (u32) target);
 				}
 			}
-			
-			if (is_1st_variant || (b1 >> 6 == 0x03)) {
-				ibuffer_len += snprintf(ibuffer + ibuffer_len, ibuffer_cap, "%s %s, %s\n", mnemonic, dst, src);
-			} else {
-				ibuffer_len += snprintf(ibuffer + ibuffer_len, ibuffer_cap, "%s %s, %s %s\n", mnemonic, dst, size, src);
-			}
-		} else if (((b0 >> 1) & ~0b00011100) == 0b10) { // Arithmetic immediate w/ accumulator
-			assert(idx < len);
-			
-			u8 b1 = data[idx], b2 = 0;
-			idx += 1;
-			
-			char *dst = 0;
-			
-			if (b0 & 0x01)  dst = "ax";
-			else            dst = "al";
-			
-			u16 imm = b1;
-			
-			if (b0 & 0x01) {
-				assert(idx < len);
-				
-				b2 = data[idx];
-				idx += 1;
-				
-				imm = imm | (b2 << 8);
-			}
-			
-			u8 op = b0 >> 3;
-			char *mnemonic = arithmetic_mnemonic_from_3bit_opcode(op);
-			
-			ibuffer_len += snprintf(ibuffer + ibuffer_len, ibuffer_cap, "%s %s, %u\n", mnemonic, dst, (u32) imm);
 		} else {
-			char *mnemonic = unconditional_jump_mnemonic_from_opcode(b0);
-			if (mnemonic) {
-				assert(idx < len);
-				
-				u8 b1 = data[idx];
-				idx += 1;
-				
-				i8 disp = transmute_i8(b1);
+			size = 1;
+		}
+		
+		input_advance(in, size);
+		available = input_refill(in);
+	}
+	
+	// NOTE(ema): The file size is only known now.
+	int unlabeled = 0;
+	for (int idx = 0; idx < labels->count; idx += 1) {
+		if (labels->addresses[idx] <= (u32) in->address) {
+			labels->addresses[idx - unlabeled] = labels->addresses[idx];
+		} else {
+			unlabeled += 1;
+		}
+	}
+	labels->count -= unlabeled;
+	
+	sort_labels(labels);
+	
+	return ok;
+}
+
+static void output_label(Output_Buffer *out, int label) {
+	output_string(out, "label_");
+	output_unsigned(out, label);
+	output_string(out, ":\n");
+}
+
+// NOTE(ema): Instructions and labels are both walked in address order. A label that points
+// inside an instruction can't go on its own line, so it's defined relative to the start of
+// the instruction with "equ" instead.
+static void decode_8086(Output_Buffer *out, Input_Window *in, char *name, Label_Table *labels) {
+	output_flush(out);
+	fprintf(out->file, "; %s disassembly:\nbits 16\n", name);
+	
+	int next_label = 0;
+	
+	int available = input_refill(in);
+	while (available > 0) {
+		Decoded_Instruction inst;
+		int size = decode_instruction(in->data + in->pos, available, &inst);
+		if (!size) {
+			// NOTE(ema): Emit the byte as data so that the listing can still be reassembled.
+			fprintf(stderr, "Unknown instruction at %i\n", in->address);
+			size = 1;
+		}
+		
+		u32 address = (u32) in->address;
+		if (labels) {
+			while (next_label < labels->count && labels->addresses[next_label] < address + size) {
+				output_reserve(out, OUTPUT_LINE_MAX);
 				
-				if (print_labels) {
-					char *label = label_from_absolute_address(idx + (int) disp, 1);
-					ibuffer_len += snprintf(ibuffer + ibuffer_len, ibuffer_cap, "%s %s ; %i\n", mnemonic, label, (i32) disp);
+				u32 label_address = labels->addresses[next_label];
+				if (label_address == address) {
+					output_label(out, next_label);
 				} else {
-					ibuffer_len += snprintf(ibuffer + ibuffer_len, ibuffer_cap, "%s %i\n", mnemonic, (i32) disp);
+					output_string(out, "label_");
+					output_unsigned(out, next_label);
+					output_string(out, " equ $+");
+					output_unsigned(out, label_address - address);
+					output_char(out, '\n');
 				}
-			} else {
-				fprintf(stderr, "Unknown instruction\n");
+				
+				next_label += 1;
 			}
 		}
 		
-		temp_reset();
+		output_reserve(out, OUTPUT_LINE_MAX);
+		
+		if (inst.size) {
+			format_instruction(out, &inst, in->address, labels);
+		} else {
+			output_string(out, "db ");
+			output_unsigned(out, in->data[in->pos]);
+		}
+		
+		output_char(out, '\n');
+		input_advance(in, size);
+		available = input_refill(in);
 	}
 	
-	while (ibuffer_idx < ibuffer_len) {
-		int line_start = ibuffer_idx;
-		int space = ibuffer_idx;
-		
-		while (ibuffer[space] != ' ') {
-			space += 1;
+	// Only a label at the very end of the file is left.
+	if (labels) {
+		while (next_label < labels->count) {
+			output_reserve(out, OUTPUT_LINE_MAX);
+			output_label(out, next_label);
+			next_label += 1;
 		}
+	}
+	
+	output_flush(out);
+}
+
+// NOTE(ema): The graph is printed as comments, so it can be pasted next to a listing.
+static void print_cfg(FILE *file, char *name, Cfg *cfg) {
+	static char *edge_names[] = { "fallthrough", "taken", "call" };
+	static char *flag_names[] = { "entry", "return", "halt", "indirect", "exit", "invalid", "loop" };
+	
+	fprintf(file, "; %s control flow:\n", name);
+	fprintf(file, "; %u blocks, %u edges, %u loops, %u instructions\n",
+			cfg->block_count, cfg->edge_count, cfg->loop_count, cfg->instruction_count);
+	
+	for (u32 block_index = 0; block_index < cfg->block_count; block_index += 1) {
+		Cfg_Block *block = &cfg->blocks[block_index];
+		fprintf(file, "; block %u: %u-%u, %u instructions", block_index, block->start, block->end, block->instruction_count);
 		
-		int addr = antoi(ibuffer + line_start, space - line_start);
-		char *label = label_from_absolute_address(addr, 0);
-		if (label) {
-			printf("%s:\n", label);
+		for (int flag = 0; flag < (int) array_count(flag_names); flag += 1) {
+			if (block->flags & (1 << flag)) fprintf(file, ", %s", flag_names[flag]);
 		}
 		
-		int newline = space + 1;
-		while (ibuffer[newline] != '\n') {
-			newline += 1;
+		char *separator = " -> ";
+		for (u32 idx = 0; idx < block->edge_count; idx += 1) {
+			Cfg_Edge *edge = &cfg->edges[block->first_edge + idx];
+			fprintf(file, "%s%u (%s)", separator, edge->to, edge_names[edge->kind]);
+			separator = ", ";
 		}
+		fprintf(file, "\n");
+	}
+	
+	for (u32 loop_index = 0; loop_index < cfg->loop_count; loop_index += 1) {
+		Cfg_Loop *loop = &cfg->loops[loop_index];
+		fprintf(file, "; loop %u: header %u, latch %u, blocks", loop_index, loop->header, loop->latch);
+		for (u32 idx = 0; idx < loop->block_count; idx += 1) {
+			fprintf(file, " %u", cfg->loop_blocks[loop->first_block + idx]);
+		}
+		fprintf(file, "\n");
+	}
+}
+
+// Builds the graph of the first 64KB of the file (one code segment), starting at offset 0.
+static bool print_blocks(FILE *file, char *name) {
+	u32 cap = 64 * 1024;
+	u8 *code = malloc(cap);
+	bool ok = code != 0;
+	
+	if (ok) {
+		u32 len = (u32) fread(code, 1, cap, file);
 		
-		printf("%.*s\n", newline - space - 1, ibuffer + space + 1);
-		ibuffer_idx = newline + 1;
+		u32 entry = 0;
+		Cfg cfg = {0};
+		ok = build_cfg(&cfg, code, len, &entry, 1);
+		if (ok) {
+			print_cfg(stdout, name, &cfg);
+			free_cfg(&cfg);
+		}
 	}
+	
+	free(code);
+	return ok;
 }
 
 //
@@ -636,26 +604,51 @@ static void decode_8086(char *name, u8 *data, int len, bool print_labels) {
 //
 
 int main(int argc, char **argv) {
-	temp_init();
-	
 	if (argc > 1) {
 		FILE *file = fopen(argv[1], "rb");
 		if (file) {
-			fseek(file, 0, SEEK_END);
-			size_t file_size = ftell(file);
-			fseek(file, 0, SEEK_SET);
+			bool print_labels = 0;
+			bool print_graph  = 0;
+			for (int arg_index = 2; arg_index < argc; arg_index += 1) {
+				if (memcmp(argv[arg_index], strlit_expand_pn("-labels")) == 0) print_labels = 1;
+				if (memcmp(argv[arg_index], strlit_expand_pn("-blocks")) == 0) print_graph  = 1;
+			}
+			
+			Input_Window in = {0};
+			in.file = file;
+			in.data = malloc(INPUT_WINDOW_SIZE);
+			in.cap  = INPUT_WINDOW_SIZE;
+			
+			Output_Buffer out = {0};
+			out.data = malloc(OUTPUT_BUFFER_SIZE);
+			out.cap  = OUTPUT_BUFFER_SIZE;
+			out.file = stdout;
+			
+			Label_Table labels = {0};
 			
-			u8 *file_data = malloc(file_size);
-			if (file_data && fread(file_data, 1, file_size, file) == file_size) {
-				bool print_labels = 0;
-				if (argc > 2 && memcmp(argv[2], strlit_expand_pn("-labels")) == 0)
-					print_labels = 1;
+			bool ok = in.data && out.data;
+			if (ok && print_graph) {
+				ok = print_blocks(file, argv[1]);
+			} else if (ok) {
+				if (print_labels) {
+					ok = collect_labels(&in, &labels);
+					input_rewind(&in);
+				}
 				
-				decode_8086(argv[1], file_data, (int) file_size, print_labels);
-			} else {
+				if (ok) {
+					decode_8086(&out, &in, argv[1], print_labels ? &labels : 0);
+				}
+			}
+			
+			if (ferror(file)) {
 				fprintf(stderr, "Error reading the file\n");
+			} else if (!ok) {
+				fprintf(stderr, "Out of memory\n");
 			}
 			
+			free(in.data);
+			free(out.data);
+			free(labels.addresses);
 			fclose(file);
 		} else {
 			fprintf(stderr, "Error opening the file\n");
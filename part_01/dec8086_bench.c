@@ -0,0 +1,265 @@
+/*
+** Compares the table-driven decoder of dec8086 with Sim86_Decode8086Instruction, in decoded
+** instructions per second over a large corpus of random bytes (or of any file).
+** Both decoders walk the corpus the same way: on a valid instruction they skip its size,
+** otherwise they skip one byte.
+** It also times build_cfg over the first 64KB of the corpus.
+*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sim86_shared.h"
+#pragma comment (lib, "sim86_shared_debug.lib")
+
+#include "dec8086_decode.h"
+#include "dec8086_decode.c"
+#include "dec8086_cfg.h"
+#include "dec8086_cfg.c"
+
+//
+// Timing
+//
+
+#if _WIN32
+
+#include <windows.h>
+
+static u64 get_os_timer_frequency(void) {
+	LARGE_INTEGER freq = {0};
+	QueryPerformanceFrequency(&freq);
+	return freq.QuadPart;
+}
+
+static u64 read_os_timer(void) {
+	LARGE_INTEGER value = {0};
+	QueryPerformanceCounter(&value);
+	return value.QuadPart;
+}
+
+#else
+
+#include <time.h>
+
+static u64 get_os_timer_frequency(void) {
+	return 1000000000;
+}
+
+static u64 read_os_timer(void) {
+	struct timespec value = {0};
+	clock_gettime(CLOCK_MONOTONIC, &value);
+	
+	u64 result = get_os_timer_frequency()*(u64)value.tv_sec + (u64)value.tv_nsec;
+	return result;
+}
+
+#endif
+
+//
+// Decoder loops
+//
+
+typedef struct Decode_Result Decode_Result;
+struct Decode_Result {
+	u64 instruction_count;
+	u64 invalid_count;
+	u64 checksum; // Keeps the compiler from throwing the decoded instructions away
+};
+
+static Decode_Result decode_corpus_with_table(u8 *data, int len) {
+	Decode_Result result = {0};
+	
+	int idx = 0;
+	while (idx < len) {
+		Decoded_Instruction inst;
+		int size = decode_instruction(data + idx, len - idx, &inst);
+		if (size) {
+			result.instruction_count += 1;
+			result.checksum += inst.mnemonic + inst.operands[0].value;
+			idx += size;
+		} else {
+			result.invalid_count += 1;
+			idx += 1;
+		}
+	}
+	
+	return result;
+}
+
+static Decode_Result decode_corpus_with_sim86(u8 *data, int len) {
+	Decode_Result result = {0};
+	
+	int idx = 0;
+	while (idx < len) {
+		instruction inst;
+		Sim86_Decode8086Instruction(len - idx, data + idx, &inst);
+		if (inst.Op) {
+			result.instruction_count += 1;
+			result.checksum += inst.Op + inst.Operands[0].Immediate.Value;
+			idx += inst.Size;
+		} else {
+			result.invalid_count += 1;
+			idx += 1;
+		}
+	}
+	
+	return result;
+}
+
+typedef Decode_Result Decode_Corpus_Function(u8 *data, int len);
+
+static void benchmark_decoder(char *label, Decode_Corpus_Function *decode_corpus, u8 *data, int len, int repetitions) {
+	Decode_Result result = {0};
+	u64 best_ticks = (u64) -1;
+	
+	for (int repetition = 0; repetition < repetitions; repetition += 1) {
+		u64 start = read_os_timer();
+		result = decode_corpus(data, len);
+		u64 ticks = read_os_timer() - start;
+		
+		if (ticks < best_ticks) best_ticks = ticks;
+	}
+	
+	double seconds = (double) best_ticks / (double) get_os_timer_frequency();
+	if (seconds <= 0) seconds = 1e-9;
+	
+	printf("%-8s %12llu instructions, %10llu invalid, best %8.3fms, %8.2f Minstr/s, %8.2f MB/s (checksum %llu)\n",
+		   label, (unsigned long long) result.instruction_count, (unsigned long long) result.invalid_count,
+		   seconds * 1000.0, (double) result.instruction_count / seconds / 1e6,
+		   (double) len / seconds / (1024.0 * 1024.0), (unsigned long long) result.checksum);
+}
+
+// Decodes at every instruction boundary found by the table decoder with both decoders, and
+// reports where they disagree about the size.
+static void compare_decoders(u8 *data, int len, int max_reports) {
+	u64 compared = 0;
+	u64 mismatches = 0;
+	
+	int idx = 0;
+	while (idx < len) {
+		Decoded_Instruction inst;
+		int size = decode_instruction(data + idx, len - idx, &inst);
+		
+		instruction reference;
+		Sim86_Decode8086Instruction(len - idx, data + idx, &reference);
+		int reference_size = reference.Op ? (int) reference.Size : 0;
+		
+		compared += 1;
+		if (size != reference_size) {
+			if (mismatches < (u64) max_reports) {
+				printf("  mismatch at %i: table %i bytes (%s), sim86 %i bytes (%s), bytes:", idx,
+					   size, mnemonic_names[inst.mnemonic], reference_size,
+					   reference.Op ? Sim86_MnemonicFromOperationType(reference.Op) : "");
+				for (int byte_index = 0; byte_index < 6 && idx + byte_index < len; byte_index += 1) {
+					printf(" %02x", data[idx + byte_index]);
+				}
+				printf("\n");
+			}
+			mismatches += 1;
+		}
+		
+		idx += size ? size : 1;
+	}
+	
+	printf("Compared %llu instructions, %llu size mismatches\n",
+		   (unsigned long long) compared, (unsigned long long) mismatches);
+}
+
+// NOTE(ema): Random bytes branch out of reach quickly, so besides offset 0 there is an entry
+// point every `entry_stride` bytes, to get a graph that covers most of the segment.
+static void benchmark_cfg(u8 *data, int len, u32 entry_stride, int repetitions) {
+	u32 segment_len = (len < 64 * 1024) ? (u32) len : 64 * 1024;
+	
+	u32  entry_count = segment_len / entry_stride + 1;
+	u32 *entries = malloc(sizeof(u32) * entry_count);
+	if (entries) {
+		for (u32 idx = 0; idx < entry_count; idx += 1) {
+			entries[idx] = idx * entry_stride;
+		}
+		
+		Cfg cfg = {0};
+		u64 best_ticks = (u64) -1;
+		bool ok = 1;
+		
+		for (int repetition = 0; ok && repetition < repetitions; repetition += 1) {
+			free_cfg(&cfg);
+			
+			u64 start = read_os_timer();
+			ok = build_cfg(&cfg, data, segment_len, entries, entry_count);
+			u64 ticks = read_os_timer() - start;
+			
+			if (ticks < best_ticks) best_ticks = ticks;
+		}
+		
+		if (ok) {
+			double seconds = (double) best_ticks / (double) get_os_timer_frequency();
+			printf("cfg      %u bytes, %u entries: %u instructions, %u blocks, %u edges, %u loops, best %8.3fms\n",
+				   segment_len, entry_count, cfg.instruction_count, cfg.block_count, cfg.edge_count, cfg.loop_count,
+				   seconds * 1000.0);
+		} else {
+			printf("cfg      out of memory\n");
+		}
+		
+		free_cfg(&cfg);
+		free(entries);
+	}
+}
+
+//
+// Entry point
+//
+
+int main(int argc, char **argv) {
+	int len = 16 * 1024 * 1024;
+	u8 *data = 0;
+	
+	if (argc > 1) {
+		FILE *file = fopen(argv[1], "rb");
+		if (file) {
+			fseek(file, 0, SEEK_END);
+			len = (int) ftell(file);
+			fseek(file, 0, SEEK_SET);
+			
+			data = malloc(len);
+			if (data && fread(data, 1, len, file) != (size_t) len) {
+				free(data);
+				data = 0;
+			}
+			
+			fclose(file);
+		}
+		
+		if (!data) {
+			fprintf(stderr, "Error reading file '%s'\n", argv[1]);
+		}
+	} else {
+		data = malloc(len);
+		if (data) {
+			// NOTE(ema): Fixed seed, so that runs are comparable.
+			u64 state = 0x9E3779B97F4A7C15ull;
+			for (int idx = 0; idx < len; idx += 1) {
+				state ^= state << 13;
+				state ^= state >> 7;
+				state ^= state << 17;
+				data[idx] = (u8) state;
+			}
+		}
+	}
+	
+	if (data) {
+		printf("Corpus: %s, %i bytes\n", (argc > 1) ? argv[1] : "random", len);
+		
+		benchmark_decoder("table", decode_corpus_with_table, data, len, 10);
+		benchmark_decoder("sim86", decode_corpus_with_sim86, data, len, 10);
+		
+		benchmark_cfg(data, len, 65536, 10);
+		benchmark_cfg(data, len, 16, 10);
+		
+		compare_decoders(data, len, 16);
+		free(data);
+	}
+	
+	return 0;
+}
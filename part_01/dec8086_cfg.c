@@ -0,0 +1,417 @@
+//
+// Helpers
+//
+
+enum {
+	Mark_Instruction = 1 << 0, // An instruction was decoded here
+	Mark_Invalid     = 1 << 1, // The bytes here don't decode
+	Mark_Block_Start = 1 << 2,
+	Mark_Entry       = 1 << 3,
+	Mark_Queued      = 1 << 4,
+};
+
+// Grows `*items` so that it holds at least `needed` items of `item_size` bytes.
+static bool cfg_reserve(void **items, u32 *cap, u32 needed, size_t item_size) {
+	bool ok = 1;
+	
+	if (needed > *cap) {
+		u32 new_cap = *cap ? *cap : 256;
+		while (new_cap < needed) new_cap *= 2;
+		
+		void *new_items = realloc(*items, item_size * new_cap);
+		if (new_items) {
+			*items = new_items;
+			*cap = new_cap;
+		} else {
+			ok = 0;
+		}
+	}
+	
+	return ok;
+}
+
+static bool is_branch_operand(Decoded_Operand *operand) {
+	bool result = (operand->kind == Arg_Rel8 || operand->kind == Arg_Rel16);
+	return result;
+}
+
+static bool is_return_mnemonic(u8 mnemonic) {
+	bool result = (mnemonic == Mnemonic_ret || mnemonic == Mnemonic_retf || mnemonic == Mnemonic_iret);
+	return result;
+}
+
+// NOTE(ema): Control never falls through these.
+static bool ends_flow(Decoded_Instruction *inst) {
+	bool result = (inst->mnemonic == Mnemonic_jmp || inst->mnemonic == Mnemonic_hlt || is_return_mnemonic(inst->mnemonic));
+	return result;
+}
+
+// Anything that changes the flow ends a block, except interrupts.
+static bool ends_block(Decoded_Instruction *inst) {
+	bool result = (ends_flow(inst) || inst->mnemonic == Mnemonic_call || is_branch_operand(&inst->operands[0]));
+	return result;
+}
+
+static u32 branch_target(Decoded_Instruction *inst, u32 address) {
+	u32 target = address + inst->size + (u32)(i32)(i16) inst->operands[0].value;
+	return target;
+}
+
+//
+// Reachability
+//
+
+// Decodes every instruction reachable from the entry points and marks where blocks start.
+// Every address is queued at most once, so `queue` needs room for `len` addresses.
+static void mark_reachable_code(u8 *code, u32 len, u8 *marks, u32 *queue, u32 *entries, u32 entry_count) {
+	u32 queue_count = 0;
+	for (u32 entry_index = 0; entry_index < entry_count; entry_index += 1) {
+		u32 entry = entries[entry_index];
+		if (entry < len && !(marks[entry] & Mark_Queued)) {
+			marks[entry] |= Mark_Queued | Mark_Block_Start | Mark_Entry;
+			queue[queue_count++] = entry;
+		}
+	}
+	
+	while (queue_count > 0) {
+		u32 address = queue[--queue_count];
+		
+		// Decode until the flow leaves, or until it joins code that was already decoded.
+		while (address < len && !(marks[address] & (Mark_Instruction | Mark_Invalid))) {
+			Decoded_Instruction inst;
+			int size = decode_instruction(code + address, (int)(len - address), &inst);
+			if (!size) {
+				marks[address] |= Mark_Invalid;
+				break;
+			}
+			
+			marks[address] |= Mark_Instruction;
+			u32 next = address + size;
+			
+			if (is_branch_operand(&inst.operands[0])) {
+				u32 target = branch_target(&inst, address);
+				if (target < len) {
+					marks[target] |= Mark_Block_Start;
+					if (inst.mnemonic == Mnemonic_call) marks[target] |= Mark_Entry;
+					
+					if (!(marks[target] & Mark_Queued)) {
+						marks[target] |= Mark_Queued;
+						queue[queue_count++] = target;
+					}
+				}
+			}
+			
+			if (ends_flow(&inst)) {
+				break;
+			}
+			
+			if (ends_block(&inst) && next < len) {
+				marks[next] |= Mark_Block_Start;
+			}
+			
+			address = next;
+		}
+	}
+}
+
+//
+// Graph
+//
+
+static int find_block(Cfg *cfg, u32 address) {
+	u32 lo = 0;
+	u32 hi = cfg->block_count;
+	while (lo < hi) {
+		u32 mid = lo + (hi - lo) / 2;
+		if (cfg->blocks[mid].start < address) lo = mid + 1;
+		else                                  hi = mid;
+	}
+	
+	int result = (lo < cfg->block_count && cfg->blocks[lo].start == address) ? (int) lo : -1;
+	return result;
+}
+
+// Decodes each block again from its start, and records its successors with the target address
+// in `to`; they are turned into block indices once all blocks exist.
+static bool build_blocks(Cfg *cfg, u8 *code, u32 len, u8 *marks) {
+	bool ok = 1;
+	
+	u32 block_count = 0;
+	for (u32 address = 0; address < len; address += 1) {
+		if ((marks[address] & Mark_Block_Start) && (marks[address] & (Mark_Instruction | Mark_Invalid))) {
+			block_count += 1;
+		}
+	}
+	
+	cfg->blocks = calloc(block_count ? block_count : 1, sizeof(Cfg_Block));
+	cfg->edges  = malloc(sizeof(Cfg_Edge) * (block_count ? 2 * block_count : 1));
+	ok = cfg->blocks && cfg->edges;
+	
+	for (u32 start = 0; ok && start < len; start += 1) {
+		if (!(marks[start] & Mark_Block_Start) || !(marks[start] & (Mark_Instruction | Mark_Invalid))) {
+			continue;
+		}
+		
+		u32 block_index = cfg->block_count++;
+		Cfg_Block *block = &cfg->blocks[block_index];
+		block->start = start;
+		block->first_edge = cfg->edge_count;
+		if (marks[start] & Mark_Entry) block->flags |= Block_Entry;
+		
+		u32 address = start;
+		bool done = 0;
+		while (!done) {
+			Decoded_Instruction inst;
+			int size = decode_instruction(code + address, (int)(len - address), &inst);
+			if (!size) {
+				block->flags |= Block_Invalid;
+				break;
+			}
+			
+			block->instruction_count += 1;
+			u32 next = address + size;
+			bool falls_through = !ends_flow(&inst);
+			
+			if (is_branch_operand(&inst.operands[0])) {
+				u32 target = branch_target(&inst, address);
+				if (target < len) {
+					Cfg_Edge edge = { block_index, target, (inst.mnemonic == Mnemonic_call) ? Edge_Call : Edge_Taken };
+					cfg->edges[cfg->edge_count++] = edge;
+				} else {
+					block->flags |= Block_Exit;
+				}
+			} else if (inst.operands[0].kind == Arg_Far) {
+				block->flags |= Block_Exit;
+			} else if (inst.mnemonic == Mnemonic_call || inst.mnemonic == Mnemonic_jmp) {
+				block->flags |= Block_Indirect;
+			} else if (is_return_mnemonic(inst.mnemonic)) {
+				block->flags |= Block_Return;
+			} else if (inst.mnemonic == Mnemonic_hlt) {
+				block->flags |= Block_Halt;
+			}
+			
+			done = ends_block(&inst);
+			if (falls_through) {
+				if (next >= len) {
+					block->flags |= Block_Exit;
+					done = 1;
+				} else if (done || (marks[next] & Mark_Block_Start)) {
+					Cfg_Edge edge = { block_index, next, Edge_Fallthrough };
+					cfg->edges[cfg->edge_count++] = edge;
+					done = 1;
+				}
+			}
+			
+			address = next;
+		}
+		
+		block->end = address;
+		block->edge_count = cfg->edge_count - block->first_edge;
+	}
+	
+	for (u32 edge_index = 0; ok && edge_index < cfg->edge_count; edge_index += 1) {
+		Cfg_Edge *edge = &cfg->edges[edge_index];
+		int to = find_block(cfg, edge->to);
+		assert(to >= 0);
+		edge->to = (u32) to;
+	}
+	
+	return ok;
+}
+
+static bool build_predecessors(Cfg *cfg) {
+	bool ok = 1;
+	
+	cfg->predecessors = malloc(sizeof(u32) * (cfg->edge_count ? cfg->edge_count : 1));
+	ok = cfg->predecessors != 0;
+	
+	if (ok) {
+		for (u32 edge_index = 0; edge_index < cfg->edge_count; edge_index += 1) {
+			cfg->blocks[cfg->edges[edge_index].to].predecessor_count += 1;
+		}
+		
+		u32 offset = 0;
+		for (u32 block_index = 0; block_index < cfg->block_count; block_index += 1) {
+			Cfg_Block *block = &cfg->blocks[block_index];
+			block->first_predecessor = offset;
+			offset += block->predecessor_count;
+			block->predecessor_count = 0;
+		}
+		
+		for (u32 edge_index = 0; edge_index < cfg->edge_count; edge_index += 1) {
+			Cfg_Block *to = &cfg->blocks[cfg->edges[edge_index].to];
+			cfg->predecessors[to->first_predecessor + to->predecessor_count] = edge_index;
+			to->predecessor_count += 1;
+		}
+	}
+	
+	return ok;
+}
+
+//
+// Loops
+//
+
+typedef struct Dfs_Frame Dfs_Frame;
+struct Dfs_Frame {
+	u32 block;
+	u32 next_edge; // Index into the block's successors
+};
+
+// NOTE(ema): Iterative depth-first search from the entry blocks in address order, then from
+// any block that is still unvisited. `state` is 0 for unvisited, 1 while on the stack, 2 after.
+static bool find_back_edges(Cfg *cfg, u8 *state, Dfs_Frame *stack) {
+	bool ok = 1;
+	u32 loop_cap = 0;
+	
+	for (int pass = 0; ok && pass < 2; pass += 1) {
+		for (u32 root = 0; ok && root < cfg->block_count; root += 1) {
+			if (state[root] || (pass == 0 && !(cfg->blocks[root].flags & Block_Entry))) {
+				continue;
+			}
+			
+			u32 depth = 0;
+			stack[depth].block = root;
+			stack[depth].next_edge = 0;
+			depth += 1;
+			state[root] = 1;
+			
+			while (ok && depth > 0) {
+				Dfs_Frame *frame = &stack[depth - 1];
+				Cfg_Block *block = &cfg->blocks[frame->block];
+				
+				if (frame->next_edge < block->edge_count) {
+					Cfg_Edge *edge = &cfg->edges[block->first_edge + frame->next_edge];
+					frame->next_edge += 1;
+					
+					if (edge->kind != Edge_Call) {
+						if (state[edge->to] == 0) {
+							state[edge->to] = 1;
+							stack[depth].block = edge->to;
+							stack[depth].next_edge = 0;
+							depth += 1;
+						} else if (state[edge->to] == 1) {
+							ok = cfg_reserve((void **) &cfg->loops, &loop_cap, cfg->loop_count + 1, sizeof(Cfg_Loop));
+							if (ok) {
+								Cfg_Loop loop = { edge->to, edge->from, 0, 0 };
+								cfg->loops[cfg->loop_count++] = loop;
+								cfg->blocks[edge->to].flags |= Block_Loop;
+							}
+						}
+					}
+				} else {
+					state[frame->block] = 2;
+					depth -= 1;
+				}
+			}
+		}
+	}
+	
+	return ok;
+}
+
+// `stamp` marks the blocks already in the body of the current loop without clearing it
+// between loops; `work` needs room for every block.
+static bool build_loop_bodies(Cfg *cfg, u32 *stamp, u32 *work) {
+	bool ok = 1;
+	u32 loop_block_cap = 0;
+	
+	for (u32 loop_index = 0; ok && loop_index < cfg->loop_count; loop_index += 1) {
+		Cfg_Loop *loop = &cfg->loops[loop_index];
+		u32 loop_stamp = loop_index + 1;
+		
+		loop->first_block = cfg->loop_block_count;
+		ok = cfg_reserve((void **) &cfg->loop_blocks, &loop_block_cap, cfg->loop_block_count + 1, sizeof(u32));
+		if (ok) {
+			cfg->loop_blocks[cfg->loop_block_count++] = loop->header;
+			stamp[loop->header] = loop_stamp;
+		}
+		
+		u32 work_count = 0;
+		if (ok && stamp[loop->latch] != loop_stamp) {
+			stamp[loop->latch] = loop_stamp;
+			work[work_count++] = loop->latch;
+		}
+		
+		while (ok && work_count > 0) {
+			u32 block_index = work[--work_count];
+			ok = cfg_reserve((void **) &cfg->loop_blocks, &loop_block_cap, cfg->loop_block_count + 1, sizeof(u32));
+			if (ok) {
+				cfg->loop_blocks[cfg->loop_block_count++] = block_index;
+				
+				Cfg_Block *block = &cfg->blocks[block_index];
+				for (u32 idx = 0; idx < block->predecessor_count; idx += 1) {
+					Cfg_Edge *edge = &cfg->edges[cfg->predecessors[block->first_predecessor + idx]];
+					if (edge->kind != Edge_Call && stamp[edge->from] != loop_stamp) {
+						stamp[edge->from] = loop_stamp;
+						work[work_count++] = edge->from;
+					}
+				}
+			}
+		}
+		
+		loop->block_count = cfg->loop_block_count - loop->first_block;
+	}
+	
+	return ok;
+}
+
+//
+// Entry points
+//
+
+static void free_cfg(Cfg *cfg) {
+	free(cfg->blocks);
+	free(cfg->edges);
+	free(cfg->predecessors);
+	free(cfg->loops);
+	free(cfg->loop_blocks);
+	memset(cfg, 0, sizeof(*cfg));
+}
+
+static bool build_cfg(Cfg *cfg, u8 *code, u32 len, u32 *entries, u32 entry_count) {
+	memset(cfg, 0, sizeof(*cfg));
+	
+	u8  *marks = calloc(len ? len : 1, sizeof(u8));
+	u32 *queue = malloc(sizeof(u32) * (len ? len : 1));
+	bool ok = marks && queue;
+	
+	if (ok) {
+		mark_reachable_code(code, len, marks, queue, entries, entry_count);
+		ok = build_blocks(cfg, code, len, marks);
+	}
+	
+	if (ok) {
+		ok = build_predecessors(cfg);
+	}
+	
+	if (ok) {
+		for (u32 block_index = 0; block_index < cfg->block_count; block_index += 1) {
+			cfg->instruction_count += cfg->blocks[block_index].instruction_count;
+		}
+	}
+	
+	// NOTE(ema): Blocks start at distinct offsets, so `marks` and `queue` are long enough to be
+	// reused for the visit state and the work list of the loop search.
+	if (ok) {
+		memset(marks, 0, len);
+		Dfs_Frame *stack = malloc(sizeof(Dfs_Frame) * (cfg->block_count ? cfg->block_count : 1));
+		ok = stack && find_back_edges(cfg, marks, stack);
+		free(stack);
+	}
+	
+	if (ok) {
+		u32 *stamp = calloc(cfg->block_count ? cfg->block_count : 1, sizeof(u32));
+		ok = stamp && build_loop_bodies(cfg, stamp, queue);
+		free(stamp);
+	}
+	
+	free(marks);
+	free(queue);
+	
+	if (!ok) {
+		free_cfg(cfg);
+	}
+	
+	return ok;
+}
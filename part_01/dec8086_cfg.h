@@ -0,0 +1,89 @@
+#ifndef DEC8086_CFG_H
+#define DEC8086_CFG_H
+
+/*
+** Control-flow graph of a buffer of 8086 code (usually one 64KB code segment), built with the
+** table-driven decoder. Only the code reachable from the entry points is decoded.
+** Blocks, edges and loops are stored in flat arrays: the edges of a block are contiguous,
+** and so are its predecessors and the blocks of a loop.
+** dec8086_decode.h must be included first.
+*/
+
+//
+// Blocks and edges
+//
+
+enum {
+	Edge_Fallthrough, // Also the return address of a call
+	Edge_Taken,       // Jump, or the taken side of a conditional branch
+	Edge_Call,
+};
+
+enum {
+	Block_Entry    = 1 << 0, // Starts at an entry point or at the target of a call
+	Block_Return   = 1 << 1, // Ends with ret, retf or iret
+	Block_Halt     = 1 << 2,
+	Block_Indirect = 1 << 3, // Ends with (or contains a call through) a jump or call whose target isn't known
+	Block_Exit     = 1 << 4, // Has a branch outside the buffer (or a direct far one)
+	Block_Invalid  = 1 << 5, // Ends with bytes that don't decode
+	Block_Loop     = 1 << 6, // Header of at least one loop
+};
+
+typedef struct Cfg_Edge Cfg_Edge;
+struct Cfg_Edge {
+	u32 from;  // Block index
+	u32 to;    // Block index
+	u32 kind;
+};
+
+typedef struct Cfg_Block Cfg_Block;
+struct Cfg_Block {
+	u32 start;             // Offset in the buffer
+	u32 end;               // One past the last byte of the last instruction
+	u32 instruction_count;
+	u32 flags;
+	u32 first_edge;        // Successors are edges[first_edge .. first_edge + edge_count)
+	u32 edge_count;
+	u32 first_predecessor; // Predecessors are predecessors[first_predecessor .. + predecessor_count), as edge indices
+	u32 predecessor_count;
+};
+
+// NOTE(ema): One loop per back edge (an edge to a block that is still being visited by the
+// depth-first search), so a header with several back edges has several loops. The body is
+// the natural loop of the back edge: the header plus every block that reaches the latch
+// without going through the header. Call edges are not followed.
+typedef struct Cfg_Loop Cfg_Loop;
+struct Cfg_Loop {
+	u32 header;      // Block index
+	u32 latch;       // Block index of the source of the back edge
+	u32 first_block; // Body is loop_blocks[first_block .. first_block + block_count), header first
+	u32 block_count;
+};
+
+typedef struct Cfg Cfg;
+struct Cfg {
+	Cfg_Block *blocks; // Sorted by start
+	u32        block_count;
+	
+	Cfg_Edge  *edges;  // Grouped by source block
+	u32        edge_count;
+	u32       *predecessors;
+	
+	Cfg_Loop  *loops;
+	u32        loop_count;
+	u32       *loop_blocks;
+	u32        loop_block_count;
+	
+	u32        instruction_count;
+};
+
+// Decodes everything reachable from the entry points and fills `cfg`. Returns 0 if out of
+// memory. Targets outside the buffer are not followed. Blocks can overlap when a branch
+// lands in the middle of an instruction that was decoded from another path.
+static bool build_cfg(Cfg *cfg, u8 *code, u32 len, u32 *entries, u32 entry_count);
+static void free_cfg(Cfg *cfg);
+
+// Returns the index of the block that starts at `address`, or -1.
+static int find_block(Cfg *cfg, u32 address);
+
+#endif
@@ -0,0 +1,487 @@
+
+//
+// Names
+//
+
+#if DEC8086_NAMES
+
+#define DEC8086_MNEMONIC_NAME(name) #name,
+static char *mnemonic_names[Mnemonic_Count] = {
+	"",
+	DEC8086_MNEMONICS(DEC8086_MNEMONIC_NAME)
+};
+#undef DEC8086_MNEMONIC_NAME
+
+static char *reg8_names[8]  = { "al", "cl", "dl", "bl", "ah", "ch", "dh", "bh", };
+static char *reg16_names[8] = { "ax", "cx", "dx", "bx", "sp", "bp", "si", "di", };
+static char *seg_names[4]   = { "es", "cs", "ss", "ds", };
+
+static char *address_names[8] = {
+	"bx + si", "bx + di", "bp + si", "bp + di", "si", "di", "bp", "bx"
+};
+
+#endif
+
+//
+// Opcode tables
+//
+
+enum {
+	Form_Invalid,
+	Form_Prefix,
+	Form_None,
+	Form_RM_Reg,       // ModRM, D and W bits in the opcode
+	Form_RM_Imm,       // ModRM and an immediate sized by the W bit (and the S bit for 0x83)
+	Form_RM_Seg,       // ModRM with a segment register in the Reg field, D bit in the opcode
+	Form_Reg_RM,       // ModRM, always a word register destination and a memory source
+	Form_RM,           // ModRM with a single operand
+	Form_Shift,        // ModRM, count of 1 or CL
+	Form_Acc_Imm,
+	Form_Acc_Mem,
+	Form_Acc_Reg16,
+	Form_Reg_Imm,      // Register in the low 3 bits, W bit is bit 3
+	Form_Reg16,        // Register in the low 3 bits
+	Form_Seg,          // Segment register in bits 3-4
+	Form_String,
+	Form_Rel8,
+	Form_Rel16,
+	Form_Far,          // Offset then segment
+	Form_Imm8,
+	Form_Imm16,
+	Form_Ascii_Adjust, // Followed by the base, which is always 10 for code from an assembler
+	Form_Esc,
+	Form_In_Imm,
+	Form_Out_Imm,
+	Form_In_Dx,
+	Form_Out_Dx,
+};
+
+// NOTE(ema): When `group` is not 0, the mnemonic comes from the Reg field of the ModRM byte,
+// looked up in group_mnemonics.
+typedef struct Opcode_Info Opcode_Info;
+struct Opcode_Info {
+	u8 mnemonic;
+	u8 form;
+	u8 group;
+};
+
+static Opcode_Info opcode_table[256] = {
+	/* 0x00 */ {Mnemonic_add,     Form_RM_Reg,       0}, {Mnemonic_add,     Form_RM_Reg,       0}, {Mnemonic_add,     Form_RM_Reg,       0}, {Mnemonic_add,     Form_RM_Reg,       0},
+	/* 0x04 */ {Mnemonic_add,     Form_Acc_Imm,      0}, {Mnemonic_add,     Form_Acc_Imm,      0}, {Mnemonic_push,    Form_Seg,          0}, {Mnemonic_pop,     Form_Seg,          0},
+	/* 0x08 */ {Mnemonic_or,      Form_RM_Reg,       0}, {Mnemonic_or,      Form_RM_Reg,       0}, {Mnemonic_or,      Form_RM_Reg,       0}, {Mnemonic_or,      Form_RM_Reg,       0},
+	/* 0x0C */ {Mnemonic_or,      Form_Acc_Imm,      0}, {Mnemonic_or,      Form_Acc_Imm,      0}, {Mnemonic_push,    Form_Seg,          0}, {Mnemonic_pop,     Form_Seg,          0},
+	/* 0x10 */ {Mnemonic_adc,     Form_RM_Reg,       0}, {Mnemonic_adc,     Form_RM_Reg,       0}, {Mnemonic_adc,     Form_RM_Reg,       0}, {Mnemonic_adc,     Form_RM_Reg,       0},
+	/* 0x14 */ {Mnemonic_adc,     Form_Acc_Imm,      0}, {Mnemonic_adc,     Form_Acc_Imm,      0}, {Mnemonic_push,    Form_Seg,          0}, {Mnemonic_pop,     Form_Seg,          0},
+	/* 0x18 */ {Mnemonic_sbb,     Form_RM_Reg,       0}, {Mnemonic_sbb,     Form_RM_Reg,       0}, {Mnemonic_sbb,     Form_RM_Reg,       0}, {Mnemonic_sbb,     Form_RM_Reg,       0},
+	/* 0x1C */ {Mnemonic_sbb,     Form_Acc_Imm,      0}, {Mnemonic_sbb,     Form_Acc_Imm,      0}, {Mnemonic_push,    Form_Seg,          0}, {Mnemonic_pop,     Form_Seg,          0},
+	/* 0x20 */ {Mnemonic_and,     Form_RM_Reg,       0}, {Mnemonic_and,     Form_RM_Reg,       0}, {Mnemonic_and,     Form_RM_Reg,       0}, {Mnemonic_and,     Form_RM_Reg,       0},
+	/* 0x24 */ {Mnemonic_and,     Form_Acc_Imm,      0}, {Mnemonic_and,     Form_Acc_Imm,      0}, {Mnemonic_None,    Form_Prefix,       0}, {Mnemonic_daa,     Form_None,         0},
+	/* 0x28 */ {Mnemonic_sub,     Form_RM_Reg,       0}, {Mnemonic_sub,     Form_RM_Reg,       0}, {Mnemonic_sub,     Form_RM_Reg,       0}, {Mnemonic_sub,     Form_RM_Reg,       0},
+	/* 0x2C */ {Mnemonic_sub,     Form_Acc_Imm,      0}, {Mnemonic_sub,     Form_Acc_Imm,      0}, {Mnemonic_None,    Form_Prefix,       0}, {Mnemonic_das,     Form_None,         0},
+	/* 0x30 */ {Mnemonic_xor,     Form_RM_Reg,       0}, {Mnemonic_xor,     Form_RM_Reg,       0}, {Mnemonic_xor,     Form_RM_Reg,       0}, {Mnemonic_xor,     Form_RM_Reg,       0},
+	/* 0x34 */ {Mnemonic_xor,     Form_Acc_Imm,      0}, {Mnemonic_xor,     Form_Acc_Imm,      0}, {Mnemonic_None,    Form_Prefix,       0}, {Mnemonic_aaa,     Form_None,         0},
+	/* 0x38 */ {Mnemonic_cmp,     Form_RM_Reg,       0}, {Mnemonic_cmp,     Form_RM_Reg,       0}, {Mnemonic_cmp,     Form_RM_Reg,       0}, {Mnemonic_cmp,     Form_RM_Reg,       0},
+	/* 0x3C */ {Mnemonic_cmp,     Form_Acc_Imm,      0}, {Mnemonic_cmp,     Form_Acc_Imm,      0}, {Mnemonic_None,    Form_Prefix,       0}, {Mnemonic_aas,     Form_None,         0},
+	/* 0x40 */ {Mnemonic_inc,     Form_Reg16,        0}, {Mnemonic_inc,     Form_Reg16,        0}, {Mnemonic_inc,     Form_Reg16,        0}, {Mnemonic_inc,     Form_Reg16,        0},
+	/* 0x44 */ {Mnemonic_inc,     Form_Reg16,        0}, {Mnemonic_inc,     Form_Reg16,        0}, {Mnemonic_inc,     Form_Reg16,        0}, {Mnemonic_inc,     Form_Reg16,        0},
+	/* 0x48 */ {Mnemonic_dec,     Form_Reg16,        0}, {Mnemonic_dec,     Form_Reg16,        0}, {Mnemonic_dec,     Form_Reg16,        0}, {Mnemonic_dec,     Form_Reg16,        0},
+	/* 0x4C */ {Mnemonic_dec,     Form_Reg16,        0}, {Mnemonic_dec,     Form_Reg16,        0}, {Mnemonic_dec,     Form_Reg16,        0}, {Mnemonic_dec,     Form_Reg16,        0},
+	/* 0x50 */ {Mnemonic_push,    Form_Reg16,        0}, {Mnemonic_push,    Form_Reg16,        0}, {Mnemonic_push,    Form_Reg16,        0}, {Mnemonic_push,    Form_Reg16,        0},
+	/* 0x54 */ {Mnemonic_push,    Form_Reg16,        0}, {Mnemonic_push,    Form_Reg16,        0}, {Mnemonic_push,    Form_Reg16,        0}, {Mnemonic_push,    Form_Reg16,        0},
+	/* 0x58 */ {Mnemonic_pop,     Form_Reg16,        0}, {Mnemonic_pop,     Form_Reg16,        0}, {Mnemonic_pop,     Form_Reg16,        0}, {Mnemonic_pop,     Form_Reg16,        0},
+	/* 0x5C */ {Mnemonic_pop,     Form_Reg16,        0}, {Mnemonic_pop,     Form_Reg16,        0}, {Mnemonic_pop,     Form_Reg16,        0}, {Mnemonic_pop,     Form_Reg16,        0},
+	/* 0x60 */ {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_None,    Form_Invalid,      0},
+	/* 0x64 */ {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_None,    Form_Invalid,      0},
+	/* 0x68 */ {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_None,    Form_Invalid,      0},
+	/* 0x6C */ {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_None,    Form_Invalid,      0},
+	/* 0x70 */ {Mnemonic_jo,      Form_Rel8,         0}, {Mnemonic_jno,     Form_Rel8,         0}, {Mnemonic_jb,      Form_Rel8,         0}, {Mnemonic_jnb,     Form_Rel8,         0},
+	/* 0x74 */ {Mnemonic_je,      Form_Rel8,         0}, {Mnemonic_jne,     Form_Rel8,         0}, {Mnemonic_jbe,     Form_Rel8,         0}, {Mnemonic_ja,      Form_Rel8,         0},
+	/* 0x78 */ {Mnemonic_js,      Form_Rel8,         0}, {Mnemonic_jns,     Form_Rel8,         0}, {Mnemonic_jp,      Form_Rel8,         0}, {Mnemonic_jnp,     Form_Rel8,         0},
+	/* 0x7C */ {Mnemonic_jl,      Form_Rel8,         0}, {Mnemonic_jnl,     Form_Rel8,         0}, {Mnemonic_jle,     Form_Rel8,         0}, {Mnemonic_jg,      Form_Rel8,         0},
+	/* 0x80 */ {Mnemonic_None,    Form_RM_Imm,       1}, {Mnemonic_None,    Form_RM_Imm,       1}, {Mnemonic_None,    Form_RM_Imm,       1}, {Mnemonic_None,    Form_RM_Imm,       1},
+	/* 0x84 */ {Mnemonic_test,    Form_RM_Reg,       0}, {Mnemonic_test,    Form_RM_Reg,       0}, {Mnemonic_xchg,    Form_RM_Reg,       0}, {Mnemonic_xchg,    Form_RM_Reg,       0},
+	/* 0x88 */ {Mnemonic_mov,     Form_RM_Reg,       0}, {Mnemonic_mov,     Form_RM_Reg,       0}, {Mnemonic_mov,     Form_RM_Reg,       0}, {Mnemonic_mov,     Form_RM_Reg,       0},
+	/* 0x8C */ {Mnemonic_mov,     Form_RM_Seg,       0}, {Mnemonic_lea,     Form_Reg_RM,       0}, {Mnemonic_mov,     Form_RM_Seg,       0}, {Mnemonic_pop,     Form_RM,           0},
+	/* 0x90 */ {Mnemonic_nop,     Form_None,         0}, {Mnemonic_xchg,    Form_Acc_Reg16,    0}, {Mnemonic_xchg,    Form_Acc_Reg16,    0}, {Mnemonic_xchg,    Form_Acc_Reg16,    0},
+	/* 0x94 */ {Mnemonic_xchg,    Form_Acc_Reg16,    0}, {Mnemonic_xchg,    Form_Acc_Reg16,    0}, {Mnemonic_xchg,    Form_Acc_Reg16,    0}, {Mnemonic_xchg,    Form_Acc_Reg16,    0},
+	/* 0x98 */ {Mnemonic_cbw,     Form_None,         0}, {Mnemonic_cwd,     Form_None,         0}, {Mnemonic_call,    Form_Far,          0}, {Mnemonic_wait,    Form_None,         0},
+	/* 0x9C */ {Mnemonic_pushf,   Form_None,         0}, {Mnemonic_popf,    Form_None,         0}, {Mnemonic_sahf,    Form_None,         0}, {Mnemonic_lahf,    Form_None,         0},
+	/* 0xA0 */ {Mnemonic_mov,     Form_Acc_Mem,      0}, {Mnemonic_mov,     Form_Acc_Mem,      0}, {Mnemonic_mov,     Form_Acc_Mem,      0}, {Mnemonic_mov,     Form_Acc_Mem,      0},
+	/* 0xA4 */ {Mnemonic_movs,    Form_String,       0}, {Mnemonic_movs,    Form_String,       0}, {Mnemonic_cmps,    Form_String,       0}, {Mnemonic_cmps,    Form_String,       0},
+	/* 0xA8 */ {Mnemonic_test,    Form_Acc_Imm,      0}, {Mnemonic_test,    Form_Acc_Imm,      0}, {Mnemonic_stos,    Form_String,       0}, {Mnemonic_stos,    Form_String,       0},
+	/* 0xAC */ {Mnemonic_lods,    Form_String,       0}, {Mnemonic_lods,    Form_String,       0}, {Mnemonic_scas,    Form_String,       0}, {Mnemonic_scas,    Form_String,       0},
+	/* 0xB0 */ {Mnemonic_mov,     Form_Reg_Imm,      0}, {Mnemonic_mov,     Form_Reg_Imm,      0}, {Mnemonic_mov,     Form_Reg_Imm,      0}, {Mnemonic_mov,     Form_Reg_Imm,      0},
+	/* 0xB4 */ {Mnemonic_mov,     Form_Reg_Imm,      0}, {Mnemonic_mov,     Form_Reg_Imm,      0}, {Mnemonic_mov,     Form_Reg_Imm,      0}, {Mnemonic_mov,     Form_Reg_Imm,      0},
+	/* 0xB8 */ {Mnemonic_mov,     Form_Reg_Imm,      0}, {Mnemonic_mov,     Form_Reg_Imm,      0}, {Mnemonic_mov,     Form_Reg_Imm,      0}, {Mnemonic_mov,     Form_Reg_Imm,      0},
+	/* 0xBC */ {Mnemonic_mov,     Form_Reg_Imm,      0}, {Mnemonic_mov,     Form_Reg_Imm,      0}, {Mnemonic_mov,     Form_Reg_Imm,      0}, {Mnemonic_mov,     Form_Reg_Imm,      0},
+	/* 0xC0 */ {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_ret,     Form_Imm16,        0}, {Mnemonic_ret,     Form_None,         0},
+	/* 0xC4 */ {Mnemonic_les,     Form_Reg_RM,       0}, {Mnemonic_lds,     Form_Reg_RM,       0}, {Mnemonic_mov,     Form_RM_Imm,       0}, {Mnemonic_mov,     Form_RM_Imm,       0},
+	/* 0xC8 */ {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_retf,    Form_Imm16,        0}, {Mnemonic_retf,    Form_None,         0},
+	/* 0xCC */ {Mnemonic_int3,    Form_None,         0}, {Mnemonic_int,     Form_Imm8,         0}, {Mnemonic_into,    Form_None,         0}, {Mnemonic_iret,    Form_None,         0},
+	/* 0xD0 */ {Mnemonic_None,    Form_Shift,        2}, {Mnemonic_None,    Form_Shift,        2}, {Mnemonic_None,    Form_Shift,        2}, {Mnemonic_None,    Form_Shift,        2},
+	/* 0xD4 */ {Mnemonic_aam,     Form_Ascii_Adjust, 0}, {Mnemonic_aad,     Form_Ascii_Adjust, 0}, {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_xlat,    Form_None,         0},
+	/* 0xD8 */ {Mnemonic_esc,     Form_Esc,          0}, {Mnemonic_esc,     Form_Esc,          0}, {Mnemonic_esc,     Form_Esc,          0}, {Mnemonic_esc,     Form_Esc,          0},
+	/* 0xDC */ {Mnemonic_esc,     Form_Esc,          0}, {Mnemonic_esc,     Form_Esc,          0}, {Mnemonic_esc,     Form_Esc,          0}, {Mnemonic_esc,     Form_Esc,          0},
+	/* 0xE0 */ {Mnemonic_loopnz,  Form_Rel8,         0}, {Mnemonic_loopz,   Form_Rel8,         0}, {Mnemonic_loop,    Form_Rel8,         0}, {Mnemonic_jcxz,    Form_Rel8,         0},
+	/* 0xE4 */ {Mnemonic_in,      Form_In_Imm,       0}, {Mnemonic_in,      Form_In_Imm,       0}, {Mnemonic_out,     Form_Out_Imm,      0}, {Mnemonic_out,     Form_Out_Imm,      0},
+	/* 0xE8 */ {Mnemonic_call,    Form_Rel16,        0}, {Mnemonic_jmp,     Form_Rel16,        0}, {Mnemonic_jmp,     Form_Far,          0}, {Mnemonic_jmp,     Form_Rel8,         0},
+	/* 0xEC */ {Mnemonic_in,      Form_In_Dx,        0}, {Mnemonic_in,      Form_In_Dx,        0}, {Mnemonic_out,     Form_Out_Dx,       0}, {Mnemonic_out,     Form_Out_Dx,       0},
+	/* 0xF0 */ {Mnemonic_None,    Form_Prefix,       0}, {Mnemonic_None,    Form_Invalid,      0}, {Mnemonic_None,    Form_Prefix,       0}, {Mnemonic_None,    Form_Prefix,       0},
+	/* 0xF4 */ {Mnemonic_hlt,     Form_None,         0}, {Mnemonic_cmc,     Form_None,         0}, {Mnemonic_None,    Form_RM,           3}, {Mnemonic_None,    Form_RM,           3},
+	/* 0xF8 */ {Mnemonic_clc,     Form_None,         0}, {Mnemonic_stc,     Form_None,         0}, {Mnemonic_cli,     Form_None,         0}, {Mnemonic_sti,     Form_None,         0},
+	/* 0xFC */ {Mnemonic_cld,     Form_None,         0}, {Mnemonic_std,     Form_None,         0}, {Mnemonic_None,    Form_RM,           4}, {Mnemonic_None,    Form_RM,           5},
+};
+
+static u8 group_mnemonics[6][8] = {
+	{0},
+	{ Mnemonic_add, Mnemonic_or,   Mnemonic_adc,  Mnemonic_sbb, Mnemonic_and, Mnemonic_sub,  Mnemonic_xor,  Mnemonic_cmp,  },
+	{ Mnemonic_rol, Mnemonic_ror,  Mnemonic_rcl,  Mnemonic_rcr, Mnemonic_shl, Mnemonic_shr,  Mnemonic_None, Mnemonic_sar,  },
+	{ Mnemonic_test, Mnemonic_None, Mnemonic_not, Mnemonic_neg, Mnemonic_mul, Mnemonic_imul, Mnemonic_div,  Mnemonic_idiv, },
+	{ Mnemonic_inc, Mnemonic_dec,  Mnemonic_None, Mnemonic_None, Mnemonic_None, Mnemonic_None, Mnemonic_None, Mnemonic_None, },
+	{ Mnemonic_inc, Mnemonic_dec,  Mnemonic_call, Mnemonic_call, Mnemonic_jmp, Mnemonic_jmp,  Mnemonic_push, Mnemonic_None, },
+};
+
+// Number of displacement bytes that follow each ModRM byte.
+#define DISP_ROW_MOD0 0, 0, 0, 0, 0, 0, 2, 0
+#define DISP_ROW(n)   n, n, n, n, n, n, n, n
+#define DISP_MOD(row) row, row, row, row, row, row, row, row
+
+static u8 modrm_displacement_size[256] = {
+	DISP_MOD(DISP_ROW_MOD0),
+	DISP_MOD(DISP_ROW(1)),
+	DISP_MOD(DISP_ROW(2)),
+	DISP_MOD(DISP_ROW(0)),
+};
+
+#undef DISP_ROW_MOD0
+#undef DISP_ROW
+#undef DISP_MOD
+
+//
+// Decoder
+//
+
+static Decoded_Operand make_register_operand(u8 reg, bool wide) {
+	Decoded_Operand operand = { wide ? Arg_Reg16 : Arg_Reg8, reg, 0 };
+	return operand;
+}
+
+static Decoded_Operand make_immediate_operand(u8 *data, bool wide) {
+	Decoded_Operand operand = {0};
+	if (wide) {
+		operand.kind  = Arg_Imm16;
+		operand.value = (u16) data[0] | ((u16) data[1] << 8);
+	} else {
+		operand.kind  = Arg_Imm8;
+		operand.value = data[0];
+	}
+	return operand;
+}
+
+// `data` points to the displacement, which must already be known to fit.
+static Decoded_Operand make_rm_operand(u8 modrm, bool wide, u8 *data) {
+	Decoded_Operand operand = {0};
+	
+	u8 mod = modrm >> 6;
+	u8 rm  = modrm & 0x07;
+	
+	if (mod == 3) {
+		operand = make_register_operand(rm, wide);
+	} else if (mod == 0 && rm == 6) {
+		operand.kind  = Arg_Direct;
+		operand.value = (u16) data[0] | ((u16) data[1] << 8);
+	} else {
+		operand.reg = rm;
+		if (mod == 0) {
+			operand.kind = Arg_Mem;
+		} else if (mod == 1) {
+			operand.kind  = Arg_Mem_Disp8;
+			operand.value = (u16)(i16)(i8) data[0];
+		} else {
+			operand.kind  = Arg_Mem_Disp16;
+			operand.value = (u16) data[0] | ((u16) data[1] << 8);
+		}
+	}
+	
+	return operand;
+}
+
+static int decode_instruction(u8 *data, int len, Decoded_Instruction *inst) {
+	memset(inst, 0, sizeof(*inst));
+	
+	bool ok = 1;
+	int  idx = 0;
+	
+	u8 b0 = 0;
+	Opcode_Info info = {0};
+	
+	if (len > DEC8086_MAX_INSTRUCTION_SIZE) {
+		len = DEC8086_MAX_INSTRUCTION_SIZE;
+	}
+	
+	do {
+		if (idx < len) {
+			b0   = data[idx++];
+			info = opcode_table[b0];
+			
+			if (info.form == Form_Prefix) {
+				if      (b0 == 0xF0) inst->flags |= Prefix_Lock;
+				else if (b0 == 0xF2) inst->flags |= Prefix_Repne;
+				else if (b0 == 0xF3) inst->flags |= Prefix_Rep;
+				else {
+					inst->flags  |= Prefix_Segment;
+					inst->segment = (b0 >> 3) & 0x03;
+				}
+			}
+		} else {
+			ok = 0;
+		}
+	} while (ok && info.form == Form_Prefix);
+	
+	// NOTE(ema): Most opcodes keep the W bit in bit 0.
+	bool wide = (b0 & 0x01) != 0;
+	switch (info.form) {
+		case Form_RM_Seg:
+		case Form_Reg_RM:
+		case Form_Acc_Reg16:
+		case Form_Reg16:
+		case Form_Seg:
+		case Form_Rel16:
+		case Form_Far: {
+			wide = 1;
+		} break;
+		
+		case Form_Reg_Imm: {
+			wide = (b0 & 0x08) != 0;
+		} break;
+		
+		default: break;
+	}
+	
+	u8 mnemonic = info.mnemonic;
+	Decoded_Operand *operands = inst->operands;
+	
+	// All forms with a ModRM byte come first, so that the byte and the displacement are
+	// fetched and bounds-checked in one place.
+	u8 modrm = 0;
+	u8 reg   = 0;
+	bool has_modrm = (info.form == Form_RM_Reg || info.form == Form_RM_Imm || info.form == Form_RM_Seg ||
+					  info.form == Form_Reg_RM || info.form == Form_RM    || info.form == Form_Shift  ||
+					  info.form == Form_Esc);
+	if (ok && has_modrm) {
+		if (idx < len && idx + 1 + modrm_displacement_size[data[idx]] <= len) {
+			modrm = data[idx];
+			reg   = (modrm >> 3) & 0x07;
+			idx  += 1;
+			
+			if (info.group) {
+				mnemonic = group_mnemonics[info.group][reg];
+			}
+		} else {
+			ok = 0;
+		}
+	}
+	
+	// Bytes that follow the ModRM byte and displacement, or the opcode if there is no ModRM.
+	int imm_size = 0;
+	switch (info.form) {
+		case Form_RM_Imm:       imm_size = (wide && b0 != 0x83) ? 2 : 1; break;
+		case Form_RM:           imm_size = (mnemonic == Mnemonic_test) ? (wide ? 2 : 1) : 0; break;
+		case Form_Acc_Imm:      imm_size = wide ? 2 : 1; break;
+		case Form_Acc_Mem:      imm_size = 2; break;
+		case Form_Reg_Imm:      imm_size = wide ? 2 : 1; break;
+		case Form_Rel8:         imm_size = 1; break;
+		case Form_Rel16:        imm_size = 2; break;
+		case Form_Far:          imm_size = 4; break;
+		case Form_Imm8:         imm_size = 1; break;
+		case Form_Imm16:        imm_size = 2; break;
+		case Form_Ascii_Adjust: imm_size = 1; break;
+		case Form_In_Imm:       imm_size = 1; break;
+		case Form_Out_Imm:      imm_size = 1; break;
+		default: break;
+	}
+	
+	int disp_size = has_modrm ? modrm_displacement_size[modrm] : 0;
+	if (ok && idx + disp_size + imm_size > len) {
+		ok = 0;
+	}
+	
+	if (ok) {
+		Decoded_Operand rm = {0};
+		if (has_modrm) {
+			rm   = make_rm_operand(modrm, wide, data + idx);
+			idx += disp_size;
+		}
+		
+		u8 *imm = data + idx;
+		idx += imm_size;
+		
+		switch (info.form) {
+			case Form_Invalid:
+			case Form_Prefix: {
+				ok = 0;
+			} break;
+			
+			case Form_None:
+			case Form_String: break;
+			
+			case Form_RM_Reg: {
+				bool reg_is_destination = (b0 & 0x02) && mnemonic != Mnemonic_test && mnemonic != Mnemonic_xchg;
+				operands[reg_is_destination ? 0 : 1] = make_register_operand(reg, wide);
+				operands[reg_is_destination ? 1 : 0] = rm;
+			} break;
+			
+			case Form_RM_Imm: {
+				if (mnemonic == Mnemonic_mov && reg != 0) ok = 0;
+				
+				operands[0] = rm;
+				if (b0 == 0x83) {
+					operands[1].kind  = Arg_Imm8_Signed;
+					operands[1].value = (u16)(i16)(i8) imm[0];
+				} else {
+					operands[1] = make_immediate_operand(imm, wide);
+				}
+			} break;
+			
+			case Form_RM_Seg: {
+				if (reg > 3) ok = 0;
+				
+				Decoded_Operand seg = { Arg_Seg, reg, 0 };
+				operands[(b0 & 0x02) ? 0 : 1] = seg;
+				operands[(b0 & 0x02) ? 1 : 0] = rm;
+			} break;
+			
+			case Form_Reg_RM: {
+				if (modrm >> 6 == 3) ok = 0;
+				
+				operands[0] = make_register_operand(reg, wide);
+				operands[1] = rm;
+			} break;
+			
+			case Form_RM: {
+				if (info.group == 0 && reg != 0) ok = 0;
+				if (info.group == 5 && (reg == 3 || reg == 5)) {
+					inst->flags |= Decoded_Far;
+					if (modrm >> 6 == 3) ok = 0;
+				}
+				
+				operands[0] = rm;
+				if (mnemonic == Mnemonic_test) {
+					operands[1] = make_immediate_operand(imm, wide);
+				}
+			} break;
+			
+			case Form_Shift: {
+				operands[0] = rm;
+				if (b0 & 0x02) {
+					operands[1] = make_register_operand(1, 0); // cl
+				} else {
+					operands[1].kind  = Arg_Imm8;
+					operands[1].value = 1;
+				}
+			} break;
+			
+			case Form_Acc_Imm: {
+				operands[0] = make_register_operand(0, wide);
+				operands[1] = make_immediate_operand(imm, wide);
+			} break;
+			
+			case Form_Acc_Mem: {
+				Decoded_Operand address = { Arg_Direct, 0, (u16) imm[0] | ((u16) imm[1] << 8) };
+				operands[(b0 & 0x02) ? 0 : 1] = address;
+				operands[(b0 & 0x02) ? 1 : 0] = make_register_operand(0, wide);
+			} break;
+			
+			case Form_Acc_Reg16: {
+				operands[0] = make_register_operand(0, wide);
+				operands[1] = make_register_operand(b0 & 0x07, wide);
+			} break;
+			
+			case Form_Reg_Imm: {
+				operands[0] = make_register_operand(b0 & 0x07, wide);
+				operands[1] = make_immediate_operand(imm, wide);
+			} break;
+			
+			case Form_Reg16: {
+				operands[0] = make_register_operand(b0 & 0x07, wide);
+			} break;
+			
+			case Form_Seg: {
+				operands[0].kind = Arg_Seg;
+				operands[0].reg  = (b0 >> 3) & 0x03;
+			} break;
+			
+			case Form_Rel8: {
+				operands[0].kind  = Arg_Rel8;
+				operands[0].value = (u16)(i16)(i8) imm[0];
+			} break;
+			
+			case Form_Rel16: {
+				operands[0].kind  = Arg_Rel16;
+				operands[0].value = (u16) imm[0] | ((u16) imm[1] << 8);
+			} break;
+			
+			case Form_Far: {
+				operands[0].kind  = Arg_Far;
+				operands[0].value = (u16) imm[0] | ((u16) imm[1] << 8);
+				operands[1].kind  = Arg_Imm16;
+				operands[1].value = (u16) imm[2] | ((u16) imm[3] << 8);
+			} break;
+			
+			case Form_Imm8: {
+				operands[0] = make_immediate_operand(imm, 0);
+			} break;
+			
+			case Form_Imm16: {
+				operands[0] = make_immediate_operand(imm, 1);
+			} break;
+			
+			case Form_Ascii_Adjust: {
+				if (imm[0] != 10) {
+					operands[0] = make_immediate_operand(imm, 0);
+				}
+			} break;
+			
+			case Form_Esc: {
+				operands[0].kind  = Arg_Imm8;
+				operands[0].value = ((b0 & 0x07) << 3) | reg;
+				operands[1] = rm;
+			} break;
+			
+			case Form_In_Imm: {
+				operands[0] = make_register_operand(0, wide);
+				operands[1] = make_immediate_operand(imm, 0);
+			} break;
+			
+			case Form_Out_Imm: {
+				operands[0] = make_immediate_operand(imm, 0);
+				operands[1] = make_register_operand(0, wide);
+			} break;
+			
+			case Form_In_Dx: {
+				operands[0] = make_register_operand(0, wide);
+				operands[1] = make_register_operand(2, 1);
+			} break;
+			
+			case Form_Out_Dx: {
+				operands[0] = make_register_operand(2, 1);
+				operands[1] = make_register_operand(0, wide);
+			} break;
+		}
+	}
+	
+	if (ok && mnemonic == Mnemonic_None) {
+		ok = 0;
+	}
+	
+	int size = 0;
+	if (ok) {
+		inst->mnemonic = mnemonic;
+		inst->size     = (u8) idx;
+		if (wide) inst->flags |= Decoded_Wide;
+		
+		size = idx;
+	}
+	
+	return size;
+}
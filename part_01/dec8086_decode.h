@@ -0,0 +1,105 @@
+#ifndef DEC8086_DECODE_H
+#define DEC8086_DECODE_H
+
+/*
+** Table-driven decoder for the whole 8086 instruction set. Decoding only fills a small
+** struct; turning it into text is up to the caller.
+** The integer types (u8, u16, ...) must be defined before including this file.
+*/
+
+//
+// Mnemonics
+//
+
+#define DEC8086_MNEMONICS(X) \
+	X(mov) X(push) X(pop) X(xchg) X(in) X(out) X(xlat) X(lea) X(lds) X(les) \
+	X(lahf) X(sahf) X(pushf) X(popf) \
+	X(add) X(adc) X(inc) X(aaa) X(daa) X(sub) X(sbb) X(dec) X(neg) X(cmp) X(aas) X(das) \
+	X(mul) X(imul) X(aam) X(div) X(idiv) X(aad) X(cbw) X(cwd) \
+	X(not) X(shl) X(shr) X(sar) X(rol) X(ror) X(rcl) X(rcr) X(and) X(test) X(or) X(xor) \
+	X(movs) X(cmps) X(scas) X(lods) X(stos) \
+	X(call) X(jmp) X(ret) X(retf) \
+	X(je) X(jl) X(jle) X(jb) X(jbe) X(jp) X(jo) X(js) \
+	X(jne) X(jnl) X(jg) X(jnb) X(ja) X(jnp) X(jno) X(jns) \
+	X(loop) X(loopz) X(loopnz) X(jcxz) \
+	X(int) X(int3) X(into) X(iret) \
+	X(clc) X(cmc) X(stc) X(cld) X(std) X(cli) X(sti) X(hlt) X(wait) X(esc) X(nop)
+
+#define DEC8086_MNEMONIC_ENUM(name) Mnemonic_##name,
+enum {
+	Mnemonic_None,
+	DEC8086_MNEMONICS(DEC8086_MNEMONIC_ENUM)
+	Mnemonic_Count,
+};
+#undef DEC8086_MNEMONIC_ENUM
+
+//
+// Decoded instructions
+//
+
+enum {
+	Arg_None,
+	Arg_Reg8,         // reg: 0-7 in encoding order (al, cl, dl, bl, ah, ch, dh, bh)
+	Arg_Reg16,        // reg: 0-7 in encoding order (ax, cx, dx, bx, sp, bp, si, di)
+	Arg_Seg,          // reg: 0-3 (es, cs, ss, ds)
+	Arg_Mem,          // reg: the R/M field, no displacement
+	Arg_Mem_Disp8,    // reg: the R/M field, value: sign-extended displacement
+	Arg_Mem_Disp16,   // reg: the R/M field, value: displacement
+	Arg_Direct,       // value: address
+	Arg_Imm8,
+	Arg_Imm16,
+	Arg_Imm8_Signed,  // A byte sign-extended to a word (opcode 0x83)
+	Arg_Rel8,         // value: sign-extended displacement from the next instruction
+	Arg_Rel16,
+	Arg_Far,          // value: offset; the segment is in the other operand slot
+};
+
+enum {
+	Decoded_Wide   = 1 << 0,
+	Decoded_Far    = 1 << 1, // Indirect far call or jump
+	Prefix_Lock    = 1 << 2,
+	Prefix_Rep     = 1 << 3,
+	Prefix_Repne   = 1 << 4,
+	Prefix_Segment = 1 << 5,
+};
+
+typedef struct Decoded_Operand Decoded_Operand;
+struct Decoded_Operand {
+	u8  kind;
+	u8  reg;
+	u16 value;
+};
+
+typedef struct Decoded_Instruction Decoded_Instruction;
+struct Decoded_Instruction {
+	u8 mnemonic;
+	u8 size;    // In bytes, including prefixes
+	u8 flags;
+	u8 segment; // Segment override, if flags has Prefix_Segment
+	Decoded_Operand operands[2];
+};
+
+// NOTE(ema): The 8086 accepts any number of prefixes, but past this size the bytes are
+// treated as invalid (and end up as data), so that a caller can decode from a window that
+// always holds at least this many bytes.
+#define DEC8086_MAX_INSTRUCTION_SIZE 16
+
+// Returns the size of the instruction, or 0 if the bytes don't start a valid instruction or
+// the instruction doesn't fit in `len`.
+static int decode_instruction(u8 *data, int len, Decoded_Instruction *inst);
+
+// NOTE(ema): The name tables are only needed to print instructions. Define DEC8086_NAMES to 0
+// before including the decoder to leave them out.
+#if !defined(DEC8086_NAMES)
+#define DEC8086_NAMES 1
+#endif
+
+#if DEC8086_NAMES
+static char *mnemonic_names[Mnemonic_Count];
+static char *reg8_names[8];
+static char *reg16_names[8];
+static char *seg_names[4];
+static char *address_names[8]; // Effective address formulas by R/M field
+#endif
+
+#endif
@@ -2,6 +2,7 @@
 #include <memory.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "sim86_shared.h"
 #pragma comment (lib, "sim86_shared_debug.lib")
@@ -9,47 +10,41 @@
 #include "sim8086_base.h"
 #include "sim8086_memory.h"
 #include "sim8086_registers.h"
+#include "sim8086_clocks.h"
+#include "sim8086_profile.h"
+#include "sim8086_trace.h"
+#include "sim8086_frames.h"
+#include "sim8086_simulator.h"
+#include "sim8086_snapshot.h"
+#include "sim8086_checkpoint.h"
+#include "sim8086_batch.h"
+#include "sim8086_cache.h"
+#define DEC8086_NAMES 0 // The simulator prints with sim86_shared
+#include "dec8086_decode.h"
+#include "sim8086_fuzz.h"
+
+static void print_8086_instruction(FILE *out, instruction instr);
+static bool simulate_8086_instruction(instruction instr, register_file_t *registers, memory_t memory, execution_info_t *info);
 
 #include "sim8086_base.c"
 #include "sim8086_memory.c"
 #include "sim8086_registers.c"
+#include "sim8086_clocks.c"
+#include "sim8086_profile.c"
+#include "sim8086_snapshot.c"
+#include "sim8086_checkpoint.c"
+#include "sim8086_batch.c"
+#include "sim8086_trace.c"
+#include "sim8086_cache.c"
+#include "sim8086_frames.c"
+#include "dec8086_decode.c"
+#include "sim8086_fuzz.c"
 
-static void print_8086_instruction(instruction instr) {
-	char *mnemonic = (char *) Sim86_MnemonicFromOperationType(instr.Op);
-	printf("%s ", mnemonic);
-	
-	char *separator = "";
-	for (int operand_index = 0; operand_index < array_count(instr.Operands); operand_index += 1) {
-		instruction_operand *operand = &instr.Operands[operand_index];
-		
-		if (operand->Type != Operand_None) {
-			printf(separator);
-			separator = ", ";
-			
-			switch (operand->Type) {
-				case Operand_None: break;
-				
-				case Operand_Register: {
-					char *reg_name = (char *) Sim86_RegisterNameFromOperand(&operand->Register);
-					printf("%s", reg_name);
-				} break;
-				
-				case Operand_Immediate: {
-					immediate *imm = &operand->Immediate;
-					
-					char *imm_format = "%i";
-					i32 imm_value = imm->Value;
-					
-					if (imm->Flags & Immediate_RelativeJumpDisplacement) {
-						imm_format = "$%+i";
-						imm_value += 2;
-					}
-					
-					printf(imm_format, imm_value);
-				} break;
-			}
-		}
-	}
+static void print_8086_instruction(FILE *out, instruction instr) {
+	u8 text[256];
+	trace_writer_t writer = make_trace_writer(text, sizeof(text), -1);
+	format_8086_instruction(&writer, instr);
+	fwrite(writer.data, 1, writer.len, out);
 }
 
 //////////////////////////////////////////
@@ -102,27 +97,132 @@ static arithmetic_op_info arithmetic_op_info_from_op(operation_type op) {
 	return info;
 }
 
-static void print_cpu_flags(cpu_flags_t flags) {
-	static char flags_chars[] = {
-		[Flag_C_shift] = 'C',
-		[Flag_P_shift] = 'P',
-		[Flag_A_shift] = 'A',
-		[Flag_Z_shift] = 'Z',
-		[Flag_S_shift] = 'S',
-		[Flag_T_shift] = 'T',
-		[Flag_I_shift] = 'I',
-		[Flag_D_shift] = 'D',
-		[Flag_O_shift] = 'O',
-	};
-	for (int i = 0; i < array_count(flags_chars); i += 1) {
-		cpu_flags_t flag = 1 << i;
-		if (flag & flags) {
-			printf("%c", flags_chars[i]);
+// NOTE(ema): String instructions read from DS:SI (the segment can be overridden) and write to
+// ES:DI, moving SI and DI forward or backward depending on DF. With a rep prefix they repeat
+// until CX is 0, and cmps/scas also stop as soon as ZF doesn't match the prefix (rep stops
+// on a mismatch, repne on a match). Page 2-32 of the manual.
+// A forward rep movs/stos whose ranges don't wrap around the segment or the memory is done
+// in one go; so is a movs whose destination overlaps the source from below, because copying
+// forward element by element does the same as memmove then. Any other overlap (the classic
+// pattern fill) is stepped one element at a time.
+// For cmps/scas, returns 1 and the operands of the last comparison, for the flags.
+static bool simulate_string_instruction(instruction instr, register_file_t *registers, memory_t memory, execution_info_t *info, u32 *compared0, u32 *compared1) {
+	bool compares = (instr.Op == Op_cmps || instr.Op == Op_scas);
+	bool rep   = (instr.Flags & (Inst_Rep | Inst_RepNE)) != 0;
+	bool repne = (instr.Flags & Inst_RepNE) != 0;
+	bool wide  = (instr.Flags & Inst_Wide) != 0;
+	bool down  = (registers->flags & Flag_D) != 0;
+	
+	u32 size       = wide ? 2 : 1;
+	u32 width_mask = wide ? 0xffff : 0xff;
+	u16 step       = down ? (u16)(0 - size) : (u16)size;
+	
+	u16 source_segment = registers->ds;
+	if (instr.Flags & Inst_Segment) {
+		source_segment = read_register_u16(registers, instr.SegmentOverride);
+	}
+	
+	info->unaligned = wide && ((registers->si | registers->di) & 1);
+	
+	u32 remaining = rep ? registers->cx : 1;
+	
+	bool can_bulk = rep && !down && remaining > 1 && (instr.Op == Op_movs || instr.Op == Op_stos);
+#if MEMORY_TRACE
+	can_bulk = can_bulk && !memory.trace;
+#endif
+
+	if (can_bulk) {
+		u32 byte_count = remaining * size;
+		
+		pointer_variable_t source_pointer = {source_segment, registers->si};
+		pointer_variable_t dest_pointer   = {registers->es, registers->di};
+		physical_address_t source = physical_address_from_pointer_variable(source_pointer) & memory.mask;
+		physical_address_t dest   = physical_address_from_pointer_variable(dest_pointer) & memory.mask;
+		
+		bool in_segment = registers->di + byte_count <= 0x10000 && is_contiguous_range(memory, dest, byte_count);
+		if (instr.Op == Op_movs) {
+			in_segment = in_segment && registers->si + byte_count <= 0x10000 && is_contiguous_range(memory, source, byte_count);
+			
+			bool overlaps_ahead = dest > source && dest < source + byte_count;
+			if (in_segment && !overlaps_ahead) {
+				memory_move(memory, dest, source, byte_count);
+				registers->si += (u16)byte_count;
+				remaining = 0;
+			}
+		} else if (in_segment) {
+			memory_fill(memory, dest, registers->ax & width_mask, size, remaining);
+			remaining = 0;
+		}
+		
+		if (remaining == 0) {
+			registers->di += (u16)byte_count;
+			registers->cx = 0;
+			info->repetitions = byte_count / size;
+		}
+	}
+	
+	while (remaining) {
+		pointer_variable_t source_pointer = {source_segment, registers->si};
+		pointer_variable_t dest_pointer   = {registers->es, registers->di};
+		physical_address_t source = physical_address_from_pointer_variable(source_pointer);
+		physical_address_t dest   = physical_address_from_pointer_variable(dest_pointer);
+		
+		switch (instr.Op) {
+			case Op_movs: {
+				memory_write_n(memory, dest, memory_read_u16(memory, source) & width_mask, size);
+				registers->si += step;
+				registers->di += step;
+			} break;
+			
+			case Op_cmps: {
+				*compared0 = memory_read_u16(memory, source) & width_mask;
+				*compared1 = memory_read_u16(memory, dest) & width_mask;
+				registers->si += step;
+				registers->di += step;
+			} break;
+			
+			case Op_scas: {
+				*compared0 = registers->ax & width_mask;
+				*compared1 = memory_read_u16(memory, dest) & width_mask;
+				registers->di += step;
+			} break;
+			
+			case Op_lods: {
+				u16 value = memory_read_u16(memory, source);
+				if (wide) {
+					registers->ax = value;
+				} else {
+					registers->al = (u8)value;
+				}
+				registers->si += step;
+			} break;
+			
+			case Op_stos: {
+				memory_write_n(memory, dest, registers->ax & width_mask, size);
+				registers->di += step;
+			} break;
+			
+			default: break;
+		}
+		
+		remaining -= 1;
+		if (rep) {
+			registers->cx -= 1;
+			info->repetitions += 1;
+			
+			bool equal = *compared0 == *compared1;
+			if (compares && equal == repne) {
+				remaining = 0;
+			}
 		}
 	}
+	
+	// NOTE(ema): A rep with CX already 0 doesn't compare anything, so the flags stay as they are.
+	bool result = compares && (!rep || info->repetitions > 0);
+	return result;
 }
 
-static bool simulate_8086_instruction(instruction instr, register_file_t *registers, memory_t memory) {
+static bool simulate_8086_instruction(instruction instr, register_file_t *registers, memory_t memory, execution_info_t *info) {
 	bool should_halt = 0;
 	
 	typedef struct operand_access_t operand_access_t;
@@ -135,6 +235,10 @@ static bool simulate_8086_instruction(instruction instr, register_file_t *regist
 	
 	operand_access_t accesses[2] = {0};
 	
+	// NOTE(ema): Same fast path as the fetch in step_8086(): when every segment register is 0,
+	// whichever segment the operand uses, its physical address is just the offset.
+	bool flat_segments = (registers->es | registers->cs | registers->ss | registers->ds) == 0;
+	
 	for (int operand_index = 0; operand_index < array_count(instr.Operands); operand_index += 1) {
 		instruction_operand *operand = &instr.Operands[operand_index];
 		
@@ -144,7 +248,11 @@ static bool simulate_8086_instruction(instruction instr, register_file_t *regist
 				
 				case Operand_Memory: {
 					accesses[operand_index].memory  = memory;
-					accesses[operand_index].pointer = pointer_from_components(operand->Address, infer_default_segment(operand), registers);
+					if (flat_segments) {
+						accesses[operand_index].pointer.offset = offset_from_components(operand->Address, registers);
+					} else {
+						accesses[operand_index].pointer = pointer_from_components(operand->Address, infer_default_segment(operand), registers);
+					}
 					
 					accesses[operand_index].unaligned |= (accesses[operand_index].pointer.offset & 1);
 					accesses[operand_index].value   = memory_read_u16(memory, physical_address_from_pointer_variable(accesses[operand_index].pointer));
@@ -173,6 +281,8 @@ static bool simulate_8086_instruction(instruction instr, register_file_t *regist
 	
 	u32 aux_sign_bit = 1 << 3;
 	
+	info->unaligned = (width == 2) && (accesses[0].unaligned || accesses[1].unaligned);
+	
 	bool cf_set = (registers->flags & Flag_C) != 0;
 	bool pf_set = (registers->flags & Flag_P) != 0;
 	bool af_set = (registers->flags & Flag_A) != 0;
@@ -211,7 +321,7 @@ static bool simulate_8086_instruction(instruction instr, register_file_t *regist
 		} break;
 		
 		case Op_adc: {
-			u32 result = (v0 & width_mask) + (v1 & width_mask) + cf_set ? 1 : 0;
+			u32 result = (v0 & width_mask) + (v1 & width_mask) + (cf_set ? 1 : 0);
 			memory_write_n(op0.memory, physical_address_from_pointer_variable(op0.pointer), (u16)result, width);
 			
 			cf_set = (((v0 & v1) | ((v0 ^ v1) & ~result)) & sign_bit) != 0;
@@ -248,7 +358,7 @@ static bool simulate_8086_instruction(instruction instr, register_file_t *regist
 		} break;
 		
 		case Op_sbb: {
-			u32 result = (v0 & width_mask) - (v1 & width_mask) - cf_set ? 1 : 0;
+			u32 result = (v0 & width_mask) - (v1 & width_mask) - (cf_set ? 1 : 0);
 			memory_write_n(op0.memory, physical_address_from_pointer_variable(op0.pointer), (u16)result, width);
 			
 			cf_set = (((v1 & result) | ((v1 ^ result) & ~v0)) & sign_bit) != 0;
@@ -286,6 +396,7 @@ static bool simulate_8086_instruction(instruction instr, register_file_t *regist
 		} break;
 		
 		case Op_cmp: {
+			do_compare:;
 			u32 result = (v0 & width_mask) - (v1 & width_mask);
 			
 			cf_set = (((v1 & result) | ((v1 ^ result) & ~v0)) & sign_bit) != 0;
@@ -394,6 +505,8 @@ static bool simulate_8086_instruction(instruction instr, register_file_t *regist
 		} break;
 		
 		case Op_shl: {
+			info->shift_count = v1 & 0xFF;
+			
 			u32 result = (v0 & width_mask) << (v1 & width_mask);
 			memory_write_n(op0.memory, physical_address_from_pointer_variable(op0.pointer), (u16)result, width);
 			
@@ -403,6 +516,8 @@ static bool simulate_8086_instruction(instruction instr, register_file_t *regist
 		} break;
 		
 		case Op_shr: {
+			info->shift_count = v1 & 0xFF;
+			
 			u32 result = (v0 & width_mask) >> (v1 & width_mask);
 			memory_write_n(op0.memory, physical_address_from_pointer_variable(op0.pointer), (u16)result, width);
 			
@@ -411,6 +526,84 @@ static bool simulate_8086_instruction(instruction instr, register_file_t *regist
 			}
 		} break;
 		
+		case Op_push: {
+			info->unaligned |= registers->sp & 1;
+			push_u16(registers, memory, (u16)v0);
+		} break;
+		
+		case Op_pop: {
+			info->unaligned |= registers->sp & 1;
+			u16 value = pop_u16(registers, memory);
+			memory_write_n(op0.memory, physical_address_from_pointer_variable(op0.pointer), value, 2);
+		} break;
+		
+		case Op_pushf: {
+			info->unaligned = registers->sp & 1;
+			push_u16(registers, memory, registers->flags);
+		} break;
+		
+		case Op_popf: {
+			info->unaligned = registers->sp & 1;
+			cpu_flags_t value = pop_u16(registers, memory);
+			
+			cf_set = (value & Flag_C) != 0;
+			pf_set = (value & Flag_P) != 0;
+			af_set = (value & Flag_A) != 0;
+			zf_set = (value & Flag_Z) != 0;
+			sf_set = (value & Flag_S) != 0;
+			tf_set = (value & Flag_T) != 0;
+			if_set = (value & Flag_I) != 0;
+			df_set = (value & Flag_D) != 0;
+			of_set = (value & Flag_O) != 0;
+		} break;
+		
+		// NOTE(ema): For control transfers, a direct operand is a displacement from the next
+		// instruction, an indirect one (register or memory) is the new IP. Far transfers also
+		// change CS: a direct one encodes the segment first, an indirect one reads it from the
+		// word after the new IP in memory.
+		
+		case Op_call: {
+			info->unaligned |= registers->sp & 1;
+			
+			if (instr.Flags & Inst_Far) {
+				push_u16(registers, memory, registers->cs);
+			}
+			push_u16(registers, memory, registers->ip);
+		} goto do_transfer;
+		
+		case Op_jmp: {
+			do_transfer:;
+			bool is_far = (instr.Flags & Inst_Far) != 0;
+			
+			if (is_far && instr.Operands[1].Type == Operand_Immediate) {
+				registers->cs = (u16)v0;
+				registers->ip = (u16)v1;
+			} else if (is_far) {
+				physical_address_t address = physical_address_from_pointer_variable(op0.pointer);
+				registers->ip = (u16)v0;
+				registers->cs = memory_read_u16(memory, address + 2);
+			} else if (instr.Operands[0].Type == Operand_Immediate) {
+				registers->ip += (u16)v0;
+			} else {
+				registers->ip = (u16)v0;
+			}
+		} break;
+		
+		case Op_ret:
+		case Op_retf: {
+			info->unaligned |= registers->sp & 1;
+			
+			registers->ip = pop_u16(registers, memory);
+			if (instr.Op == Op_retf) {
+				registers->cs = pop_u16(registers, memory);
+			}
+			
+			// NOTE(ema): "ret n" also discards n bytes of arguments from the stack.
+			if (instr.Operands[0].Type == Operand_Immediate) {
+				registers->sp += (u16)v0;
+			}
+		} break;
+		
 #if 1
 		case Op_je: {
 			u16 flag_expr = registers->as_words[Register_flags] >> Flag_Z_shift & 1;
@@ -521,6 +714,7 @@ static bool simulate_8086_instruction(instruction instr, register_file_t *regist
 			jump_condition_true = registers->as_words[Register_c] == 0;
 			
 			do_jump:;
+			info->jump_taken = jump_condition_true;
 			if (jump_condition_true) {
 				i8 offset = (i8) instr.Operands[0].Immediate.Value;
 				registers->as_words[Register_ip] += offset;
@@ -528,12 +722,31 @@ static bool simulate_8086_instruction(instruction instr, register_file_t *regist
 		} break;
 #endif
 		
+		case Op_movs:
+		case Op_cmps:
+		case Op_scas:
+		case Op_lods:
+		case Op_stos: {
+			if (simulate_string_instruction(instr, registers, memory, info, &v0, &v1)) {
+				goto do_compare;
+			}
+		} break;
+		
+		case Op_clc: { cf_set = 0;       } break;
+		case Op_stc: { cf_set = 1;       } break;
+		case Op_cmc: { cf_set = !cf_set; } break;
+		case Op_cld: { df_set = 0;       } break;
+		case Op_std: { df_set = 1;       } break;
+		case Op_cli: { if_set = 0;       } break;
+		case Op_sti: { if_set = 1;       } break;
+		
 		case Op_hlt: {
 			should_halt = 1;
 		} break;
 		
 		default: {
-			fprintf(stderr, "Error: Unimplemented instruction.\n");
+			info->unimplemented = 1;
+			should_halt = 1;
 		} break;
 	}
 	
@@ -555,83 +768,272 @@ static bool simulate_8086_instruction(instruction instr, register_file_t *regist
 
 static_assert(-4 >> 1 == -2, ">> doesn't do sign extension");
 
-static void simulate_8086(memory_t memory, u32 code_offset, u32 code_len, bool exec, bool show) {
-	u8 *code = memory.bytes.data + code_offset;
+static char *get_fault_name(fault_t fault) {
+	static char *fault_names[] = {
+		[Fault_None]                      = "none",
+		[Fault_Unrecognized_Instruction]  = "unrecognized_instruction",
+		[Fault_Unimplemented_Instruction] = "unimplemented_instruction",
+	};
+	
+	char *result = (fault < array_count(fault_names)) ? fault_names[fault] : "unknown";
+	return result;
+}
+
+static void set_fault(simulator_t *sim, fault_t fault, u16 ip) {
+	sim->stopped = 1;
+	sim->faulted = 1;
+	sim->fault   = fault;
+	sim->fault_address.base   = sim->registers.cs;
+	sim->fault_address.offset = ip;
+}
+
+static simulator_t make_simulator(memory_t memory, u32 code_offset, u32 code_len) {
+	simulator_t sim = {0};
+	sim.memory      = memory;
+	sim.code_offset = code_offset;
+	sim.code_len    = code_len;
 	
-	register_file_t registers = {0};
+	sim.registers.cs = (u16)(code_offset >> 4);
+	sim.registers.ip = 0;
 	
-	registers.ip = 0;
-	while (registers.ip < code_len) {
-		instruction decoded = {0};
-		Sim86_Decode8086Instruction(code_len - registers.ip, code + registers.ip, &decoded);
-		if (decoded.Op) {
-			register_file_t old_registers = {0};
-			if (show) {
-				old_registers = registers;
-			}
-			
-			registers.ip += (u16)decoded.Size;
+	return sim;
+}
+
+// Decodes and (if options.exec) executes the instruction at CS:IP. Returns 0 when the
+// simulation is over because of a halt, the end of the code, or an unrecognized instruction.
+static bool step_8086(simulator_t *sim, simulation_options_t options) {
+	bool exec = options.exec;
+	bool show = options.show;
+	
+	register_file_t *registers = &sim->registers;
+	memory_t memory = sim->memory;
+	
+	if (!sim->stopped) {
+		// NOTE(ema): Fast path for the common case of programs that never touch CS, where the
+		// physical address of the instruction is just IP.
+		physical_address_t fetch_address = registers->ip;
+		if (registers->cs != 0) {
+			pointer_variable_t instruction_pointer = {registers->cs, registers->ip};
+			fetch_address = physical_address_from_pointer_variable(instruction_pointer) & memory.mask;
+		}
+		
+		u32 code_index = fetch_address - sim->code_offset;
+		if (code_index < sim->code_len) {
+			u8 *code = memory.bytes.data + sim->code_offset;
 			
-			if (show) {
-				print_8086_instruction(decoded);
-			}
-			if (exec) {
-				if (show) {
-					printf(" ; ");
-				}
+			instruction decoded = {0};
+			Sim86_Decode8086Instruction(sim->code_len - code_index, code + code_index, &decoded);
+			if (decoded.Op) {
+				trace_step_t step = {0};
+				step.instr         = decoded;
+				step.executed      = exec;
+				step.show_clocks   = options.clocks;
+				step.old_registers = *registers;
 				
-				bool halt = simulate_8086_instruction(decoded, &registers, memory);
+				u16 instruction_ip = registers->ip;
+				registers->ip += (u16)decoded.Size;
+				sim->instruction_count += 1;
 				
-				if (show) {
-					register_file_t new_registers = registers;
+				if (exec) {
+					simulate_instruction_proc_t *engine = options.engine ? options.engine : simulate_8086_instruction;
 					
-					for (int reg_index = 0; reg_index < Register_Count; reg_index += 1) {
-						if (reg_index != Register_flags && old_registers.as_words[reg_index] != new_registers.as_words[reg_index]) {
-							register_access reg = {reg_index, 0, 2};
-							printf("%s: 0x%x->0x%x, ", Sim86_RegisterNameFromOperand(&reg),
-								   old_registers.as_words[reg_index], new_registers.as_words[reg_index]);
+					execution_info_t info = {0};
+					bool halt = engine(decoded, registers, memory, &info);
+					
+					// NOTE(ema): Like an instruction that doesn't decode, it stops the simulation
+					// at the instruction, without counting it.
+					if (info.unimplemented) {
+						registers->ip = instruction_ip;
+						sim->instruction_count -= 1;
+						set_fault(sim, Fault_Unimplemented_Instruction, instruction_ip);
+					} else {
+						// NOTE(ema): Checkpoints save the total, and a run resumed from one that has it keeps
+						// counting, since it may be asked for later.
+						if (options.clocks || options.profile || options.frames || options.checkpoint_interval || sim->clock_count) {
+							step.clocks = estimate_instruction_clocks(decoded, info, options.bus);
+							sim->clock_count += step.clocks.total;
+							
+							if (options.profile) {
+								profile_record_instruction(options.profile, code_index, decoded, step.clocks.total);
+							}
+						}
+						
+						if (halt) sim->stopped = 1;
+						
+						if (options.frames && options.frames->interval && sim->instruction_count % options.frames->interval == 0) {
+							take_frame(options.frames, memory, sim->instruction_count, sim->clock_count);
+						}
+						
+						if (options.checkpoint_interval && sim->instruction_count % options.checkpoint_interval == 0) {
+							save_checkpoint(sim, options.bus, CHECKPOINT_FILE_NAME);
 						}
 					}
+				}
+				
+				if ((show || options.binary_trace) && !sim->faulted) {
+					step.clock_count   = sim->clock_count;
+					step.new_registers = *registers;
+					step.stopped       = sim->stopped;
 					
-					cpu_flags_t old_flags = old_registers.as_words[Register_flags];
-					cpu_flags_t new_flags = new_registers.as_words[Register_flags];
-					
-					if (old_flags != new_flags) {
-						printf("flags: ");
-						print_cpu_flags(old_flags);
-						printf("->");
-						print_cpu_flags(new_flags);
+					if (show) {
+						trace_step_text(options.trace, &step);
+					}
+					if (options.binary_trace) {
+						trace_step_binary(options.binary_trace, &step);
 					}
 				}
-				
-				if (halt) break;
-			}
-			
-			if (show) {
-				printf("\n");
+			} else {
+				set_fault(sim, Fault_Unrecognized_Instruction, registers->ip);
 			}
 		} else {
-			fprintf(stderr, "Unrecognized instruction\n");
-			break;
+			sim->stopped = 1;
 		}
 	}
 	
-	printf("\nFinal registers:\n");
+	return !sim->stopped;
+}
+
+static void print_register_file(register_file_t *registers) {
 	for (int reg_index = 1; reg_index < Register_Count; reg_index += 1) {
 		if (reg_index != Register_flags) {
 			register_access reg = {reg_index, 0, 2};
 			printf("\t%s: 0x%x (%i)\n", Sim86_RegisterNameFromOperand(&reg),
-				   registers.as_words[reg_index], registers.as_words[reg_index]);
+				   registers->as_words[reg_index], registers->as_words[reg_index]);
 		}
 	}
 	
 	printf("    flags: ");
-	print_cpu_flags(registers.as_words[Register_flags]);
+	print_cpu_flags(stdout, registers->as_words[Register_flags]);
 	printf("\n");
+}
+
+static void print_simulation_results(simulator_t *sim, simulation_options_t options) {
+	if (sim->faulted) {
+		fprintf(stderr, "Error: %s at %04x:%04x\n", get_fault_name(sim->fault),
+				sim->fault_address.base, sim->fault_address.offset);
+	}
+	
+	printf("\nFinal registers:\n");
+	print_register_file(&sim->registers);
+	
+	if (options.clocks) {
+		printf("\nTotal clocks (%s): %llu\n", (options.bus == Bus_8088) ? "8088" : "8086", sim->clock_count);
+	}
 	
 	printf("\n");
 }
 
+static void simulate_8086(simulator_t *sim, simulation_options_t options) {
+	while (step_8086(sim, options));
+	
+	if (options.trace) flush_trace(options.trace);
+	print_simulation_results(sim, options);
+}
+
+//////////////////////////////////////////
+// Interactive debugging
+
+// Brings the simulation to the state it had after `target` instructions. Going backwards
+// restores the closest snapshot and silently executes forward from there.
+static void run_to_instruction(simulator_t *sim, snapshot_history_t *history, simulation_options_t options, u64 target) {
+	if (target < sim->instruction_count) {
+		restore_snapshot(history, sim, find_snapshot_before(history, target));
+	}
+	
+	while (sim->instruction_count < target && step_8086(sim, options)) {
+		if (sim->instruction_count % history->interval == 0) {
+			take_snapshot(history, sim);
+		}
+	}
+}
+
+static void debug_8086(simulator_t *sim, simulation_options_t options) {
+	snapshot_history_t history = {0};
+	if (start_snapshot_history(&history, sim, SNAPSHOT_INTERVAL)) {
+		simulation_options_t quiet = options;
+		quiet.exec    = 1;
+		quiet.show    = 0;
+		quiet.profile = 0;
+		
+		simulation_options_t verbose = quiet;
+		verbose.show = 1;
+		
+		printf("Commands: s [n] (step), b [n] (step back), r <n> (run to instruction n), c (continue), p (print registers), q (quit)\n");
+		
+		char line[256];
+		for (bool quit = 0; !quit;) {
+			if (options.trace) flush_trace(options.trace);
+			printf("[%llu%s] > ", sim->instruction_count, sim->stopped ? ", stopped" : "");
+			fflush(stdout);
+			
+			if (!fgets(line, sizeof(line), stdin)) break;
+			
+			char command = 0;
+			u64  count   = 1;
+			int  parsed  = sscanf(line, " %c %llu", &command, &count);
+			
+			switch (parsed > 0 ? command : 0) {
+				case 's': {
+					for (u64 step_index = 0; step_index < count; step_index += 1) {
+						if (sim->stopped) break;
+						run_to_instruction(sim, &history, verbose, sim->instruction_count + 1);
+					}
+				} break;
+				
+				case 'b': {
+					u64 target = (count < sim->instruction_count) ? sim->instruction_count - count : 0;
+					run_to_instruction(sim, &history, quiet, target);
+				} break;
+				
+				case 'r': {
+					if (parsed == 2) {
+						run_to_instruction(sim, &history, quiet, count);
+					} else {
+						printf("Usage: r <instruction number>\n");
+					}
+				} break;
+				
+				case 'c': {
+					run_to_instruction(sim, &history, quiet, ~0ULL);
+				} break;
+				
+				case 'p': {
+					print_register_file(&sim->registers);
+				} break;
+				
+				case 'q': {
+					quit = 1;
+				} break;
+				
+				default: {
+					printf("Unknown command\n");
+				} break;
+			}
+		}
+		
+		free_snapshot_history(&history, sim);
+	} else {
+		fprintf(stderr, "Out of memory");
+	}
+}
+
+// Whether argv[i] is the value of the option before it, rather than a file.
+static bool is_option_value(char **argv, int i) {
+	bool result = 0;
+	if (i > 1) {
+		char *option = argv[i - 1];
+		result = (memcmp(option, str_expand_pfirst("-seed")) == 0 ||
+				  memcmp(option, str_expand_pfirst("-engine")) == 0 ||
+				  memcmp(option, str_expand_pfirst("-cache")) == 0 ||
+				  memcmp(option, str_expand_pfirst("-frame")) == 0 ||
+				  memcmp(option, str_expand_pfirst("-frame_every")) == 0 ||
+				  memcmp(option, str_expand_pfirst("-checkpoint")) == 0 ||
+				  memcmp(option, str_expand_pfirst("-resume")) == 0 ||
+				  (memcmp(option, str_expand_pfirst("-fuzz")) == 0 && argv[i][0] >= '0' && argv[i][0] <= '9'));
+	}
+	return result;
+}
+
 int main(int argc, char **argv) {
 	bool ok = 1;
 	
@@ -642,8 +1044,9 @@ int main(int argc, char **argv) {
 		ok = 0;
 	}
 	
+	// NOTE(ema): The whole 1MB that can be addressed with 20 bits.
 	buffer_t bytes = {0};
-	bytes.len = 1024 * 64;
+	bytes.len = 1024 * 1024;
 	bytes.data = calloc(1, bytes.len);
 	
 	memory_t memory = make_memory(bytes, 20);
@@ -651,17 +1054,37 @@ int main(int argc, char **argv) {
 	u32 code_len = 0;
 	
 	char *file_name = "";
-	bool exec = 0;
 	bool dump = 0;
-	bool show = 0;
+	bool profile = 0;
+	bool profile_csv = 0;
+	bool debug = 0;
+	bool batch_mode = 0;
+	bool binary_trace = 0;
+	bool expand = 0;
+	bool fuzz_mode = 0;
+	u32  fuzz_cases = 100000;
+	u64  fuzz_seed = read_os_timer();
+	char *fuzz_engine = "reference";
+	batch_t batch = {0};
+	simulation_options_t options = {0};
+	
+	frame_writer_t frames = {0};
+	bool frames_requested = 0;
+	
+	char *resume_name = 0;
+	checkpoint_t checkpoint = {0};
+	
+#if MEMORY_TRACE
+	memory_trace_t memory_trace = {0};
+#endif
 	
 	if (ok) {
 		// NOTE(ema): This command-line parsing is really stupid and it only keeps the last string
 		// that it thinks is a file. If multiple files are specified, all but the last one are
-		// ignored.
+		// ignored, unless -batch is specified, in which case all of them are simulated.
 		for (int i = 1; i < argc; i += 1) {
 			if (memcmp(argv[i], str_expand_pfirst("-exec")) == 0) {
-				exec = 1;
+				options.exec = 1;
 			}
 			
 			if (memcmp(argv[i], str_expand_pfirst("-dump")) == 0) {
@@ -669,21 +1092,159 @@ int main(int argc, char **argv) {
 			}
 			
 			if (memcmp(argv[i], str_expand_pfirst("-show")) == 0) {
-				show = 1;
+				options.show = 1;
+			}
+			
+			if (memcmp(argv[i], str_expand_pfirst("-clocks")) == 0) {
+				options.clocks = 1;
+			}
+			
+			if (memcmp(argv[i], str_expand_pfirst("-8088")) == 0) {
+				options.bus = Bus_8088;
+			}
+			
+			if (memcmp(argv[i], str_expand_pfirst("-profile")) == 0) {
+				profile = 1;
+			}
+			
+			if (memcmp(argv[i], str_expand_pfirst("-profile_csv")) == 0) {
+				profile_csv = 1;
+			}
+			
+			if (memcmp(argv[i], str_expand_pfirst("-debug")) == 0) {
+				debug = 1;
+			}
+			
+			if (memcmp(argv[i], str_expand_pfirst("-trace_bin")) == 0) {
+				binary_trace = 1;
+			}
+			
+			if (memcmp(argv[i], str_expand_pfirst("-expand")) == 0) {
+				expand = 1;
+			}
+			
+			if (memcmp(argv[i], str_expand_pfirst("-batch")) == 0) {
+				batch_mode = 1;
+			}
+			
+			if (memcmp(argv[i], str_expand_pfirst("-expect")) == 0) {
+				batch.check_expected = 1;
+			}
+			
+			// NOTE(ema): -fuzz takes an optional case count, -seed and -engine take a value.
+			if (memcmp(argv[i], str_expand_pfirst("-fuzz")) == 0) {
+				fuzz_mode = 1;
+				if (i + 1 < argc && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '9') {
+					fuzz_cases = (u32)strtoul(argv[++i], 0, 10);
+				}
+			}
+			
+			if (memcmp(argv[i], str_expand_pfirst("-seed")) == 0 && i + 1 < argc) {
+				fuzz_seed = strtoull(argv[++i], 0, 10);
+			}
+			
+			if (memcmp(argv[i], str_expand_pfirst("-engine")) == 0 && i + 1 < argc) {
+				fuzz_engine = argv[++i];
+			}
+			
+			// NOTE(ema): -frame address:width:height:format, with -frame_every N (instructions)
+			// and -frame_png.
+			if (memcmp(argv[i], str_expand_pfirst("-frame")) == 0 && i + 1 < argc) {
+				frames_requested = 1;
+				ok = parse_frame_description(&frames, argv[++i]) && ok;
+			}
+			
+			if (memcmp(argv[i], str_expand_pfirst("-frame_every")) == 0 && i + 1 < argc) {
+				frames.interval = strtoull(argv[++i], 0, 10);
+			}
+			
+			if (memcmp(argv[i], str_expand_pfirst("-frame_png")) == 0) {
+				frames.file_type = Image_Png;
+			}
+			
+			if (memcmp(argv[i], str_expand_pfirst("-checkpoint")) == 0 && i + 1 < argc) {
+				options.checkpoint_interval = strtoull(argv[++i], 0, 10);
+			}
+			
+			if (memcmp(argv[i], str_expand_pfirst("-resume")) == 0 && i + 1 < argc) {
+				resume_name = argv[++i];
 			}
 			
-			if (argv[i][0] != '-') {
+			// NOTE(ema): -cache size:line_size:ways, can be repeated to simulate several caches
+			// on the same accesses.
+			if (memcmp(argv[i], str_expand_pfirst("-cache")) == 0 && i + 1 < argc) {
+#if MEMORY_TRACE
+				ok = add_cache_model(&memory_trace, argv[++i]) && ok;
+#else
+				fprintf(stderr, "-cache needs a build with MEMORY_TRACE=1\n");
+				ok = 0;
+				i += 1;
+#endif
+			}
+			
+			if (argv[i][0] != '-' && !is_option_value(argv, i)) {
 				file_name = argv[i];
 			}
 		}
 		
-		if (!file_name) {
+		if (batch_mode && options.checkpoint_interval) {
+			fprintf(stderr, "-checkpoint can't be used with -batch, the runs would all write the same file\n");
+			ok = 0;
+		}
+		
+		if (batch_mode) {
+			for (int i = 1; i < argc; i += 1) {
+				if (argv[i][0] != '-' && !is_option_value(argv, i)) {
+					// NOTE(ema): Patterns are expanded here because the Windows shell doesn't do it.
+					bool is_pattern = strchr(argv[i], '*') || strchr(argv[i], '?');
+					if (!is_pattern || for_each_file_matching(argv[i], add_batch_file, &batch) == 0) {
+						add_batch_file(argv[i], &batch);
+					}
+				}
+			}
+		} else if (!*file_name && !fuzz_mode && !resume_name) {
 			fprintf(stderr, "Please specify a binary file");
 			ok = 0;
 		}
 	}
 	
-	if (ok) {
+	if (ok && fuzz_mode) {
+		fuzz_t *fuzz = malloc(sizeof(fuzz_t));
+		ok = fuzz && start_fuzz(fuzz, fuzz_engine, fuzz_seed, fuzz_cases);
+		if (ok) {
+			run_fuzz(fuzz, get_processor_count());
+			ok = report_fuzz(fuzz);
+			end_fuzz(fuzz);
+		}
+		free(fuzz);
+		
+		// NOTE(ema): Nothing else runs in fuzz mode.
+		free(bytes.data);
+		return !ok;
+	}
+	
+	if (ok && batch_mode) {
+		batch.options = options;
+		run_batch(&batch, get_processor_count());
+		print_batch_results(&batch);
+		
+		ok = batch_succeeded(&batch);
+	} else if (ok && resume_name) {
+		ok = load_checkpoint(&checkpoint, resume_name);
+		if (ok && options.checkpoint_interval) {
+			// NOTE(ema): The new checkpoints may go over the one being resumed.
+			ok = copy_checkpoint_memory(&checkpoint, memory.bytes);
+		} else if (ok) {
+			// NOTE(ema): The memory of the checkpoint replaces the one allocated above.
+			free(bytes.data);
+			bytes.data = 0;
+			memory = make_memory(checkpoint.memory, 20);
+		}
+		
+		if (ok) {
+			code_len = checkpoint.header.code_len;
+		}
+	} else if (ok) {
 		if (memory.bytes.data) {
 			code_len = (u32)read_file_into_buffer(memory.bytes, file_name);
 			if (code_len == 0) ok = 0;
@@ -693,13 +1254,101 @@ int main(int argc, char **argv) {
 		}
 	}
 	
-	if (ok) {
-		simulate_8086(memory, 0, code_len, exec, show);
+	if (ok && !batch_mode && (profile || profile_csv)) {
+		options.profile = make_guest_profile();
+		if (!options.profile) {
+			fprintf(stderr, "Out of memory");
+			ok = 0;
+		}
+	}
+	
+	// NOTE(ema): The trace text goes straight to the standard output with write(), so whatever
+	// stdio has buffered so far must come out first.
+	trace_writer_t trace = make_trace_writer(0, 0, -1);
+	if (ok && !batch_mode && (options.show || expand || debug)) {
+		fflush(stdout);
+		trace = make_trace_writer(malloc(TRACE_BUFFER_SIZE), TRACE_BUFFER_SIZE, 1);
+		if (trace.data) {
+			options.trace = &trace;
+		} else {
+			fprintf(stderr, "Out of memory");
+			ok = 0;
+		}
+	}
+	
+	trace_writer_t binary = make_trace_writer(0, 0, -1);
+	if (ok && !batch_mode && binary_trace) {
+		if (open_trace_writer(&binary, "trace.bin")) {
+			trace_write_header(&binary, (options.exec ? Trace_Exec : 0) | (options.clocks ? Trace_Clocks : 0));
+			options.binary_trace = &binary;
+		} else {
+			ok = 0;
+		}
+	}
+	
+	// NOTE(ema): Only for a plain run, the debugger and -expand execute parts of the program again.
+	if (ok && !batch_mode && !debug && !expand && frames_requested) {
+		ok = start_frame_writer(&frames);
+		options.frames = &frames;
+	}
+	
+#if MEMORY_TRACE
+	// NOTE(ema): Not in the debugger, which executes parts of the program again when it goes back.
+	if (ok && !batch_mode && !debug && memory_trace.cache_count) {
+		ok = start_memory_trace(&memory_trace);
+		memory.trace = &memory_trace;
+	}
+#endif
+	
+	if (ok && !batch_mode) {
+		simulator_t sim = make_simulator(memory, 0, code_len);
+		if (resume_name) {
+			resume_from_checkpoint(&sim, &options, &checkpoint);
+		}
+		if (expand) {
+			ok = expand_binary_trace(&sim, &options, &trace, "trace.bin");
+			flush_trace(&trace);
+			print_simulation_results(&sim, options);
+		} else if (debug) {
+			debug_8086(&sim, options);
+		} else {
+			simulate_8086(&sim, options);
+		}
+		
+		if (options.binary_trace) close_trace_writer(options.binary_trace);
+		
+		if (options.frames) {
+			take_frame(options.frames, sim.memory, sim.instruction_count, sim.clock_count);
+			end_frame_writer(options.frames);
+			printf("Wrote %u frames, clocks per frame in frames.csv\n", options.frames->frame_count);
+		}
+		
+		if (profile) {
+			print_guest_profile(options.profile, sim.memory.bytes.data + sim.code_offset, sim.code_len, 32);
+		}
+		
+		if (profile_csv) {
+			write_guest_profile_csv(options.profile, sim.memory.bytes.data + sim.code_offset, sim.code_len, "profile.csv");
+		}
 		
 		if (dump) {
 			write_buffer_to_file(memory.bytes, "dump.data");
 		}
+		
+#if MEMORY_TRACE
+		if (memory.trace) {
+			flush_memory_trace(memory.trace);
+			print_memory_trace(memory.trace);
+		}
+#endif
 	}
 	
+#if MEMORY_TRACE
+	end_memory_trace(&memory_trace);
+#endif
+	
+	free(trace.data);
+	unload_checkpoint(&checkpoint);
+	
 	return !ok;
 }
@@ -1,3 +1,16 @@
+#include <sys/stat.h>
+
+#if _WIN32
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <glob.h>
+# include <pthread.h>
+# include <semaphore.h>
+# include <sys/mman.h>
+# include <time.h>
+# include <unistd.h>
+#endif
 
 static int count_ones_i8(i8 n) {
 	int ones = 0;
@@ -18,6 +31,24 @@ static buffer_t make_buffer(u8 *data, u64 len) {
 	return buffer;
 }
 
+#if _WIN32
+
+static u64 get_file_size(char *name) {
+	struct __stat64 info = {0};
+	_stat64(name, &info);
+	return info.st_size;
+}
+
+#else
+
+static u64 get_file_size(char *name) {
+	struct stat info = {0};
+	stat(name, &info);
+	return info.st_size;
+}
+
+#endif
+
 static u64 read_file_into_buffer(buffer_t buffer, char *name) {
 	u64 bytes_read = 0;
 	
@@ -60,3 +91,316 @@ static u64 write_buffer_to_file(buffer_t buffer, char *name) {
 	
 	return bytes_written;
 }
+
+//////////////////////////////////////////
+// Platform
+
+#if _WIN32
+
+static u32 get_processor_count(void) {
+	SYSTEM_INFO info = {0};
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+}
+
+static u32 atomic_add_u32(volatile u32 *value, u32 addend) {
+	u32 result = (u32)InterlockedExchangeAdd((volatile LONG *)value, (LONG)addend);
+	return result;
+}
+
+static u64 atomic_add_u64(volatile u64 *value, u64 addend) {
+	u64 result = (u64)InterlockedExchangeAdd64((volatile LONG64 *)value, (LONG64)addend);
+	return result;
+}
+
+static u64 get_os_timer_frequency(void) {
+	LARGE_INTEGER frequency = {0};
+	QueryPerformanceFrequency(&frequency);
+	return (u64)frequency.QuadPart;
+}
+
+static u64 read_os_timer(void) {
+	LARGE_INTEGER value = {0};
+	QueryPerformanceCounter(&value);
+	return (u64)value.QuadPart;
+}
+
+static DWORD WINAPI thread_entry_point(LPVOID param) {
+	thread_start_t *start = (thread_start_t *)param;
+	start->proc(start->param);
+	return 0;
+}
+
+static void run_on_threads(u32 thread_count, thread_proc_t *proc, void *param) {
+	thread_start_t start = {proc, param};
+	
+	HANDLE *threads = calloc(thread_count, sizeof(HANDLE));
+	if (threads) {
+		for (u32 thread_index = 1; thread_index < thread_count; thread_index += 1) {
+			threads[thread_index] = CreateThread(0, 0, thread_entry_point, &start, 0, 0);
+		}
+	}
+	
+	// NOTE(ema): The calling thread is one of the workers, so this still does all the work if
+	// no thread could be started.
+	proc(param);
+	
+	if (threads) {
+		for (u32 thread_index = 1; thread_index < thread_count; thread_index += 1) {
+			if (threads[thread_index]) {
+				WaitForSingleObject(threads[thread_index], INFINITE);
+				CloseHandle(threads[thread_index]);
+			}
+		}
+		free(threads);
+	}
+}
+
+static bool start_thread(os_thread_t *thread, thread_proc_t *proc, void *param) {
+	thread->start.proc  = proc;
+	thread->start.param = param;
+	
+	HANDLE handle = CreateThread(0, 0, thread_entry_point, &thread->start, 0, 0);
+	thread->handle = (u64)handle;
+	
+	bool result = handle != 0;
+	return result;
+}
+
+static void join_thread(os_thread_t *thread) {
+	WaitForSingleObject((HANDLE)thread->handle, INFINITE);
+	CloseHandle((HANDLE)thread->handle);
+	thread->handle = 0;
+}
+
+static bool make_semaphore(os_semaphore_t *semaphore, u32 initial_count) {
+	semaphore->handle = CreateSemaphoreA(0, (LONG)initial_count, 0x7fffffff, 0);
+	
+	bool result = semaphore->handle != 0;
+	return result;
+}
+
+static void signal_semaphore(os_semaphore_t semaphore) {
+	ReleaseSemaphore((HANDLE)semaphore.handle, 1, 0);
+}
+
+static void wait_semaphore(os_semaphore_t semaphore) {
+	WaitForSingleObject((HANDLE)semaphore.handle, INFINITE);
+}
+
+static void free_semaphore(os_semaphore_t semaphore) {
+	CloseHandle((HANDLE)semaphore.handle);
+}
+
+static buffer_t map_file_private(char *name, u64 offset, u64 size) {
+	buffer_t mapping = {0};
+	
+	HANDLE file = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file != INVALID_HANDLE_VALUE) {
+		HANDLE file_mapping = CreateFileMappingA(file, 0, PAGE_WRITECOPY, 0, 0, 0);
+		if (file_mapping) {
+			void *view = MapViewOfFile(file_mapping, FILE_MAP_COPY, (DWORD)(offset >> 32), (DWORD)offset, (SIZE_T)size);
+			if (view) {
+				mapping.data = (u8 *)view;
+				mapping.len  = size;
+			}
+			
+			// NOTE(ema): The view keeps the mapping and the file open.
+			CloseHandle(file_mapping);
+		}
+		CloseHandle(file);
+	}
+	
+	return mapping;
+}
+
+static void unmap_file(buffer_t mapping) {
+	if (mapping.data) {
+		UnmapViewOfFile(mapping.data);
+	}
+}
+
+static bool replace_file(char *from, char *to) {
+	bool result = MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+	return result;
+}
+
+static u32 for_each_file_matching(char *pattern, file_match_proc_t *proc, void *param) {
+	u32 match_count = 0;
+	
+	// NOTE(ema): FindFirstFile only returns the name of the file, so the directory part of
+	// the pattern has to be put back in front of it.
+	u32 directory_len = 0;
+	for (u32 char_index = 0; pattern[char_index]; char_index += 1) {
+		if (pattern[char_index] == '/' || pattern[char_index] == '\\' || pattern[char_index] == ':') {
+			directory_len = char_index + 1;
+		}
+	}
+	
+	WIN32_FIND_DATAA found = {0};
+	HANDLE find = FindFirstFileA(pattern, &found);
+	if (find != INVALID_HANDLE_VALUE) {
+		do {
+			if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+				char path[MAX_PATH * 2];
+				snprintf(path, sizeof(path), "%.*s%s", directory_len, pattern, found.cFileName);
+				proc(path, param);
+				match_count += 1;
+			}
+		} while (FindNextFileA(find, &found));
+		FindClose(find);
+	}
+	
+	return match_count;
+}
+
+#else
+
+static u32 get_processor_count(void) {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count > 0) ? (u32)count : 1;
+}
+
+static u32 atomic_add_u32(volatile u32 *value, u32 addend) {
+	u32 result = __sync_fetch_and_add(value, addend);
+	return result;
+}
+
+static u64 atomic_add_u64(volatile u64 *value, u64 addend) {
+	u64 result = __sync_fetch_and_add(value, addend);
+	return result;
+}
+
+static u64 get_os_timer_frequency(void) {
+	return 1000000000;
+}
+
+static u64 read_os_timer(void) {
+	struct timespec value = {0};
+	clock_gettime(CLOCK_MONOTONIC, &value);
+	
+	u64 result = get_os_timer_frequency()*(u64)value.tv_sec + (u64)value.tv_nsec;
+	return result;
+}
+
+static void *thread_entry_point(void *param) {
+	thread_start_t *start = (thread_start_t *)param;
+	start->proc(start->param);
+	return 0;
+}
+
+static void run_on_threads(u32 thread_count, thread_proc_t *proc, void *param) {
+	thread_start_t start = {proc, param};
+	
+	pthread_t *threads = calloc(thread_count, sizeof(pthread_t));
+	bool *started = calloc(thread_count, sizeof(bool));
+	if (threads && started) {
+		for (u32 thread_index = 1; thread_index < thread_count; thread_index += 1) {
+			started[thread_index] = pthread_create(&threads[thread_index], 0, thread_entry_point, &start) == 0;
+		}
+	}
+	
+	// NOTE(ema): The calling thread is one of the workers, so this still does all the work if
+	// no thread could be started.
+	proc(param);
+	
+	if (threads && started) {
+		for (u32 thread_index = 1; thread_index < thread_count; thread_index += 1) {
+			if (started[thread_index]) {
+				pthread_join(threads[thread_index], 0);
+			}
+		}
+	}
+	
+	free(threads);
+	free(started);
+}
+
+static bool start_thread(os_thread_t *thread, thread_proc_t *proc, void *param) {
+	thread->start.proc  = proc;
+	thread->start.param = param;
+	
+	pthread_t handle = {0};
+	bool result = pthread_create(&handle, 0, thread_entry_point, &thread->start) == 0;
+	thread->handle = (u64)handle;
+	
+	return result;
+}
+
+static void join_thread(os_thread_t *thread) {
+	pthread_join((pthread_t)thread->handle, 0);
+	thread->handle = 0;
+}
+
+static bool make_semaphore(os_semaphore_t *semaphore, u32 initial_count) {
+	sem_t *handle = malloc(sizeof(sem_t));
+	if (handle && sem_init(handle, 0, initial_count) != 0) {
+		free(handle);
+		handle = 0;
+	}
+	semaphore->handle = handle;
+	
+	bool result = handle != 0;
+	return result;
+}
+
+static void signal_semaphore(os_semaphore_t semaphore) {
+	sem_post((sem_t *)semaphore.handle);
+}
+
+static void wait_semaphore(os_semaphore_t semaphore) {
+	while (sem_wait((sem_t *)semaphore.handle) != 0);
+}
+
+static void free_semaphore(os_semaphore_t semaphore) {
+	if (semaphore.handle) {
+		sem_destroy((sem_t *)semaphore.handle);
+		free(semaphore.handle);
+	}
+}
+
+static buffer_t map_file_private(char *name, u64 offset, u64 size) {
+	buffer_t mapping = {0};
+	
+	int file = open(name, O_RDONLY);
+	if (file >= 0) {
+		void *view = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, (off_t)offset);
+		if (view != MAP_FAILED) {
+			mapping.data = (u8 *)view;
+			mapping.len  = size;
+		}
+		
+		// NOTE(ema): The mapping keeps the file open.
+		close(file);
+	}
+	
+	return mapping;
+}
+
+static void unmap_file(buffer_t mapping) {
+	if (mapping.data) {
+		munmap(mapping.data, mapping.len);
+	}
+}
+
+static bool replace_file(char *from, char *to) {
+	bool result = rename(from, to) == 0;
+	return result;
+}
+
+static u32 for_each_file_matching(char *pattern, file_match_proc_t *proc, void *param) {
+	u32 match_count = 0;
+	
+	glob_t found = {0};
+	if (glob(pattern, 0, 0, &found) == 0) {
+		for (size_t path_index = 0; path_index < found.gl_pathc; path_index += 1) {
+			proc(found.gl_pathv[path_index], param);
+			match_count += 1;
+		}
+	}
+	globfree(&found);
+	
+	return match_count;
+}
+
+#endif
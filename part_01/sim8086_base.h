@@ -16,7 +16,63 @@ struct buffer_t {
 
 static buffer_t make_buffer(u8 *data, u64 len);
 
+static u64 get_file_size(char *name);
 static u64 read_file_into_buffer(buffer_t buffer, char *name);
 static u64 write_buffer_to_file(buffer_t buffer, char *name);
 
+//////////////////////////////////////////
+// Platform
+
+typedef void thread_proc_t(void *param);
+
+typedef struct thread_start_t thread_start_t;
+struct thread_start_t {
+	thread_proc_t *proc;
+	void *param;
+};
+
+// NOTE(ema): Only the platform layer looks inside these.
+typedef struct os_thread_t os_thread_t;
+struct os_thread_t {
+	thread_start_t start;
+	u64 handle;
+};
+
+typedef struct os_semaphore_t os_semaphore_t;
+struct os_semaphore_t {
+	void *handle;
+};
+
+static u32  get_processor_count(void);
+static u32  atomic_add_u32(volatile u32 *value, u32 addend); // Returns the value before the add
+static u64  atomic_add_u64(volatile u64 *value, u64 addend); // Returns the value before the add
+static void run_on_threads(u32 thread_count, thread_proc_t *proc, void *param);
+
+// The thread keeps a pointer to `thread`, which must stay where it is until it's joined.
+static bool start_thread(os_thread_t *thread, thread_proc_t *proc, void *param);
+static void join_thread(os_thread_t *thread);
+
+static bool make_semaphore(os_semaphore_t *semaphore, u32 initial_count);
+static void signal_semaphore(os_semaphore_t semaphore);
+static void wait_semaphore(os_semaphore_t semaphore);
+static void free_semaphore(os_semaphore_t semaphore);
+
+static u64  get_os_timer_frequency(void); // Ticks per second
+static u64  read_os_timer(void);
+
+// Maps `size` bytes of a file, starting at `offset`, which must be a multiple of
+// FILE_MAPPING_ALIGNMENT (the allocation granularity on Windows). The mapping is copy-on-write:
+// it can be written to, but the file never changes. Returns an empty buffer if it fails.
+#define FILE_MAPPING_ALIGNMENT (64 * 1024)
+static buffer_t map_file_private(char *name, u64 offset, u64 size);
+static void     unmap_file(buffer_t mapping);
+
+// Renames `from` to `to`, replacing `to` if it exists.
+static bool replace_file(char *from, char *to);
+
+// Calls `proc` for every file matching `pattern` ('*' and '?' wildcards). Returns the number
+// of matches.
+typedef void file_match_proc_t(char *name, void *param);
+static u32 for_each_file_matching(char *pattern, file_match_proc_t *proc, void *param);
+
 #endif
@@ -0,0 +1,232 @@
+
+//////////////////////////////////////////
+// Batch simulation
+
+static void add_batch_file(char *name, void *param) {
+	batch_t *batch = (batch_t *)param;
+	
+	if (batch->run_count == batch->run_capacity) {
+		u32 new_capacity = batch->run_capacity ? 2 * batch->run_capacity : 64;
+		batch_run_t *runs = realloc(batch->runs, sizeof(batch_run_t) * new_capacity);
+		if (runs) {
+			batch->runs = runs;
+			batch->run_capacity = new_capacity;
+		}
+	}
+	
+	char *name_copy = malloc(strlen(name) + 1);
+	if (batch->run_count < batch->run_capacity && name_copy) {
+		strcpy(name_copy, name);
+		
+		batch_run_t *run = &batch->runs[batch->run_count++];
+		memset(run, 0, sizeof(*run));
+		run->file_name = name_copy;
+	} else {
+		fprintf(stderr, "Out of memory");
+		free(name_copy);
+	}
+}
+
+// The expected result of "name" is in "name.txt", in the same format as the "Final registers"
+// section printed by simulate_8086. Registers that aren't listed are expected to be 0, except
+// for IP, which is only checked if listed.
+static void check_expected_registers(batch_run_t *run) {
+	char expected_name[1024];
+	snprintf(expected_name, sizeof(expected_name), "%s.txt", run->file_name);
+	
+	u64 file_size = get_file_size(expected_name);
+	buffer_t text = {0};
+	text.len  = file_size;
+	text.data = malloc(file_size + 1);
+	
+	if (file_size == 0) {
+		run->expect = Expect_Missing;
+	} else if (!text.data) {
+		run->status = Batch_Out_Of_Memory;
+	} else {
+		text.len = read_file_into_buffer(text, expected_name);
+		text.data[text.len] = 0;
+		
+		u16  expected[Register_Count] = {0};
+		bool listed[Register_Count]   = {0};
+		
+		char *final_registers = strstr((char *)text.data, "Final registers:");
+		char *line = final_registers;
+		while (line && *line) {
+			char *line_end = strchr(line, '\n');
+			if (!line_end) line_end = line + strlen(line);
+			
+			char *name = line;
+			while (name < line_end && (*name == ' ' || *name == '\t')) name += 1;
+			
+			char *colon = memchr(name, ':', line_end - name);
+			if (colon && colon != name) {
+				u32 name_len = (u32)(colon - name);
+				char *value = colon + 1;
+				while (value < line_end && *value == ' ') value += 1;
+				
+				if (name_len == 5 && memcmp(name, "flags", 5) == 0) {
+					char *value_end = value;
+					while (value_end < line_end && *value_end != ' ' && *value_end != '\r') value_end += 1;
+					
+					expected[Register_flags] = parse_cpu_flags(value, (u32)(value_end - value));
+					listed[Register_flags]   = 1;
+				} else {
+					for (int reg_index = 1; reg_index < Register_Count; reg_index += 1) {
+						register_access reg = {reg_index, 0, 2};
+						char *reg_name = (char *) Sim86_RegisterNameFromOperand(&reg);
+						if (strlen(reg_name) == name_len && memcmp(name, reg_name, name_len) == 0) {
+							expected[reg_index] = (u16)strtoul(value, 0, 16);
+							listed[reg_index]   = 1;
+						}
+					}
+				}
+			}
+			
+			line = *line_end ? line_end + 1 : line_end;
+		}
+		
+		if (final_registers) {
+			run->expect = Expect_Match;
+			for (int reg_index = 1; reg_index < Register_Count; reg_index += 1) {
+				if (reg_index == Register_ip && !listed[reg_index]) continue;
+				
+				u16 actual = run->registers.as_words[reg_index];
+				if (actual != expected[reg_index]) {
+					register_access reg = {reg_index, 0, 2};
+					snprintf(run->mismatch, sizeof(run->mismatch), "%s:0x%04x!=0x%04x",
+							 Sim86_RegisterNameFromOperand(&reg), actual, expected[reg_index]);
+					run->expect = Expect_Mismatch;
+					break;
+				}
+			}
+		} else {
+			run->expect = Expect_Missing;
+		}
+	}
+	
+	free(text.data);
+}
+
+static void simulate_batch_run(batch_t *batch, batch_run_t *run, memory_t memory) {
+	memset(memory.bytes.data, 0, memory.bytes.len);
+	
+	u32 code_len = (u32)read_file_into_buffer(memory.bytes, run->file_name);
+	if (code_len) {
+		simulator_t sim = make_simulator(memory, 0, code_len);
+		while (step_8086(&sim, batch->options));
+		
+		run->status = sim.faulted ? Batch_Bad_Instruction : Batch_Ok;
+		run->registers = sim.registers;
+		run->instruction_count = sim.instruction_count;
+		run->clock_count = sim.clock_count;
+		run->fault = sim.fault;
+		run->fault_address = sim.fault_address;
+		
+		if (batch->check_expected) {
+			check_expected_registers(run);
+		}
+	} else {
+		run->status = Batch_Load_Error;
+	}
+}
+
+static void batch_worker(void *param) {
+	batch_t *batch = (batch_t *)param;
+	
+	buffer_t bytes = {0};
+	bytes.len  = 1024 * 1024;
+	bytes.data = malloc(bytes.len);
+	memory_t memory = make_memory(bytes, 20);
+	
+	for (;;) {
+		u32 run_index = atomic_add_u32(&batch->next_run, 1);
+		if (run_index >= batch->run_count) break;
+		
+		batch_run_t *run = &batch->runs[run_index];
+		if (memory.bytes.data) {
+			simulate_batch_run(batch, run, memory);
+		} else {
+			run->status = Batch_Out_Of_Memory;
+		}
+	}
+	
+	free(bytes.data);
+}
+
+static void run_batch(batch_t *batch, u32 thread_count) {
+	// NOTE(ema): Tracing, profiling and checkpoints write to shared state (checkpoints all go to
+	// the same file), so they are off in batch mode.
+	batch->options.exec    = 1;
+	batch->options.show    = 0;
+	batch->options.profile = 0;
+	batch->options.checkpoint_interval = 0;
+	batch->next_run = 0;
+	
+	if (thread_count > batch->run_count) thread_count = batch->run_count;
+	if (thread_count == 0) thread_count = 1;
+	
+	run_on_threads(thread_count, batch_worker, batch);
+}
+
+// One line per run, in the order the files were given, as space-separated key=value pairs.
+// The file name comes last so that it can contain spaces.
+static void print_batch_results(batch_t *batch) {
+	static char *status_names[] = {
+		[Batch_Ok]              = "ok",
+		[Batch_Load_Error]      = "load_error",
+		[Batch_Bad_Instruction] = "bad_instruction",
+		[Batch_Out_Of_Memory]   = "out_of_memory",
+	};
+	
+	static char *expect_names[] = {
+		[Expect_Not_Checked] = "",
+		[Expect_Match]       = "match",
+		[Expect_Mismatch]    = "mismatch",
+		[Expect_Missing]     = "missing",
+	};
+	
+	for (u32 run_index = 0; run_index < batch->run_count; run_index += 1) {
+		batch_run_t *run = &batch->runs[run_index];
+		
+		printf("status=%s", status_names[run->status]);
+		for (int reg_index = 1; reg_index < Register_Count; reg_index += 1) {
+			if (reg_index != Register_flags) {
+				register_access reg = {reg_index, 0, 2};
+				printf(" %s=0x%04x", Sim86_RegisterNameFromOperand(&reg), run->registers.as_words[reg_index]);
+			}
+		}
+		
+		printf(" flags=");
+		print_cpu_flags(stdout, run->registers.flags);
+		
+		if (run->status == Batch_Bad_Instruction) {
+			printf(" fault=%s@%04x:%04x", get_fault_name(run->fault), run->fault_address.base, run->fault_address.offset);
+		}
+		
+		printf(" instructions=%llu", run->instruction_count);
+		if (batch->options.clocks) {
+			printf(" clocks=%llu", run->clock_count);
+		}
+		
+		if (run->expect != Expect_Not_Checked) {
+			printf(" expected=%s", expect_names[run->expect]);
+			if (run->expect == Expect_Mismatch) {
+				printf(" diff=%s", run->mismatch);
+			}
+		}
+		
+		printf(" file=%s\n", run->file_name);
+	}
+}
+
+static bool batch_succeeded(batch_t *batch) {
+	bool result = 1;
+	for (u32 run_index = 0; run_index < batch->run_count; run_index += 1) {
+		batch_run_t *run = &batch->runs[run_index];
+		if (run->status != Batch_Ok || run->expect == Expect_Mismatch) {
+			result = 0;
+		}
+	}
+	return result;
+}
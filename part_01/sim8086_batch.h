@@ -0,0 +1,57 @@
+#ifndef SIM8086_BATCH_H
+#define SIM8086_BATCH_H
+
+//////////////////////////////////////////
+// Batch simulation
+
+typedef u32 batch_status_t;
+enum {
+	Batch_Ok,
+	Batch_Load_Error,
+	Batch_Bad_Instruction,
+	Batch_Out_Of_Memory,
+} batch_status_enum_t;
+
+typedef u32 expect_status_t;
+enum {
+	Expect_Not_Checked,
+	Expect_Match,
+	Expect_Mismatch,
+	Expect_Missing, // There is no expected-result file for this binary
+} expect_status_enum_t;
+
+typedef struct batch_run_t batch_run_t;
+struct batch_run_t {
+	char *file_name;
+	batch_status_t status;
+	
+	register_file_t registers;
+	u64 instruction_count;
+	u64 clock_count;
+	fault_t fault; // Why the run stopped early, if status is Batch_Bad_Instruction
+	pointer_variable_t fault_address;
+	
+	expect_status_t expect;
+	char mismatch[64]; // First difference from the expected result, if any
+};
+
+// NOTE(ema): Runs are independent: every worker thread owns its memory, and every run starts
+// from a fresh simulator_t, so the only shared state is the index of the next run to take.
+typedef struct batch_t batch_t;
+struct batch_t {
+	simulation_options_t options;
+	bool check_expected;
+	
+	batch_run_t *runs;
+	u32 run_count;
+	u32 run_capacity;
+	
+	volatile u32 next_run;
+};
+
+static void add_batch_file(char *name, void *batch);
+static void run_batch(batch_t *batch, u32 thread_count);
+static void print_batch_results(batch_t *batch);
+static bool batch_succeeded(batch_t *batch);
+
+#endif
@@ -0,0 +1,286 @@
+
+#if MEMORY_TRACE
+
+//////////////////////////////////////////
+// Cache model
+
+static bool is_power_of_two(u32 value) {
+	bool result = value != 0 && (value & (value - 1)) == 0;
+	return result;
+}
+
+static u32 log2_u32(u32 value) {
+	u32 result = 0;
+	while (value >> (result + 1)) {
+		result += 1;
+	}
+	return result;
+}
+
+static bool add_cache_model(memory_trace_t *trace, char *config) {
+	bool ok = 1;
+	
+	u32 values[3] = {0};
+	u32 value_count = 0;
+	char *at = config;
+	while (ok && value_count < array_count(values)) {
+		char *end = at;
+		values[value_count++] = (u32)strtoul(at, &end, 10);
+		char expected = (value_count < array_count(values)) ? ':' : 0;
+		if (end == at || *end != expected) {
+			ok = 0;
+		}
+		at = end + 1;
+	}
+	
+	u32 size = values[0];
+	u32 line_size = values[1];
+	u32 ways = values[2];
+	if (ok) {
+		ok = (is_power_of_two(size) && is_power_of_two(line_size) && is_power_of_two(ways) &&
+			  line_size <= 1024 * 1024 && size >= line_size * ways);
+	}
+	
+	if (!ok) {
+		fprintf(stderr, "Invalid cache \"%s\": expected size:line_size:ways, all powers of 2\n", config);
+	}
+	
+	if (ok && trace->cache_count == MEMORY_TRACE_MAX_CACHES) {
+		fprintf(stderr, "Too many caches, at most %d can be simulated at once\n", MEMORY_TRACE_MAX_CACHES);
+		ok = 0;
+	}
+	
+	if (ok) {
+		cache_model_t *cache = &trace->caches[trace->cache_count];
+		memset(cache, 0, sizeof(*cache));
+		cache->size       = size;
+		cache->line_size  = line_size;
+		cache->ways       = ways;
+		cache->line_shift = log2_u32(line_size);
+		cache->set_count  = size / (line_size * ways);
+		
+		u32 line_count = (1024 * 1024) >> cache->line_shift;
+		cache->time_capacity = 2 * line_count;
+		
+		cache->tags       = calloc((u64)cache->set_count * ways, sizeof(u32));
+		cache->last_used  = calloc((u64)cache->set_count * ways, sizeof(u64));
+		cache->line_times = calloc(line_count, sizeof(u32));
+		cache->time_lines = calloc(cache->time_capacity + 1, sizeof(u32));
+		cache->fenwick    = calloc(cache->time_capacity + 1, sizeof(u32));
+		
+		if (cache->tags && cache->last_used && cache->line_times && cache->time_lines && cache->fenwick) {
+			trace->cache_count += 1;
+		} else {
+			free(cache->tags);
+			free(cache->last_used);
+			free(cache->line_times);
+			free(cache->time_lines);
+			free(cache->fenwick);
+			
+			fprintf(stderr, "Out of memory");
+			ok = 0;
+		}
+	}
+	
+	return ok;
+}
+
+static void fenwick_add(u32 *fenwick, u32 capacity, u32 index, i32 delta) {
+	for (; index <= capacity; index += index & (0 - index)) {
+		fenwick[index] += (u32)delta;
+	}
+}
+
+static u32 fenwick_sum(u32 *fenwick, u32 index) {
+	u32 result = 0;
+	for (; index > 0; index -= index & (0 - index)) {
+		result += fenwick[index];
+	}
+	return result;
+}
+
+// NOTE(ema): Gives the live times (at most one per line) consecutive numbers starting at 1,
+// keeping their order, and rebuilds the tree with all of them set.
+static void renumber_reuse_times(cache_model_t *cache) {
+	u32 live_count = 0;
+	for (u32 time = 1; time <= cache->time; time += 1) {
+		u32 line = cache->time_lines[time];
+		if (cache->line_times[line] == time) {
+			live_count += 1;
+			cache->line_times[line] = live_count;
+			cache->time_lines[live_count] = line;
+		}
+	}
+	
+	memset(cache->fenwick, 0, (cache->time_capacity + 1) * sizeof(u32));
+	for (u32 index = 1; index <= cache->time_capacity; index += 1) {
+		cache->fenwick[index] += (index <= live_count);
+		u32 parent = index + (index & (0 - index));
+		if (parent <= cache->time_capacity) {
+			cache->fenwick[parent] += cache->fenwick[index];
+		}
+	}
+	
+	cache->time = live_count;
+}
+
+static void record_reuse_distance(cache_model_t *cache, u32 line) {
+	if (cache->time == cache->time_capacity) {
+		renumber_reuse_times(cache);
+	}
+	
+	cache->time += 1;
+	
+	u32 previous = cache->line_times[line];
+	if (previous) {
+		u32 distance = fenwick_sum(cache->fenwick, cache->time - 1) - fenwick_sum(cache->fenwick, previous);
+		u32 bucket = distance ? 1 + log2_u32(distance) : 0;
+		if (bucket >= REUSE_HISTOGRAM_SIZE) bucket = REUSE_HISTOGRAM_SIZE - 1;
+		cache->reuse_histogram[bucket] += 1;
+		
+		fenwick_add(cache->fenwick, cache->time_capacity, previous, -1);
+	} else {
+		cache->cold_accesses += 1;
+	}
+	
+	fenwick_add(cache->fenwick, cache->time_capacity, cache->time, 1);
+	cache->line_times[line] = cache->time;
+	cache->time_lines[cache->time] = line;
+}
+
+static void cache_access(cache_model_t *cache, memory_access_t access) {
+	u32 line = (access & MEMORY_ACCESS_ADDRESS_MASK) >> cache->line_shift;
+	u32 tag = line + 1;
+	
+	u32 *tags = cache->tags + (u64)(line & (cache->set_count - 1)) * cache->ways;
+	u64 *last_used = cache->last_used + (tags - cache->tags);
+	
+	cache->clock += 1;
+	
+	u32 way = 0;
+	while (way < cache->ways && tags[way] != tag) {
+		way += 1;
+	}
+	
+	bool hit = way < cache->ways;
+	if (!hit) {
+		way = 0;
+		for (u32 candidate = 1; candidate < cache->ways; candidate += 1) {
+			if (last_used[candidate] < last_used[way]) {
+				way = candidate;
+			}
+		}
+		
+		if (tags[way]) cache->evictions += 1;
+		tags[way] = tag;
+	}
+	last_used[way] = cache->clock;
+	
+	if (access & Access_Write) {
+		cache->writes += 1;
+		cache->write_misses += !hit;
+	} else {
+		cache->reads += 1;
+		cache->read_misses += !hit;
+	}
+	
+	record_reuse_distance(cache, line);
+}
+
+//////////////////////////////////////////
+// Memory tracing
+
+static bool start_memory_trace(memory_trace_t *trace) {
+	trace->ring = malloc(MEMORY_TRACE_RING_SIZE * sizeof(memory_access_t));
+	trace->access_count = 0;
+	trace->fed_count = 0;
+	
+	bool ok = trace->ring != 0;
+	if (!ok) {
+		fprintf(stderr, "Out of memory");
+	}
+	
+	return ok;
+}
+
+static void feed_caches(memory_trace_t *trace) {
+	for (u32 cache_index = 0; cache_index < trace->cache_count; cache_index += 1) {
+		cache_model_t *cache = &trace->caches[cache_index];
+		for (u64 access_index = trace->fed_count; access_index < trace->access_count; access_index += 1) {
+			cache_access(cache, trace->ring[access_index & (MEMORY_TRACE_RING_SIZE - 1)]);
+		}
+	}
+	
+	trace->fed_count = trace->access_count;
+}
+
+static void record_memory_access(memory_trace_t *trace, physical_address_t address, memory_access_t kind) {
+	trace->ring[trace->access_count & (MEMORY_TRACE_RING_SIZE - 1)] = (address & MEMORY_ACCESS_ADDRESS_MASK) | kind;
+	trace->access_count += 1;
+	
+	if (trace->access_count - trace->fed_count == MEMORY_TRACE_RING_SIZE) {
+		feed_caches(trace);
+	}
+}
+
+static void flush_memory_trace(memory_trace_t *trace) {
+	feed_caches(trace);
+}
+
+static void print_memory_trace(memory_trace_t *trace) {
+	printf("\nMemory accesses: %llu\n", trace->access_count);
+	
+	for (u32 cache_index = 0; cache_index < trace->cache_count; cache_index += 1) {
+		cache_model_t *cache = &trace->caches[cache_index];
+		
+		u64 accesses = cache->reads + cache->writes;
+		u64 misses = cache->read_misses + cache->write_misses;
+		
+		printf("\nCache %u bytes, %u-byte lines, %u ways (%u sets):\n", cache->size, cache->line_size, cache->ways, cache->set_count);
+		printf("  hits %.2f%%: reads %llu (%.2f%% hits), writes %llu (%.2f%% hits), %llu evictions\n",
+			   accesses ? 100.0 * (double)(accesses - misses) / (double)accesses : 0.0,
+			   cache->reads,  cache->reads  ? 100.0 * (double)(cache->reads  - cache->read_misses)  / (double)cache->reads  : 0.0,
+			   cache->writes, cache->writes ? 100.0 * (double)(cache->writes - cache->write_misses) / (double)cache->writes : 0.0,
+			   cache->evictions);
+		
+		// NOTE(ema): The cumulative column is the hit rate of a fully associative LRU cache with
+		// as many lines as the upper end of the bucket.
+		printf("  reuse distance in lines: %llu cold\n", cache->cold_accesses);
+		printf("    %-15s %12s %8s %8s\n", "distance", "accesses", "%", "cum %");
+		
+		u64 cumulative = 0;
+		for (u32 bucket = 0; bucket < REUSE_HISTOGRAM_SIZE; bucket += 1) {
+			u64 count = cache->reuse_histogram[bucket];
+			cumulative += count;
+			if (count) {
+				char range[32];
+				if (bucket == 0) {
+					snprintf(range, sizeof(range), "0");
+				} else if (bucket == REUSE_HISTOGRAM_SIZE - 1) {
+					snprintf(range, sizeof(range), "%u+", 1u << (bucket - 1));
+				} else {
+					snprintf(range, sizeof(range), "%u-%u", 1u << (bucket - 1), (1u << bucket) - 1);
+				}
+				
+				printf("    %-15s %12llu %7.2f%% %7.2f%%\n", range, count,
+					   100.0 * (double)count / (double)accesses, 100.0 * (double)cumulative / (double)accesses);
+			}
+		}
+	}
+}
+
+static void end_memory_trace(memory_trace_t *trace) {
+	for (u32 cache_index = 0; cache_index < trace->cache_count; cache_index += 1) {
+		cache_model_t *cache = &trace->caches[cache_index];
+		free(cache->tags);
+		free(cache->last_used);
+		free(cache->line_times);
+		free(cache->time_lines);
+		free(cache->fenwick);
+	}
+	
+	free(trace->ring);
+	memset(trace, 0, sizeof(*trace));
+}
+
+#endif
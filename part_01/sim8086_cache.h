@@ -0,0 +1,88 @@
+#ifndef SIM8086_CACHE_H
+#define SIM8086_CACHE_H
+
+//////////////////////////////////////////
+// Memory tracing
+
+// NOTE(ema): Only compiled in with MEMORY_TRACE=1 (see sim8086_memory.h), so that the normal
+// build doesn't pay even for the check in memory_read_u8/memory_write_u8.
+// Every byte read or written through those goes into a ring buffer, and every time the ring
+// wraps around its contents are fed to the cache models in one go. Instruction fetches don't
+// go through them, so they are not traced.
+#if MEMORY_TRACE
+
+#define MEMORY_TRACE_RING_SIZE (64 * 1024) // Accesses, must be a power of 2
+#define MEMORY_TRACE_MAX_CACHES 4
+
+typedef u32 memory_access_t; // Physical address in the low 20 bits, kind above
+enum {
+	Access_Read  = 0 << 20,
+	Access_Write = 1 << 20,
+} memory_access_enum_t;
+
+#define MEMORY_ACCESS_ADDRESS_MASK ((1 << 20) - 1)
+
+//////////////////////////////////////////
+// Cache model
+
+// NOTE(ema): A set-associative cache with LRU replacement that allocates on both reads and
+// writes. Next to it, the reuse distance of every access is measured at the granularity of
+// the same lines: the number of distinct other lines touched since the previous access to
+// this one. A fully associative LRU cache of N lines hits exactly the accesses whose distance
+// is less than N, so the histogram tells how big the cache would have to be.
+#define REUSE_HISTOGRAM_SIZE 22 // Bucket 0 is distance 0, bucket k is [2^(k-1), 2^k)
+
+typedef struct cache_model_t cache_model_t;
+struct cache_model_t {
+	u32 size;
+	u32 line_size;
+	u32 ways;
+	u32 line_shift;
+	u32 set_count;
+	
+	u32 *tags;       // set_count*ways, line index + 1, 0 if the way is empty
+	u64 *last_used;  // set_count*ways, for LRU
+	u64 clock;
+	
+	u64 reads;
+	u64 writes;
+	u64 read_misses;
+	u64 write_misses;
+	u64 evictions;
+	
+	// NOTE(ema): Reuse distances are counted with a Fenwick tree over access times, where a time
+	// is set if it's the last access of some line. Times are renumbered when they run out, so
+	// the tree never needs more than twice the number of lines.
+	u32 *line_times; // Per line, 0 if never accessed
+	u32 *time_lines; // Per time, the line accessed then
+	u32 *fenwick;
+	u32 time;
+	u32 time_capacity;
+	
+	u64 cold_accesses; // First access to a line: no reuse distance
+	u64 reuse_histogram[REUSE_HISTOGRAM_SIZE];
+};
+
+typedef struct memory_trace_t memory_trace_t;
+struct memory_trace_t {
+	memory_access_t *ring; // MEMORY_TRACE_RING_SIZE entries
+	u64 access_count;      // Total, the ring holds the last MEMORY_TRACE_RING_SIZE of them
+	u64 fed_count;         // Accesses already given to the caches
+	
+	cache_model_t caches[MEMORY_TRACE_MAX_CACHES];
+	u32 cache_count;
+};
+
+// Parses "size:line_size:ways" (in bytes, all powers of 2) and adds a cache model. Returns 0
+// and prints the reason if the configuration is invalid or there's no memory for it.
+static bool add_cache_model(memory_trace_t *trace, char *config);
+
+static bool start_memory_trace(memory_trace_t *trace);
+static void record_memory_access(memory_trace_t *trace, physical_address_t address, memory_access_t kind);
+static void flush_memory_trace(memory_trace_t *trace); // Feeds the accesses still in the ring to the caches
+static void print_memory_trace(memory_trace_t *trace);
+static void end_memory_trace(memory_trace_t *trace);
+
+#endif
+
+#endif
@@ -0,0 +1,127 @@
+
+//////////////////////////////////////////
+// Checkpoints
+
+// NOTE(ema): The checkpoint is written next to the real file and renamed over it at the end,
+// so a crash while saving doesn't lose the previous one.
+static bool save_checkpoint(simulator_t *sim, bus_mode_t bus, char *name) {
+	bool ok = 1;
+	
+	checkpoint_header_t header = {0};
+	memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+	header.version           = CHECKPOINT_VERSION;
+	header.header_size       = sizeof(header);
+	header.memory_offset     = CHECKPOINT_MEMORY_OFFSET;
+	header.memory_size       = (u32)sim->memory.bytes.len;
+	header.code_offset       = sim->code_offset;
+	header.code_len          = sim->code_len;
+	header.clock_count       = sim->clock_count;
+	header.instruction_count = sim->instruction_count;
+	header.bus               = bus;
+	header.flags             = (sim->stopped ? Checkpoint_Stopped : 0) | (sim->faulted ? Checkpoint_Faulted : 0);
+	header.fault             = sim->fault;
+	header.fault_address     = sim->fault_address;
+	header.registers         = sim->registers;
+	
+	char temp_name[512];
+	snprintf(temp_name, sizeof(temp_name), "%s.tmp", name);
+	
+	FILE *file = fopen(temp_name, "wb");
+	if (file) {
+		static u8 padding[CHECKPOINT_MEMORY_OFFSET];
+		
+		ok = (fwrite(&header, sizeof(header), 1, file) == 1 &&
+			  fwrite(padding, 1, CHECKPOINT_MEMORY_OFFSET - sizeof(header), file) == CHECKPOINT_MEMORY_OFFSET - sizeof(header) &&
+			  fwrite(sim->memory.bytes.data, 1, sim->memory.bytes.len, file) == sim->memory.bytes.len);
+		ok = (fclose(file) == 0) && ok;
+		
+		ok = ok && replace_file(temp_name, name);
+		if (!ok) {
+			fprintf(stderr, "Error writing checkpoint '%s'\n", name);
+			remove(temp_name);
+		}
+	} else {
+		fprintf(stderr, "Error opening file '%s'\n", temp_name);
+		ok = 0;
+	}
+	
+	return ok;
+}
+
+static bool load_checkpoint(checkpoint_t *checkpoint, char *name) {
+	bool ok = 1;
+	memset(checkpoint, 0, sizeof(*checkpoint));
+	
+	FILE *file = fopen(name, "rb");
+	if (file) {
+		ok = fread(&checkpoint->header, sizeof(checkpoint->header), 1, file) == 1;
+		fclose(file);
+		
+		checkpoint_header_t *header = &checkpoint->header;
+		if (!ok || memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0) {
+			fprintf(stderr, "'%s' is not a checkpoint\n", name);
+			ok = 0;
+		} else if (header->version != CHECKPOINT_VERSION || header->header_size != sizeof(*header)) {
+			fprintf(stderr, "'%s' is a checkpoint from another version (%u, expected %u)\n", name, header->version, CHECKPOINT_VERSION);
+			ok = 0;
+		} else if (header->memory_size != 1024 * 1024 || header->memory_offset % FILE_MAPPING_ALIGNMENT != 0) {
+			fprintf(stderr, "'%s' has an unexpected memory layout\n", name);
+			ok = 0;
+		} else if (get_file_size(name) < (u64)header->memory_offset + header->memory_size) {
+			// NOTE(ema): Mapping past the end of the file would only fail when the memory is touched.
+			fprintf(stderr, "'%s' is truncated\n", name);
+			ok = 0;
+		}
+	} else {
+		fprintf(stderr, "Error opening file '%s'\n", name);
+		ok = 0;
+	}
+	
+	if (ok) {
+		checkpoint->memory = map_file_private(name, checkpoint->header.memory_offset, checkpoint->header.memory_size);
+		checkpoint->mapped = checkpoint->memory.data != 0;
+		if (!checkpoint->memory.data) {
+			fprintf(stderr, "Error mapping the memory of '%s'\n", name);
+			ok = 0;
+		}
+	}
+	
+	return ok;
+}
+
+static void resume_from_checkpoint(simulator_t *sim, simulation_options_t *options, checkpoint_t *checkpoint) {
+	checkpoint_header_t *header = &checkpoint->header;
+	
+	assert(sim->memory.bytes.data == checkpoint->memory.data);
+	sim->code_offset       = header->code_offset;
+	sim->code_len          = header->code_len;
+	sim->registers         = header->registers;
+	sim->clock_count       = header->clock_count;
+	sim->instruction_count = header->instruction_count;
+	sim->stopped           = (header->flags & Checkpoint_Stopped) != 0;
+	sim->faulted           = (header->flags & Checkpoint_Faulted) != 0;
+	sim->fault             = header->fault;
+	sim->fault_address     = header->fault_address;
+	
+	options->bus = header->bus;
+}
+
+static bool copy_checkpoint_memory(checkpoint_t *checkpoint, buffer_t memory) {
+	bool ok = memory.data && memory.len >= checkpoint->memory.len;
+	if (ok) {
+		memcpy(memory.data, checkpoint->memory.data, checkpoint->memory.len);
+		
+		if (checkpoint->mapped) unmap_file(checkpoint->memory);
+		checkpoint->memory.data = memory.data;
+		checkpoint->mapped      = 0;
+	} else {
+		fprintf(stderr, "Out of memory");
+	}
+	
+	return ok;
+}
+
+static void unload_checkpoint(checkpoint_t *checkpoint) {
+	if (checkpoint->mapped) unmap_file(checkpoint->memory);
+	memset(checkpoint, 0, sizeof(*checkpoint));
+}
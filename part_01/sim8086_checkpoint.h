@@ -0,0 +1,65 @@
+#ifndef SIM8086_CHECKPOINT_H
+#define SIM8086_CHECKPOINT_H
+
+//////////////////////////////////////////
+// Checkpoints
+
+// NOTE(ema): A checkpoint file is a header with everything in simulator_t but the memory, plus
+// the bus the clocks were estimated for, followed by the whole memory image at
+// CHECKPOINT_MEMORY_OFFSET, so that it can be mapped (copy-on-write) instead of read when the
+// simulation is resumed. Numbers are stored in the byte order of the machine that wrote them,
+// which is little endian everywhere this runs.
+// Bump the version whenever the header changes.
+
+#define CHECKPOINT_MAGIC         "SIM86CHK"
+#define CHECKPOINT_VERSION       3
+#define CHECKPOINT_MEMORY_OFFSET FILE_MAPPING_ALIGNMENT
+#define CHECKPOINT_FILE_NAME     "checkpoint.bin"
+
+typedef u32 checkpoint_flags_t;
+enum {
+	Checkpoint_Stopped = 1 << 0,
+	Checkpoint_Faulted = 1 << 1,
+} checkpoint_flags_enum_t;
+
+typedef struct checkpoint_header_t checkpoint_header_t;
+struct checkpoint_header_t {
+	char magic[8];
+	u32  version;
+	u32  header_size;
+	
+	u32  memory_offset;
+	u32  memory_size;
+	u32  code_offset;
+	u32  code_len;
+	
+	u64  clock_count;
+	u64  instruction_count;
+	bus_mode_t bus; // clock_count was estimated for
+	checkpoint_flags_t flags;
+	fault_t fault;
+	pointer_variable_t fault_address;
+	
+	register_file_t registers;
+};
+
+typedef struct checkpoint_t checkpoint_t;
+struct checkpoint_t {
+	checkpoint_header_t header;
+	buffer_t memory; // Mapped from the file, unless copy_checkpoint_memory() was called
+	bool mapped;
+};
+
+static bool save_checkpoint(simulator_t *sim, bus_mode_t bus, char *name);
+
+static bool load_checkpoint(checkpoint_t *checkpoint, char *name);
+// NOTE(ema): sim must use checkpoint->memory. The bus of the checkpoint goes in options, so the
+// clocks of the rest of the run add up with the ones before it.
+static void resume_from_checkpoint(simulator_t *sim, simulation_options_t *options, checkpoint_t *checkpoint);
+static void unload_checkpoint(checkpoint_t *checkpoint);
+
+// NOTE(ema): Copies the memory into `memory` and unmaps the file, so that it can be replaced
+// while the simulation runs: Windows refuses to while a view of it is mapped.
+static bool copy_checkpoint_memory(checkpoint_t *checkpoint, buffer_t memory);
+
+#endif
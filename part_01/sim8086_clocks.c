@@ -48,3 +48,266 @@ static int clocks_from_effective_address_expression(effective_address_expression
 	
 	return clocks;
 }
+
+static bool operand_is_segment_register(instruction_operand *operand) {
+	bool result = (operand->Type == Operand_Register &&
+				   operand->Register.Index >= Register_es && operand->Register.Index <= Register_ds);
+	return result;
+}
+
+static bool operand_is_accumulator(instruction_operand *operand) {
+	bool result = (operand->Type == Operand_Register && operand->Register.Index == Register_a);
+	return result;
+}
+
+static bool operand_is_direct_address(instruction_operand *operand) {
+	bool result = (operand->Type == Operand_Memory &&
+				   operand->Address.Terms[0].Register.Index == Register_None &&
+				   operand->Address.Terms[1].Register.Index == Register_None);
+	return result;
+}
+
+// Estimates the clocks taken by an instruction that was just executed, using the timings
+// listed in table 2-21 of the manual (page 2-51). Where the manual gives a range, the lower
+// bound is used.
+static instruction_clocks_t estimate_instruction_clocks(instruction instr, execution_info_t info, bus_mode_t bus) {
+	instruction_clocks_t clocks = {0};
+	
+	instruction_operand *dst = &instr.Operands[0];
+	instruction_operand *src = &instr.Operands[1];
+	
+	bool dst_reg = dst->Type == Operand_Register;
+	bool dst_mem = dst->Type == Operand_Memory;
+	bool src_reg = src->Type == Operand_Register;
+	bool src_mem = src->Type == Operand_Memory;
+	bool src_imm = src->Type == Operand_Immediate;
+	
+	bool wide   = (instr.Flags & Inst_Wide) != 0;
+	bool is_far = (instr.Flags & Inst_Far)  != 0;
+	bool rep    = (instr.Flags & Inst_Rep)  != 0;
+	
+	instruction_operand *mem = 0;
+	if      (dst_mem) mem = dst;
+	else if (src_mem) mem = src;
+	
+	bool needs_ea = mem != 0;
+	
+	// NOTE(ema): Number of operand-sized memory transfers (reads plus writes), used to compute
+	// the penalty for word transfers that need two bus cycles.
+	u32 transfers = 0;
+	
+	u32 base = 0;
+	switch (instr.Op) {
+		case Op_mov: {
+			if (dst_reg && src_reg) {
+				base = 2;
+			} else if (operand_is_accumulator(dst) && operand_is_direct_address(src)) {
+				base = 10; transfers = 1; needs_ea = 0;
+			} else if (dst_mem && operand_is_direct_address(dst) && operand_is_accumulator(src)) {
+				base = 10; transfers = 1; needs_ea = 0;
+			} else if (dst_reg && src_mem) {
+				base = 8;  transfers = 1;
+			} else if (dst_mem && src_reg) {
+				base = 9;  transfers = 1;
+			} else if (dst_reg && src_imm) {
+				base = 4;
+			} else if (dst_mem && src_imm) {
+				base = 10; transfers = 1;
+			}
+			
+			// NOTE(ema): Segment registers are always word-sized.
+			if (operand_is_segment_register(dst) || operand_is_segment_register(src)) {
+				wide = 1;
+			}
+		} break;
+		
+		case Op_add:
+		case Op_adc:
+		case Op_sub:
+		case Op_sbb:
+		case Op_and:
+		case Op_or:
+		case Op_xor: {
+			if      (dst_reg && src_reg) { base = 3; }
+			else if (dst_reg && src_mem) { base = 9;  transfers = 1; }
+			else if (dst_mem && src_reg) { base = 16; transfers = 2; }
+			else if (dst_reg && src_imm) { base = 4; }
+			else if (dst_mem && src_imm) { base = 17; transfers = 2; }
+		} break;
+		
+		case Op_cmp: {
+			if      (dst_reg && src_reg) { base = 3; }
+			else if (dst_reg && src_mem) { base = 9;  transfers = 1; }
+			else if (dst_mem && src_reg) { base = 9;  transfers = 1; }
+			else if (dst_reg && src_imm) { base = 4; }
+			else if (dst_mem && src_imm) { base = 10; transfers = 1; }
+		} break;
+		
+		case Op_test: {
+			if      (dst_reg && src_reg) { base = 3; }
+			else if (dst_reg && src_mem) { base = 9;  transfers = 1; }
+			else if (dst_mem && src_reg) { base = 9;  transfers = 1; }
+			else if (dst_reg && src_imm) { base = operand_is_accumulator(dst) ? 4 : 5; }
+			else if (dst_mem && src_imm) { base = 11; transfers = 1; }
+		} break;
+		
+		case Op_inc:
+		case Op_dec: {
+			if (dst_reg) { base = wide ? 2 : 3; }
+			else         { base = 15; transfers = 2; }
+		} break;
+		
+		case Op_neg:
+		case Op_not: {
+			if (dst_reg) { base = 3; }
+			else         { base = 16; transfers = 2; }
+		} break;
+		
+		case Op_mul:  { base = wide ? 118 : 70;  if (dst_mem) { base += 6; transfers = 1; } } break;
+		case Op_imul: { base = wide ? 128 : 80;  if (dst_mem) { base += 6; transfers = 1; } } break;
+		case Op_div:  { base = wide ? 144 : 80;  if (dst_mem) { base += 6; transfers = 1; } } break;
+		case Op_idiv: { base = wide ? 165 : 101; if (dst_mem) { base += 6; transfers = 1; } } break;
+		
+		case Op_shl:
+		case Op_shr:
+		case Op_sar:
+		case Op_rol:
+		case Op_ror:
+		case Op_rcl:
+		case Op_rcr: {
+			bool by_cl = src_reg;
+			if (dst_reg) { base = by_cl ? 8  + 4*info.shift_count : 2; }
+			else         { base = by_cl ? 20 + 4*info.shift_count : 15; transfers = 2; }
+		} break;
+		
+		case Op_xchg: {
+			if (dst_reg && src_reg) { base = (wide && (operand_is_accumulator(dst) || operand_is_accumulator(src))) ? 3 : 4; }
+			else                    { base = 17; transfers = 2; }
+		} break;
+		
+		case Op_lea: { base = 2; } break;
+		case Op_lds:
+		case Op_les: { base = 16; transfers = 2; wide = 1; } break;
+		
+		case Op_push: {
+			wide = 1;
+			if      (dst_mem)                          { base = 16; transfers = 2; }
+			else if (operand_is_segment_register(dst)) { base = 10; transfers = 1; }
+			else                                       { base = 11; transfers = 1; }
+		} break;
+		
+		case Op_pop: {
+			wide = 1;
+			if (dst_mem) { base = 17; transfers = 2; }
+			else         { base = 8;  transfers = 1; }
+		} break;
+		
+		case Op_pushf: { base = 10; transfers = 1; wide = 1; } break;
+		case Op_popf:  { base = 8;  transfers = 1; wide = 1; } break;
+		
+		case Op_call: {
+			wide = 1;
+			if (is_far) {
+				if (dst_mem) { base = 37; transfers = 4; }
+				else         { base = 28; transfers = 2; }
+			} else {
+				if      (dst_mem) { base = 21; transfers = 2; }
+				else if (dst_reg) { base = 16; transfers = 1; }
+				else              { base = 19; transfers = 1; }
+			}
+		} break;
+		
+		case Op_jmp: {
+			wide = 1;
+			if (is_far) {
+				if (dst_mem) { base = 24; transfers = 2; }
+				else         { base = 15; }
+			} else {
+				if      (dst_mem) { base = 18; transfers = 1; }
+				else if (dst_reg) { base = 11; }
+				else              { base = 15; }
+			}
+		} break;
+		
+		case Op_ret:  { base = (dst->Type == Operand_Immediate) ? 12 : 8;  transfers = 1; wide = 1; } break;
+		case Op_retf: { base = (dst->Type == Operand_Immediate) ? 17 : 18; transfers = 2; wide = 1; } break;
+		case Op_iret: { base = 24; transfers = 3; wide = 1; } break;
+		
+		case Op_je:
+		case Op_jl:
+		case Op_jle:
+		case Op_jb:
+		case Op_jbe:
+		case Op_jp:
+		case Op_jo:
+		case Op_js:
+		case Op_jne:
+		case Op_jnl:
+		case Op_jg:
+		case Op_jnb:
+		case Op_ja:
+		case Op_jnp:
+		case Op_jno:
+		case Op_jns:    { base = info.jump_taken ? 16 : 4; } break;
+		case Op_loop:   { base = info.jump_taken ? 17 : 5; } break;
+		case Op_loopz:  { base = info.jump_taken ? 18 : 6; } break;
+		case Op_loopnz: { base = info.jump_taken ? 19 : 5; } break;
+		case Op_jcxz:   { base = info.jump_taken ? 18 : 6; } break;
+		
+		case Op_movs: { base = rep ? 9 + 17*info.repetitions : 18; transfers = rep ? 2*info.repetitions : 2; } break;
+		case Op_cmps: { base = rep ? 9 + 22*info.repetitions : 22; transfers = rep ? 2*info.repetitions : 2; } break;
+		case Op_scas: { base = rep ? 9 + 15*info.repetitions : 15; transfers = rep ?   info.repetitions : 1; } break;
+		case Op_lods: { base = rep ? 9 + 13*info.repetitions : 12; transfers = rep ?   info.repetitions : 1; } break;
+		case Op_stos: { base = rep ? 9 + 10*info.repetitions : 11; transfers = rep ?   info.repetitions : 1; } break;
+		
+		case Op_in:
+		case Op_out: { base = src_imm || (dst->Type == Operand_Immediate) ? 10 : 8; transfers = 1; } break;
+		
+		case Op_int:  { base = 51; transfers = 5; wide = 1; } break;
+		case Op_int3: { base = 52; transfers = 5; wide = 1; } break;
+		case Op_into: { base = info.jump_taken ? 53 : 4; transfers = info.jump_taken ? 5 : 0; wide = 1; } break;
+		
+		case Op_xlat: { base = 11; transfers = 1; } break;
+		case Op_aam:  { base = 83; } break;
+		case Op_aad:  { base = 60; } break;
+		case Op_cwd:  { base = 5; } break;
+		case Op_wait: { base = 3; } break;
+		case Op_esc:  { base = dst_mem || src_mem ? 8 : 2; transfers = dst_mem || src_mem ? 1 : 0; } break;
+		
+		case Op_lahf:
+		case Op_sahf:
+		case Op_aaa:
+		case Op_daa:
+		case Op_aas:
+		case Op_das: { base = 4; } break;
+		
+		case Op_cbw:
+		case Op_clc:
+		case Op_cmc:
+		case Op_stc:
+		case Op_cld:
+		case Op_std:
+		case Op_cli:
+		case Op_sti:
+		case Op_hlt:
+		case Op_lock:
+		case Op_segment: { base = 2; } break;
+		
+		default: break;
+	}
+	
+	clocks.base = base;
+	if (needs_ea) {
+		clocks.ea = (u32)clocks_from_effective_address_expression(&mem->Address);
+	}
+	
+	// NOTE(ema): A word transfer takes two bus cycles (4 clocks each) instead of one if the bus
+	// can't move the whole word at once. See page 2-52 of the manual.
+	if (wide && (bus == Bus_8088 || info.unaligned)) {
+		clocks.penalty = 4 * transfers;
+	}
+	
+	clocks.total = clocks.base + clocks.ea + clocks.penalty;
+	
+	return clocks;
+}
@@ -0,0 +1,35 @@
+#ifndef SIM8086_CLOCKS_H
+#define SIM8086_CLOCKS_H
+
+//////////////////////////////////////////
+// Clocks
+
+typedef u32 bus_mode_t;
+enum {
+	Bus_8086, // 16-bit data bus: only word transfers to odd addresses take an extra bus cycle
+	Bus_8088, // 8-bit data bus: every word transfer takes an extra bus cycle
+} bus_mode_enum_t;
+
+// NOTE(ema): Facts about an instruction that can only be known after executing it, and that
+// the clock estimation depends on.
+typedef struct execution_info_t execution_info_t;
+struct execution_info_t {
+	b32 unaligned;   // At least one word transfer was at an odd address
+	b32 jump_taken;
+	u32 repetitions; // Iterations done by a rep-prefixed string instruction
+	u32 shift_count; // Value of CL for shifts and rotates by CL
+	b32 unimplemented; // The engine doesn't know the instruction and didn't execute it
+};
+
+typedef struct instruction_clocks_t instruction_clocks_t;
+struct instruction_clocks_t {
+	u32 base;
+	u32 ea;
+	u32 penalty;
+	u32 total;
+};
+
+static int clocks_from_effective_address_expression(effective_address_expression *expr);
+static instruction_clocks_t estimate_instruction_clocks(instruction instr, execution_info_t info, bus_mode_t bus);
+
+#endif
@@ -0,0 +1,292 @@
+
+//////////////////////////////////////////
+// Frame dumps
+
+static u32 get_pixel_size(pixel_format_t format) {
+	u32 result = (format == Pixel_Rgba32) ? 4 : (format == Pixel_Rgb24) ? 3 : 1;
+	return result;
+}
+
+static bool parse_frame_description(frame_writer_t *writer, char *description) {
+	bool ok = 1;
+	
+	char *at = description;
+	u32 values[3] = {0};
+	for (int value_index = 0; ok && value_index < array_count(values); value_index += 1) {
+		char *end = at;
+		values[value_index] = (u32)strtoul(at, &end, 0);
+		ok = end != at && *end == ':';
+		at = end + 1;
+	}
+	
+	if (ok) {
+		if (strcmp(at, "gray") == 0) {
+			writer->format = Pixel_Gray8;
+		} else if (strcmp(at, "rgb") == 0) {
+			writer->format = Pixel_Rgb24;
+		} else if (strcmp(at, "rgba") == 0) {
+			writer->format = Pixel_Rgba32;
+		} else {
+			ok = 0;
+		}
+	}
+	
+	writer->address = values[0];
+	writer->width   = values[1];
+	writer->height  = values[2];
+	
+	u64 size = (u64)writer->width * writer->height * get_pixel_size(writer->format);
+	ok = ok && writer->width && writer->height && writer->address < 1024 * 1024 && size <= 1024 * 1024;
+	writer->frame_size = (u32)size;
+	
+	if (!ok) {
+		fprintf(stderr, "Invalid frame \"%s\": expected address:width:height:format, with format gray, rgb or rgba, at most 1MB\n", description);
+	}
+	
+	return ok;
+}
+
+//////////////////////////////////////////
+// PPM and PNG
+
+static void write_ppm(FILE *file, frame_writer_t *writer, u8 *pixels, u8 *scratch) {
+	bool gray = writer->format == Pixel_Gray8;
+	fprintf(file, "%s\n%u %u\n255\n", gray ? "P5" : "P6", writer->width, writer->height);
+	
+	if (writer->format == Pixel_Rgba32) {
+		for (u32 y = 0; y < writer->height; y += 1) {
+			u8 *row = pixels + (u64)y * writer->width * 4;
+			for (u32 x = 0; x < writer->width; x += 1) {
+				scratch[3*x + 0] = row[4*x + 0];
+				scratch[3*x + 1] = row[4*x + 1];
+				scratch[3*x + 2] = row[4*x + 2];
+			}
+			fwrite(scratch, 3, writer->width, file);
+		}
+	} else {
+		fwrite(pixels, 1, writer->frame_size, file);
+	}
+}
+
+static u32 crc32_table[256];
+
+static void init_crc32_table(void) {
+	for (u32 byte = 0; byte < 256; byte += 1) {
+		u32 crc = byte;
+		for (int bit = 0; bit < 8; bit += 1) {
+			crc = (crc & 1) ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+		}
+		crc32_table[byte] = crc;
+	}
+}
+
+typedef struct png_chunk_t png_chunk_t;
+struct png_chunk_t {
+	FILE *file;
+	u32 crc;
+};
+
+static void write_png_u32(FILE *file, u32 value) {
+	u8 bytes[4] = {(u8)(value >> 24), (u8)(value >> 16), (u8)(value >> 8), (u8)value};
+	fwrite(bytes, 1, 4, file);
+}
+
+static png_chunk_t begin_png_chunk(FILE *file, char *type, u32 len) {
+	png_chunk_t chunk = {file, 0xffffffff};
+	write_png_u32(file, len);
+	
+	for (int char_index = 0; char_index < 4; char_index += 1) {
+		chunk.crc = crc32_table[(chunk.crc ^ (u8)type[char_index]) & 0xff] ^ (chunk.crc >> 8);
+	}
+	fwrite(type, 1, 4, file);
+	
+	return chunk;
+}
+
+static void write_png_chunk_data(png_chunk_t *chunk, u8 *data, u32 len) {
+	for (u32 byte_index = 0; byte_index < len; byte_index += 1) {
+		chunk->crc = crc32_table[(chunk->crc ^ data[byte_index]) & 0xff] ^ (chunk->crc >> 8);
+	}
+	fwrite(data, 1, len, chunk->file);
+}
+
+static void end_png_chunk(png_chunk_t *chunk) {
+	write_png_u32(chunk->file, chunk->crc ^ 0xffffffff);
+}
+
+// NOTE(ema): The image data is stored in uncompressed deflate blocks, which every decoder
+// reads and which take no time to make. Every row starts with filter 0 (none).
+static void write_png(FILE *file, frame_writer_t *writer, u8 *pixels, u8 *scratch) {
+	u32 pixel_size = get_pixel_size(writer->format);
+	u32 row_size = writer->width * pixel_size;
+	u32 raw_size = writer->height * (1 + row_size);
+	
+	u8 *raw = scratch;
+	for (u32 y = 0; y < writer->height; y += 1) {
+		raw[(u64)y * (1 + row_size)] = 0;
+		memcpy(raw + (u64)y * (1 + row_size) + 1, pixels + (u64)y * row_size, row_size);
+	}
+	
+	u8 signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	fwrite(signature, 1, sizeof(signature), file);
+	
+	u8 color_type = (writer->format == Pixel_Rgba32) ? 6 : (writer->format == Pixel_Rgb24) ? 2 : 0;
+	u8 header[13] = {
+		(u8)(writer->width  >> 24), (u8)(writer->width  >> 16), (u8)(writer->width  >> 8), (u8)writer->width,
+		(u8)(writer->height >> 24), (u8)(writer->height >> 16), (u8)(writer->height >> 8), (u8)writer->height,
+		8, color_type, 0, 0, 0,
+	};
+	png_chunk_t chunk = begin_png_chunk(file, "IHDR", sizeof(header));
+	write_png_chunk_data(&chunk, header, sizeof(header));
+	end_png_chunk(&chunk);
+	
+	u32 block_count = (raw_size + 0xffff - 1) / 0xffff;
+	chunk = begin_png_chunk(file, "IDAT", 2 + 5*block_count + raw_size + 4);
+	
+	u8 zlib_header[2] = {0x78, 0x01};
+	write_png_chunk_data(&chunk, zlib_header, sizeof(zlib_header));
+	
+	u32 adler_a = 1;
+	u32 adler_b = 0;
+	for (u32 offset = 0; offset < raw_size; offset += 0xffff) {
+		u32 len = (raw_size - offset < 0xffff) ? raw_size - offset : 0xffff;
+		bool final = offset + len == raw_size;
+		
+		u8 block_header[5] = {final, (u8)len, (u8)(len >> 8), (u8)~len, (u8)(~len >> 8)};
+		write_png_chunk_data(&chunk, block_header, sizeof(block_header));
+		write_png_chunk_data(&chunk, raw + offset, len);
+		
+		for (u32 byte_index = 0; byte_index < len; byte_index += 1) {
+			adler_a = (adler_a + raw[offset + byte_index]) % 65521;
+			adler_b = (adler_b + adler_a) % 65521;
+		}
+	}
+	
+	u32 adler = (adler_b << 16) | adler_a;
+	u8 adler_bytes[4] = {(u8)(adler >> 24), (u8)(adler >> 16), (u8)(adler >> 8), (u8)adler};
+	write_png_chunk_data(&chunk, adler_bytes, sizeof(adler_bytes));
+	end_png_chunk(&chunk);
+	
+	chunk = begin_png_chunk(file, "IEND", 0);
+	end_png_chunk(&chunk);
+}
+
+//////////////////////////////////////////
+// Encoder thread
+
+static void encode_frames(void *param) {
+	frame_writer_t *writer = (frame_writer_t *)param;
+	
+	u8 *scratch = malloc(writer->height * (1 + writer->width * get_pixel_size(writer->format)));
+	
+	for (u32 frame_index = 0;; frame_index += 1) {
+		wait_semaphore(writer->queued);
+		
+		frame_t *frame = &writer->queue[frame_index % FRAME_QUEUE_SIZE];
+		if (frame->last) break;
+		
+		char name[64];
+		snprintf(name, sizeof(name), "frame_%05u.%s", frame->index, (writer->file_type == Image_Png) ? "png" : "ppm");
+		
+		FILE *file = fopen(name, "wb");
+		if (file && scratch) {
+			if (writer->file_type == Image_Png) {
+				write_png(file, writer, frame->pixels, scratch);
+			} else {
+				write_ppm(file, writer, frame->pixels, scratch);
+			}
+		} else {
+			fprintf(stderr, "Error writing '%s'\n", name);
+		}
+		if (file) fclose(file);
+		
+		if (writer->log) {
+			fprintf(writer->log, "%s,%llu,%llu,%llu\n", name, frame->instruction_count, frame->clock_count,
+					frame->clock_count - writer->log_clock_count);
+			writer->log_clock_count = frame->clock_count;
+		}
+		
+		signal_semaphore(writer->free_slots);
+	}
+	
+	free(scratch);
+}
+
+static bool start_frame_writer(frame_writer_t *writer) {
+	bool ok = 1;
+	
+	init_crc32_table();
+	
+	for (int slot_index = 0; ok && slot_index < FRAME_QUEUE_SIZE; slot_index += 1) {
+		writer->queue[slot_index].pixels = malloc(writer->frame_size);
+		ok = writer->queue[slot_index].pixels != 0;
+	}
+	
+	ok = ok && make_semaphore(&writer->queued, 0);
+	ok = ok && make_semaphore(&writer->free_slots, FRAME_QUEUE_SIZE);
+	
+	if (ok) {
+		writer->log = fopen("frames.csv", "w");
+		if (writer->log) {
+			fprintf(writer->log, "file,instructions,clocks,clocks since previous\n");
+		}
+		
+		ok = start_thread(&writer->encoder, encode_frames, writer);
+	}
+	
+	if (ok) {
+		writer->started = 1;
+	} else {
+		fprintf(stderr, "Couldn't start writing frames\n");
+	}
+	
+	return ok;
+}
+
+static void take_frame(frame_writer_t *writer, memory_t memory, u64 instruction_count, u64 clock_count) {
+	// NOTE(ema): The final frame is skipped if a periodic one was just taken.
+	if (writer->started && (writer->frame_count == 0 || instruction_count != writer->last_instruction_count)) {
+		wait_semaphore(writer->free_slots);
+		
+		frame_t *frame = &writer->queue[writer->frame_count % FRAME_QUEUE_SIZE];
+		frame->index             = writer->frame_count;
+		frame->instruction_count = instruction_count;
+		frame->clock_count       = clock_count;
+		frame->last              = 0;
+		
+		if (is_contiguous_range(memory, writer->address, writer->frame_size)) {
+			memcpy(frame->pixels, get_memory_ptr(memory, writer->address), writer->frame_size);
+		} else {
+			for (u32 byte_index = 0; byte_index < writer->frame_size; byte_index += 1) {
+				u8 *byte = get_memory_ptr(memory, writer->address + byte_index);
+				frame->pixels[byte_index] = byte ? *byte : 0;
+			}
+		}
+		
+		writer->frame_count += 1;
+		writer->last_instruction_count = instruction_count;
+		
+		signal_semaphore(writer->queued);
+	}
+}
+
+static void end_frame_writer(frame_writer_t *writer) {
+	if (writer->started) {
+		wait_semaphore(writer->free_slots);
+		writer->queue[writer->frame_count % FRAME_QUEUE_SIZE].last = 1;
+		signal_semaphore(writer->queued);
+		
+		join_thread(&writer->encoder);
+		writer->started = 0;
+	}
+	
+	if (writer->log) fclose(writer->log);
+	writer->log = 0;
+	
+	free_semaphore(writer->queued);
+	free_semaphore(writer->free_slots);
+	for (int slot_index = 0; slot_index < FRAME_QUEUE_SIZE; slot_index += 1) {
+		free(writer->queue[slot_index].pixels);
+		writer->queue[slot_index].pixels = 0;
+	}
+}
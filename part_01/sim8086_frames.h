@@ -0,0 +1,68 @@
+#ifndef SIM8086_FRAMES_H
+#define SIM8086_FRAMES_H
+
+//////////////////////////////////////////
+// Frame dumps
+
+// NOTE(ema): A region of the simulated memory is seen as an image (width*height pixels, rows
+// top to bottom, no padding), and copied every `interval` instructions and once more when the
+// program stops. The copies go through a small queue to a thread that encodes them to
+// frame_NNNNN.ppm (or .png) and logs the clocks of every frame to frames.csv, so the
+// simulation only waits for the encoder when the queue is full.
+
+#define FRAME_QUEUE_SIZE 8
+
+typedef u32 pixel_format_t;
+enum {
+	Pixel_Gray8,
+	Pixel_Rgb24,
+	Pixel_Rgba32, // Alpha is dropped in PPM files
+} pixel_format_enum_t;
+
+typedef u32 image_file_t;
+enum {
+	Image_Ppm,
+	Image_Png,
+} image_file_enum_t;
+
+typedef struct frame_t frame_t;
+struct frame_t {
+	u8 *pixels;
+	u32 index;
+	u64 instruction_count;
+	u64 clock_count;
+	bool last; // Tells the encoder to stop, the pixels are not meaningful
+};
+
+typedef struct frame_writer_t frame_writer_t;
+struct frame_writer_t {
+	physical_address_t address;
+	u32 width;
+	u32 height;
+	pixel_format_t format;
+	image_file_t file_type;
+	u64 interval; // Instructions between frames, 0 for only the one at the end
+	
+	u32 frame_size; // Bytes of simulated memory
+	u32 frame_count;
+	u64 last_instruction_count; // Of the last frame taken
+	
+	frame_t queue[FRAME_QUEUE_SIZE];
+	os_semaphore_t queued;
+	os_semaphore_t free_slots;
+	os_thread_t encoder;
+	
+	FILE *log;
+	u64 log_clock_count; // Of the previous frame written to the log
+	bool started;
+};
+
+// Parses "address:width:height:format", where format is gray, rgb or rgba and the address
+// can be in hex with 0x. Returns 0 and prints the reason if the description is invalid.
+static bool parse_frame_description(frame_writer_t *writer, char *description);
+
+static bool start_frame_writer(frame_writer_t *writer);
+static void take_frame(frame_writer_t *writer, memory_t memory, u64 instruction_count, u64 clock_count);
+static void end_frame_writer(frame_writer_t *writer); // Waits for the queued frames to be written
+
+#endif
@@ -0,0 +1,545 @@
+
+//////////////////////////////////////////
+// Differential fuzzing
+
+// NOTE(ema): Engines with a known bug, to check that the fuzzer finds it and shrinks it down to
+// the instruction that has it. One breaks a register and the other one only memory.
+static bool simulate_broken_adc(instruction instr, register_file_t *registers, memory_t memory, execution_info_t *info) {
+	bool result = simulate_8086_instruction(instr, registers, memory, info);
+	if (instr.Op == Op_adc) {
+		registers->flags ^= Flag_C;
+	}
+	return result;
+}
+
+static bool simulate_broken_push(instruction instr, register_file_t *registers, memory_t memory, execution_info_t *info) {
+	bool result = simulate_8086_instruction(instr, registers, memory, info);
+	if (instr.Op == Op_push) {
+		pointer_variable_t top = {registers->ss, registers->sp};
+		physical_address_t address = physical_address_from_pointer_variable(top);
+		memory_write_u8(memory, address, memory_read_u8(memory, address) ^ 0x80);
+	}
+	return result;
+}
+
+static fuzz_engine_t fuzz_engines[] = {
+	{"reference",   simulate_8086_instruction},
+	{"broken_adc",  simulate_broken_adc},
+	{"broken_push", simulate_broken_push},
+};
+
+// NOTE(ema): Only instructions that simulate_8086_instruction implements are generated; a
+// program that jumps into anything else ends there.
+static bool is_fuzzed_operation(operation_type op) {
+	bool result = 0;
+	switch (op) {
+		case Op_mov: case Op_add: case Op_adc: case Op_inc: case Op_sub: case Op_sbb: case Op_dec:
+		case Op_neg: case Op_cmp: case Op_mul: case Op_imul: case Op_not: case Op_and: case Op_or:
+		case Op_xor: case Op_test: case Op_shl: case Op_shr: case Op_push: case Op_pop:
+		case Op_pushf: case Op_popf: case Op_call: case Op_jmp: case Op_ret: case Op_retf:
+		case Op_je: case Op_jl: case Op_jle: case Op_jb: case Op_jbe: case Op_jp: case Op_jo:
+		case Op_js: case Op_jne: case Op_jnl: case Op_jg: case Op_jnb: case Op_ja: case Op_jnp:
+		case Op_jno: case Op_jns: case Op_loop: case Op_loopz: case Op_loopnz: case Op_jcxz:
+		case Op_movs: case Op_cmps: case Op_scas: case Op_lods: case Op_stos: case Op_clc:
+		case Op_stc: case Op_cmc: case Op_cld: case Op_std: case Op_cli: case Op_sti:
+		case Op_hlt: {
+			result = 1;
+		} break;
+		
+		default: break;
+	}
+	return result;
+}
+
+// splitmix64
+static u64 fuzz_random(u64 *state) {
+	*state += 0x9E3779B97F4A7C15ull;
+	
+	u64 z = *state;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+//////////////////////////////////////////
+// Generation
+
+// Fills the bit fields of the encoding (literal ones as given, the others at random) and
+// appends random bytes for the displacement and data, which sim86 then sizes. Returns the
+// size, or 0 if the bytes didn't decode to something that can be fuzzed.
+static u32 encode_random_instruction(instruction_encoding *encoding, u64 *rng, u8 *out) {
+	memset(out, 0, FUZZ_SLOT_SIZE);
+	
+	u32 bit_count = 0;
+	for (u32 bits_index = 0; bits_index < array_count(encoding->Bits); bits_index += 1) {
+		instruction_bits bits = encoding->Bits[bits_index];
+		if (bits.Usage == Bits_End) break;
+		
+		if (bits.BitCount > 0) {
+			u32 value = (bits.Usage == Bits_Literal) ? bits.Value : (u32)fuzz_random(rng);
+			for (u32 bit_index = 0; bit_index < bits.BitCount; bit_index += 1) {
+				u32 bit = (value >> (bits.BitCount - 1 - bit_index)) & 1;
+				out[bit_count / 8] |= (u8)(bit << (7 - bit_count % 8));
+				bit_count += 1;
+			}
+		}
+	}
+	
+	u32 byte_count = (bit_count + 7) / 8;
+	for (u32 byte_index = byte_count; byte_index < FUZZ_SLOT_SIZE; byte_index += 1) {
+		out[byte_index] = (u8)fuzz_random(rng);
+	}
+	
+	instruction decoded = {0};
+	Sim86_Decode8086Instruction(FUZZ_SLOT_SIZE, out, &decoded);
+	
+	u32 size = is_fuzzed_operation(decoded.Op) ? decoded.Size : 0;
+	return size;
+}
+
+static void generate_fuzz_case(fuzz_t *fuzz, u64 seed, fuzz_case_t *fuzz_case) {
+	memset(fuzz_case, 0, sizeof(*fuzz_case));
+	fuzz_case->seed = seed;
+	
+	u64 rng = seed;
+	for (int reg_index = 1; reg_index < Register_Count; reg_index += 1) {
+		fuzz_case->registers.as_words[reg_index] = (u16)fuzz_random(&rng);
+	}
+	
+	fuzz_case->registers.cs = FUZZ_CODE_SEGMENT;
+	fuzz_case->registers.ip = 0;
+	fuzz_case->registers.flags &= (Flag_C | Flag_P | Flag_A | Flag_Z | Flag_S | Flag_T | Flag_I | Flag_D | Flag_O);
+	
+	u32 instruction_count = 1 + (u32)(fuzz_random(&rng) % fuzz->max_instructions);
+	for (u32 instruction_index = 0; instruction_index < instruction_count; instruction_index += 1) {
+		u8 *slot = fuzz_case->code + fuzz_case->code_len;
+		
+		u32 size = 0;
+		for (int attempt = 0; size == 0 && attempt < 16; attempt += 1) {
+			u32 encoding_index = fuzz->encodings[fuzz_random(&rng) % fuzz->encoding_count];
+			size = encode_random_instruction(&fuzz->table.Encodings[encoding_index], &rng, slot);
+		}
+		
+		if (size) {
+			fuzz_case->instruction_sizes[fuzz_case->instruction_count++] = (u8)size;
+			fuzz_case->code_len += size;
+		}
+	}
+}
+
+//////////////////////////////////////////
+// Lockstep execution
+
+typedef struct fuzz_machine_t fuzz_machine_t;
+struct fuzz_machine_t {
+	memory_t memory;
+	u8 dirty_pages[MEMORY_PAGE_COUNT];
+};
+
+typedef struct fuzz_worker_t fuzz_worker_t;
+struct fuzz_worker_t {
+	fuzz_machine_t reference;
+	fuzz_machine_t candidate;
+};
+
+static bool make_fuzz_machine(fuzz_machine_t *machine, u8 *initial_memory) {
+	memset(machine, 0, sizeof(*machine));
+	
+	buffer_t bytes = {0};
+	bytes.len  = 1024 * 1024;
+	bytes.data = malloc(bytes.len);
+	
+	machine->memory = make_memory(bytes, 20);
+	machine->memory.dirty_pages = machine->dirty_pages;
+	
+	if (bytes.data) {
+		memcpy(bytes.data, initial_memory, bytes.len);
+	}
+	
+	return bytes.data != 0;
+}
+
+// NOTE(ema): Only the pages that either engine wrote can differ from the initial memory, so
+// only those are compared, and only those are copied back after a case.
+static bool compare_fuzz_memory(fuzz_worker_t *worker, u32 *first_difference) {
+	bool same = 1;
+	
+	for (u32 page_index = 0; same && page_index < MEMORY_PAGE_COUNT; page_index += 1) {
+		if (worker->reference.dirty_pages[page_index] || worker->candidate.dirty_pages[page_index]) {
+			u32 page_start = page_index << MEMORY_PAGE_SHIFT;
+			u8 *a = worker->reference.memory.bytes.data + page_start;
+			u8 *b = worker->candidate.memory.bytes.data + page_start;
+			
+			if (memcmp(a, b, MEMORY_PAGE_SIZE) != 0) {
+				u32 byte_index = 0;
+				while (a[byte_index] == b[byte_index]) byte_index += 1;
+				
+				*first_difference = page_start + byte_index;
+				same = 0;
+			}
+		}
+	}
+	
+	return same;
+}
+
+static void reset_fuzz_memory(fuzz_worker_t *worker, u8 *initial_memory) {
+	for (u32 page_index = 0; page_index < MEMORY_PAGE_COUNT; page_index += 1) {
+		if (worker->reference.dirty_pages[page_index] || worker->candidate.dirty_pages[page_index]) {
+			u32 page_start = page_index << MEMORY_PAGE_SHIFT;
+			memcpy(worker->reference.memory.bytes.data + page_start, initial_memory + page_start, MEMORY_PAGE_SIZE);
+			memcpy(worker->candidate.memory.bytes.data + page_start, initial_memory + page_start, MEMORY_PAGE_SIZE);
+			
+			worker->reference.dirty_pages[page_index] = 0;
+			worker->candidate.dirty_pages[page_index] = 0;
+		}
+	}
+}
+
+static simulator_t load_fuzz_case(fuzz_machine_t *machine, fuzz_case_t *fuzz_case) {
+	u32 code_offset = FUZZ_CODE_SEGMENT << 4;
+	for (u32 byte_index = 0; byte_index < fuzz_case->code_len; byte_index += 1) {
+		memory_write_u8(machine->memory, code_offset + byte_index, fuzz_case->code[byte_index]);
+	}
+	
+	simulator_t sim = make_simulator(machine->memory, code_offset, fuzz_case->code_len);
+	sim.registers = fuzz_case->registers;
+	
+	return sim;
+}
+
+// Returns 0 if the next instruction is one that can't be fuzzed, which ends the case.
+static bool can_step_fuzz_case(simulator_t *sim) {
+	bool result = 1;
+	
+	pointer_variable_t instruction_pointer = {sim->registers.cs, sim->registers.ip};
+	u32 code_index = (physical_address_from_pointer_variable(instruction_pointer) & sim->memory.mask) - sim->code_offset;
+	if (code_index < sim->code_len) {
+		instruction decoded = {0};
+		Sim86_Decode8086Instruction(sim->code_len - code_index, sim->memory.bytes.data + sim->code_offset + code_index, &decoded);
+		result = is_fuzzed_operation(decoded.Op);
+	}
+	
+	return result;
+}
+
+static fuzz_outcome_t run_fuzz_case(fuzz_t *fuzz, fuzz_worker_t *worker, fuzz_case_t *fuzz_case) {
+	fuzz_outcome_t outcome = {0};
+	
+	// The table decoder has to agree with sim86 on every generated instruction.
+	u32 code_index = 0;
+	for (u32 instruction_index = 0; instruction_index < fuzz_case->instruction_count; instruction_index += 1) {
+		Decoded_Instruction decoded;
+		u32 size = (u32)decode_instruction(fuzz_case->code + code_index, (int)(fuzz_case->code_len - code_index), &decoded);
+		if (size != fuzz_case->instruction_sizes[instruction_index]) {
+			outcome.result = Fuzz_Decoder_Mismatch;
+			outcome.step   = instruction_index;
+			break;
+		}
+		code_index += fuzz_case->instruction_sizes[instruction_index];
+	}
+	
+	if (outcome.result == Fuzz_Ok) {
+		simulator_t reference = load_fuzz_case(&worker->reference, fuzz_case);
+		simulator_t candidate = load_fuzz_case(&worker->candidate, fuzz_case);
+		
+		simulation_options_t reference_options = {0};
+		reference_options.exec   = 1;
+		reference_options.engine = fuzz->reference.simulate;
+		
+		simulation_options_t candidate_options = reference_options;
+		candidate_options.engine = fuzz->candidate.simulate;
+		
+		bool running = 1;
+		for (u32 step = 0; running && step < FUZZ_MAX_STEPS && can_step_fuzz_case(&reference); step += 1) {
+			running = step_8086(&reference, reference_options);
+			step_8086(&candidate, candidate_options);
+			
+			if (memcmp(&reference.registers, &candidate.registers, sizeof(register_file_t)) != 0) {
+				outcome.result = Fuzz_Register_Mismatch;
+			} else if (reference.stopped != candidate.stopped) {
+				outcome.result = Fuzz_Halt_Mismatch;
+			} else if (!compare_fuzz_memory(worker, &outcome.address)) {
+				outcome.result = Fuzz_Memory_Mismatch;
+			}
+			
+			if (outcome.result != Fuzz_Ok) {
+				outcome.step = step + 1;
+				outcome.reference_registers = reference.registers;
+				outcome.candidate_registers = candidate.registers;
+				running = 0;
+			}
+		}
+		
+		outcome.instruction_count = (u32)reference.instruction_count;
+		reset_fuzz_memory(worker, fuzz->initial_memory);
+	}
+	
+	return outcome;
+}
+
+static void fuzz_worker(void *param) {
+	fuzz_t *fuzz = (fuzz_t *)param;
+	
+	fuzz_worker_t *worker = malloc(sizeof(fuzz_worker_t));
+	bool ok = worker != 0;
+	ok = ok && make_fuzz_machine(&worker->reference, fuzz->initial_memory);
+	ok = ok && make_fuzz_machine(&worker->candidate, fuzz->initial_memory);
+	
+	while (ok) {
+		u32 batch_start = atomic_add_u32(&fuzz->next_batch, 1) * FUZZ_BATCH_SIZE;
+		if (batch_start >= fuzz->case_count) break;
+		
+		u32 batch_end = batch_start + FUZZ_BATCH_SIZE;
+		if (batch_end > fuzz->case_count) batch_end = fuzz->case_count;
+		
+		u64 instruction_count = 0;
+		for (u32 case_index = batch_start; case_index < batch_end; case_index += 1) {
+			fuzz_case_t fuzz_case;
+			generate_fuzz_case(fuzz, fuzz->seed + case_index, &fuzz_case);
+			
+			fuzz_outcome_t outcome = run_fuzz_case(fuzz, worker, &fuzz_case);
+			instruction_count += outcome.instruction_count;
+			
+			if (outcome.result != Fuzz_Ok) {
+				atomic_add_u32(&fuzz->failure_count, 1);
+				if (atomic_add_u32(&fuzz->failure_claimed, 1) == 0) {
+					fuzz->failure = fuzz_case;
+				}
+			}
+		}
+		
+		atomic_add_u64(&fuzz->instructions_executed, instruction_count);
+	}
+	
+	if (!ok) {
+		fprintf(stderr, "Out of memory\n");
+	}
+	
+	if (worker) {
+		free(worker->reference.memory.bytes.data);
+		free(worker->candidate.memory.bytes.data);
+		free(worker);
+	}
+}
+
+//////////////////////////////////////////
+// Shrinking
+
+static fuzz_case_t remove_fuzz_instruction(fuzz_case_t *fuzz_case, u32 removed_index) {
+	fuzz_case_t result = *fuzz_case;
+	result.instruction_count = 0;
+	result.code_len = 0;
+	
+	u32 code_index = 0;
+	for (u32 instruction_index = 0; instruction_index < fuzz_case->instruction_count; instruction_index += 1) {
+		u32 size = fuzz_case->instruction_sizes[instruction_index];
+		if (instruction_index != removed_index) {
+			memcpy(result.code + result.code_len, fuzz_case->code + code_index, size);
+			result.code_len += size;
+			result.instruction_sizes[result.instruction_count++] = (u8)size;
+		}
+		code_index += size;
+	}
+	
+	return result;
+}
+
+// NOTE(ema): Greedy: keeps dropping single instructions and clearing single registers for
+// as long as the case still fails in the same way.
+static fuzz_case_t shrink_fuzz_case(fuzz_t *fuzz, fuzz_worker_t *worker, fuzz_case_t fuzz_case, fuzz_result_t result) {
+	for (bool changed = 1; changed;) {
+		changed = 0;
+		
+		for (u32 instruction_index = fuzz_case.instruction_count; instruction_index > 0 && fuzz_case.instruction_count > 1; instruction_index -= 1) {
+			fuzz_case_t smaller = remove_fuzz_instruction(&fuzz_case, instruction_index - 1);
+			if (run_fuzz_case(fuzz, worker, &smaller).result == result) {
+				fuzz_case = smaller;
+				changed = 1;
+			}
+		}
+		
+		for (int reg_index = 1; reg_index < Register_Count; reg_index += 1) {
+			if (reg_index != Register_cs && reg_index != Register_ip && fuzz_case.registers.as_words[reg_index]) {
+				fuzz_case_t simpler = fuzz_case;
+				simpler.registers.as_words[reg_index] = 0;
+				if (run_fuzz_case(fuzz, worker, &simpler).result == result) {
+					fuzz_case = simpler;
+					changed = 1;
+				}
+			}
+		}
+	}
+	
+	return fuzz_case;
+}
+
+//////////////////////////////////////////
+// Entry points
+
+static bool start_fuzz(fuzz_t *fuzz, char *candidate_name, u64 seed, u32 case_count) {
+	bool ok = 1;
+	
+	memset(fuzz, 0, sizeof(*fuzz));
+	fuzz->reference = fuzz_engines[0];
+	fuzz->seed = seed;
+	fuzz->case_count = case_count;
+	fuzz->max_instructions = FUZZ_MAX_INSTRUCTIONS;
+	
+	ok = 0;
+	for (u32 engine_index = 0; engine_index < array_count(fuzz_engines); engine_index += 1) {
+		if (strcmp(fuzz_engines[engine_index].name, candidate_name) == 0) {
+			fuzz->candidate = fuzz_engines[engine_index];
+			ok = 1;
+		}
+	}
+	
+	if (ok && fuzz->candidate.simulate == fuzz->reference.simulate) {
+		fprintf(stderr, "Warning: The candidate is the reference engine, so only the decoder sizes are really checked. "
+				"Pick another one with -engine.\n");
+	}
+	
+	if (!ok) {
+		fprintf(stderr, "Unknown engine '%s'. Engines:", candidate_name);
+		for (u32 engine_index = 0; engine_index < array_count(fuzz_engines); engine_index += 1) {
+			fprintf(stderr, " %s", fuzz_engines[engine_index].name);
+		}
+		fprintf(stderr, "\n");
+	}
+	
+	if (ok) {
+		Sim86_Get8086InstructionTable(&fuzz->table);
+		
+		fuzz->encodings = malloc(sizeof(u32) * (fuzz->table.EncodingCount + 1));
+		fuzz->initial_memory = malloc(1024 * 1024);
+		ok = fuzz->encodings && fuzz->initial_memory;
+		if (!ok) fprintf(stderr, "Out of memory\n");
+	}
+	
+	if (ok) {
+		for (u32 encoding_index = 0; encoding_index < fuzz->table.EncodingCount; encoding_index += 1) {
+			if (is_fuzzed_operation(fuzz->table.Encodings[encoding_index].Op)) {
+				fuzz->encodings[fuzz->encoding_count++] = encoding_index;
+			}
+		}
+		
+		if (fuzz->encoding_count == 0) {
+			fprintf(stderr, "The instruction table has no encodings that can be fuzzed\n");
+			ok = 0;
+		}
+	}
+	
+	// NOTE(ema): The memory image doesn't depend on the seed of the run, so that the seed of a
+	// case is enough to reproduce it.
+	if (ok) {
+		u64 rng = 0x6D656D6F7279ull;
+		for (u32 byte_index = 0; byte_index < 1024 * 1024; byte_index += 8) {
+			u64 value = fuzz_random(&rng);
+			memcpy(fuzz->initial_memory + byte_index, &value, 8);
+		}
+	}
+	
+	return ok;
+}
+
+static void run_fuzz(fuzz_t *fuzz, u32 thread_count) {
+	u32 batch_count = (fuzz->case_count + FUZZ_BATCH_SIZE - 1) / FUZZ_BATCH_SIZE;
+	if (thread_count > batch_count) thread_count = batch_count;
+	if (thread_count == 0) thread_count = 1;
+	
+	u64 start = read_os_timer();
+	run_on_threads(thread_count, fuzz_worker, fuzz);
+	fuzz->ticks = read_os_timer() - start;
+}
+
+// Prints the registers that aren't 0, and marks with '!' the ones that differ from `other`.
+static void print_fuzz_registers(char *label, register_file_t *registers, register_file_t *other) {
+	printf("%s:", label);
+	for (int reg_index = 1; reg_index < Register_Count; reg_index += 1) {
+		bool differs = other && registers->as_words[reg_index] != other->as_words[reg_index];
+		if (reg_index != Register_flags && (registers->as_words[reg_index] || differs)) {
+			register_access reg = {reg_index, 0, 2};
+			printf(" %s=0x%04x%s", Sim86_RegisterNameFromOperand(&reg), registers->as_words[reg_index], differs ? "!" : "");
+		}
+	}
+	
+	printf(" flags=");
+	print_cpu_flags(stdout, registers->flags);
+	printf("%s\n", (other && registers->flags != other->flags) ? "!" : "");
+}
+
+static bool report_fuzz(fuzz_t *fuzz) {
+	static char *result_names[] = {
+		[Fuzz_Ok]                = "ok",
+		[Fuzz_Decoder_Mismatch]  = "decoder size mismatch",
+		[Fuzz_Register_Mismatch] = "register mismatch",
+		[Fuzz_Memory_Mismatch]   = "memory mismatch",
+		[Fuzz_Halt_Mismatch]     = "halt mismatch",
+	};
+	
+	double seconds = (double)fuzz->ticks / (double)get_os_timer_frequency();
+	if (seconds <= 0) seconds = 1e-9;
+	
+	printf("Fuzzed %s against %s: %u cases from seed %llu, %llu instructions in %.2fs (%.0f cases/s), %u failures\n",
+		   fuzz->candidate.name, fuzz->reference.name, fuzz->case_count, fuzz->seed, fuzz->instructions_executed,
+		   seconds, (double)fuzz->case_count / seconds, fuzz->failure_count);
+	
+	if (fuzz->failure_count) {
+		fuzz_worker_t *worker = malloc(sizeof(fuzz_worker_t));
+		bool ok = worker != 0;
+		ok = ok && make_fuzz_machine(&worker->reference, fuzz->initial_memory);
+		ok = ok && make_fuzz_machine(&worker->candidate, fuzz->initial_memory);
+		
+		if (ok) {
+			fuzz_outcome_t original = run_fuzz_case(fuzz, worker, &fuzz->failure);
+			fuzz_case_t minimal = shrink_fuzz_case(fuzz, worker, fuzz->failure, original.result);
+			fuzz_outcome_t outcome = run_fuzz_case(fuzz, worker, &minimal);
+			
+			printf("\nFailing case: seed=%llu (%u instructions), %s\n", fuzz->failure.seed,
+				   fuzz->failure.instruction_count, result_names[original.result]);
+			printf("Shrunk to %u instructions, %s after %u:\n", minimal.instruction_count,
+				   result_names[outcome.result], outcome.step);
+			
+			u32 code_index = 0;
+			for (u32 instruction_index = 0; instruction_index < minimal.instruction_count; instruction_index += 1) {
+				instruction decoded = {0};
+				Sim86_Decode8086Instruction(minimal.code_len - code_index, minimal.code + code_index, &decoded);
+				
+				printf("  ");
+				for (u32 byte_index = 0; byte_index < FUZZ_SLOT_SIZE; byte_index += 1) {
+					if (byte_index < decoded.Size) printf("%02x ", minimal.code[code_index + byte_index]);
+					else if (byte_index < 6)       printf("   ");
+				}
+				print_8086_instruction(stdout, decoded);
+				printf("\n");
+				
+				code_index += minimal.instruction_sizes[instruction_index];
+			}
+			
+			print_fuzz_registers("Initial registers", &minimal.registers, 0);
+			if (outcome.result == Fuzz_Register_Mismatch || outcome.result == Fuzz_Halt_Mismatch) {
+				print_fuzz_registers(fuzz->reference.name, &outcome.reference_registers, &outcome.candidate_registers);
+				print_fuzz_registers(fuzz->candidate.name, &outcome.candidate_registers, &outcome.reference_registers);
+			} else if (outcome.result == Fuzz_Memory_Mismatch) {
+				printf("First differing byte at 0x%05x\n", outcome.address);
+			}
+			
+			printf("Run it alone with: -fuzz 1 -seed %llu -engine %s\n", fuzz->failure.seed, fuzz->candidate.name);
+		} else {
+			fprintf(stderr, "Out of memory\n");
+		}
+		
+		if (worker) {
+			free(worker->reference.memory.bytes.data);
+			free(worker->candidate.memory.bytes.data);
+			free(worker);
+		}
+	}
+	
+	return fuzz->failure_count == 0;
+}
+
+static void end_fuzz(fuzz_t *fuzz) {
+	free(fuzz->encodings);
+	free(fuzz->initial_memory);
+}
@@ -0,0 +1,82 @@
+#ifndef SIM8086_FUZZ_H
+#define SIM8086_FUZZ_H
+
+//////////////////////////////////////////
+// Differential fuzzing
+
+// NOTE(ema): Random programs are built from the encodings returned by
+// Sim86_Get8086InstructionTable and run by two engines in lockstep, comparing the registers
+// and the written memory after every instruction. Every instruction is also decoded by the
+// table-driven decoder of dec8086, which must agree with sim86 on its size.
+// A case is completely determined by its seed, so any failure can be run again alone.
+
+#define FUZZ_MAX_INSTRUCTIONS 32
+#define FUZZ_MAX_STEPS        256     // Programs can loop
+#define FUZZ_SLOT_SIZE        16      // Room for one generated instruction
+#define FUZZ_CODE_SEGMENT     0xF000  // The code goes at physical address 0xF0000
+#define FUZZ_BATCH_SIZE       256     // Cases taken by a thread at a time
+
+typedef struct fuzz_engine_t fuzz_engine_t;
+struct fuzz_engine_t {
+	char *name;
+	simulate_instruction_proc_t *simulate;
+};
+
+typedef u32 fuzz_result_t;
+enum {
+	Fuzz_Ok,
+	Fuzz_Decoder_Mismatch,  // The table decoder disagrees with sim86 about an instruction's size
+	Fuzz_Register_Mismatch,
+	Fuzz_Memory_Mismatch,
+	Fuzz_Halt_Mismatch,     // Only one engine halted
+} fuzz_result_enum_t;
+
+typedef struct fuzz_case_t fuzz_case_t;
+struct fuzz_case_t {
+	u64 seed;
+	register_file_t registers; // Before the first instruction
+	
+	u32 instruction_count;
+	u8  instruction_sizes[FUZZ_MAX_INSTRUCTIONS];
+	u32 code_len;
+	u8  code[FUZZ_MAX_INSTRUCTIONS * FUZZ_SLOT_SIZE];
+};
+
+typedef struct fuzz_outcome_t fuzz_outcome_t;
+struct fuzz_outcome_t {
+	fuzz_result_t result;
+	u32 step;    // Number of instructions executed when the engines disagreed
+	u32 address; // First differing byte, for memory mismatches
+	u32 instruction_count; // Executed by the reference engine
+	register_file_t reference_registers;
+	register_file_t candidate_registers;
+};
+
+typedef struct fuzz_t fuzz_t;
+struct fuzz_t {
+	fuzz_engine_t reference;
+	fuzz_engine_t candidate;
+	
+	instruction_table table;
+	u32 *encodings; // Indices of the encodings the reference engine implements
+	u32  encoding_count;
+	u8  *initial_memory; // The same random 1MB at the start of every case
+	
+	u64 seed;
+	u32 case_count;
+	u32 max_instructions;
+	
+	volatile u32 next_batch;
+	volatile u64 instructions_executed;
+	volatile u32 failure_count;
+	volatile u32 failure_claimed;
+	fuzz_case_t failure; // Whichever failure was found first, before shrinking
+	u64 ticks;
+};
+
+static bool start_fuzz(fuzz_t *fuzz, char *candidate_name, u64 seed, u32 case_count);
+static void run_fuzz(fuzz_t *fuzz, u32 thread_count);
+static bool report_fuzz(fuzz_t *fuzz); // Shrinks the failure, if any, and prints it. Returns 1 if all cases passed
+static void end_fuzz(fuzz_t *fuzz);
+
+#endif
@@ -22,10 +22,27 @@ static u8 *get_memory_ptr(memory_t memory, physical_address_t address) {
 
 static void memory_write_u8(memory_t memory, physical_address_t address, u8 value) {
 	*get_memory_ptr(memory, address) = value;
+	
+	if (memory.dirty_pages) {
+		memory.dirty_pages[(address & memory.mask) >> MEMORY_PAGE_SHIFT] = 1;
+	}
+
+#if MEMORY_TRACE
+	if (memory.trace) {
+		record_memory_access(memory.trace, address & memory.mask, Access_Write);
+	}
+#endif
 }
 
 static u8 memory_read_u8(memory_t memory, physical_address_t address) {
 	u8 result = *get_memory_ptr(memory, address);
+
+#if MEMORY_TRACE
+	if (memory.trace) {
+		record_memory_access(memory.trace, address & memory.mask, Access_Read);
+	}
+#endif
+
 	return result;
 }
 
@@ -47,13 +64,57 @@ static void memory_write_n(memory_t memory, physical_address_t address, u16 valu
     }
 }
 
+static bool is_contiguous_range(memory_t memory, physical_address_t address, u32 size) {
+	physical_address_t masked = address & memory.mask;
+	u32 limit = (memory.mask + 1 < memory.bytes.len) ? memory.mask + 1 : (u32)memory.bytes.len;
+	
+	bool result = masked <= limit && size <= limit - masked;
+	return result;
+}
+
+static void mark_dirty_range(memory_t memory, physical_address_t address, u32 size) {
+	if (memory.dirty_pages && size) {
+		physical_address_t masked = address & memory.mask;
+		for (u32 page_index = masked >> MEMORY_PAGE_SHIFT; page_index <= (masked + size - 1) >> MEMORY_PAGE_SHIFT; page_index += 1) {
+			memory.dirty_pages[page_index] = 1;
+		}
+	}
+}
+
+static void memory_move(memory_t memory, physical_address_t dest, physical_address_t source, u32 size) {
+	assert(is_contiguous_range(memory, dest, size) && is_contiguous_range(memory, source, size));
+	
+	memmove(get_memory_ptr(memory, dest), get_memory_ptr(memory, source), size);
+	mark_dirty_range(memory, dest, size);
+}
+
+static void memory_fill(memory_t memory, physical_address_t dest, u16 value, u32 element_size, u32 count) {
+	assert(is_contiguous_range(memory, dest, element_size * count));
+	
+	u8 *at = get_memory_ptr(memory, dest);
+	u8 low  = (u8)(value & 0xff);
+	u8 high = (u8)(value >> 8);
+	
+	if (element_size == 1 || low == high) {
+		memset(at, low, element_size * count);
+	} else {
+		for (u32 element_index = 0; element_index < count; element_index += 1) {
+			at[2*element_index + 0] = low;
+			at[2*element_index + 1] = high;
+		}
+	}
+	
+	mark_dirty_range(memory, dest, element_size * count);
+}
+
 //////////////////////////////////////////
 // Memory segments
 
 // Computes a physical 20-bit address from a logical 32-bit address composed of a base and an offset.
-// See page 2-13 of the manual.
+// See page 2-13 of the manual. The result can be 1 bit wider than 20 bits; it wraps around when
+// it's masked by the memory it's used with.
 static physical_address_t physical_address_from_pointer_variable(pointer_variable_t pointer) {
-	physical_address_t result = ((u32)pointer.base << 4) | (u32)pointer.offset;
+	physical_address_t result = ((u32)pointer.base << 4) + (u32)pointer.offset;
 	return result;
 }
 
@@ -67,11 +128,18 @@ static pointer_variable_t pointer_from_components(effective_address_expression_t
 		result.base = read_register_u16(registers, effective_address.ExplicitSegment);
 	}
 	
-	result.offset = (u16)effective_address.Displacement;
+	result.offset = offset_from_components(effective_address, registers);
+	
+	return result;
+}
+
+// The offset part of pointer_from_components(), for callers that already know the segment.
+static u16 offset_from_components(effective_address_expression_t effective_address, register_file_t *registers) {
+	u16 result = (u16)effective_address.Displacement;
 	for (int term_index = 0; term_index < array_count(effective_address.Terms); term_index += 1) {
 		effective_address_term term = effective_address.Terms[term_index];
 		u16 value = (u16)(term.Scale * read_register(registers, term.Register));
-		result.offset += value;
+		result += value;
 	}
 	
 	return result;
@@ -86,3 +154,23 @@ static register_access_t infer_default_segment(instruction_operand *operand) {
 	
 	return result;
 }
+
+//////////////////////////////////////////
+// Stack
+
+// The stack grows downwards and SS:SP points at the last word pushed. See page 2-15 of the manual.
+static void push_u16(register_file_t *registers, memory_t memory, u16 value) {
+	registers->sp -= 2;
+	
+	pointer_variable_t top = {registers->ss, registers->sp};
+	memory_write_u16(memory, physical_address_from_pointer_variable(top), value);
+}
+
+static u16 pop_u16(register_file_t *registers, memory_t memory) {
+	pointer_variable_t top = {registers->ss, registers->sp};
+	u16 value = memory_read_u16(memory, physical_address_from_pointer_variable(top));
+	
+	registers->sp += 2;
+	
+	return value;
+}
@@ -4,13 +4,28 @@
 //////////////////////////////////////////
 // Memory
 
+#if !defined(MEMORY_TRACE)
+#define MEMORY_TRACE 0
+#endif
+
 typedef register_access register_access_t;
 typedef union register_file_t register_file_t;
 
+// NOTE(ema): Memory is split in pages only to track which parts of it were written.
+#define MEMORY_PAGE_SHIFT 12
+#define MEMORY_PAGE_SIZE  (1 << MEMORY_PAGE_SHIFT)
+#define MEMORY_PAGE_COUNT ((1 << 20) >> MEMORY_PAGE_SHIFT)
+
 typedef struct memory_t memory_t;
 struct memory_t {
 	buffer_t bytes;
 	u32 mask;
+	
+	u8 *dirty_pages; // Optional, one flag per page, set when the page is written
+
+#if MEMORY_TRACE
+	struct memory_trace_t *trace; // Optional, records every byte read or written
+#endif
 };
 
 typedef u32 physical_address_t;
@@ -26,6 +41,12 @@ static u16 memory_read_u16(memory_t memory, physical_address_t address);
 
 static void memory_write_n(memory_t memory, physical_address_t address, u16 value, u32 size);
 
+// NOTE(ema): Bulk transfers for ranges that don't wrap around the end of the memory, which
+// is_contiguous_range checks. They mark the dirty pages, but they are not traced.
+static bool is_contiguous_range(memory_t memory, physical_address_t address, u32 size);
+static void memory_move(memory_t memory, physical_address_t dest, physical_address_t source, u32 size);
+static void memory_fill(memory_t memory, physical_address_t dest, u16 value, u32 element_size, u32 count);
+
 //////////////////////////////////////////
 // Memory segments
 
@@ -40,5 +61,12 @@ typedef effective_address_expression effective_address_expression_t;
 
 static physical_address_t physical_address_from_pointer_variable(pointer_variable_t pointer);
 static pointer_variable_t pointer_from_components(effective_address_expression_t effective_address, register_access_t default_segment, register_file_t *registers);
+static u16 offset_from_components(effective_address_expression_t effective_address, register_file_t *registers);
+
+//////////////////////////////////////////
+// Stack
+
+static void push_u16(register_file_t *registers, memory_t memory, u16 value);
+static u16  pop_u16(register_file_t *registers, memory_t memory);
 
 #endif
@@ -0,0 +1,219 @@
+
+//////////////////////////////////////////
+// Guest profile
+
+static guest_profile_t *make_guest_profile(void) {
+	guest_profile_t *profile = calloc(1, sizeof(guest_profile_t));
+	if (profile) {
+		profile->next_is_leader = 1;
+	}
+	return profile;
+}
+
+static bool is_control_transfer(operation_type op) {
+	bool result = 0;
+	switch (op) {
+		case Op_call:
+		case Op_jmp:
+		case Op_ret:
+		case Op_retf:
+		case Op_je:
+		case Op_jl:
+		case Op_jle:
+		case Op_jb:
+		case Op_jbe:
+		case Op_jp:
+		case Op_jo:
+		case Op_js:
+		case Op_jne:
+		case Op_jnl:
+		case Op_jg:
+		case Op_jnb:
+		case Op_ja:
+		case Op_jnp:
+		case Op_jno:
+		case Op_jns:
+		case Op_loop:
+		case Op_loopz:
+		case Op_loopnz:
+		case Op_jcxz:
+		case Op_int:
+		case Op_int3:
+		case Op_into:
+		case Op_iret:
+		case Op_hlt: {
+			result = 1;
+		} break;
+		
+		default: break;
+	}
+	return result;
+}
+
+static void profile_record_instruction(guest_profile_t *profile, u32 offset, instruction instr, u32 clocks) {
+	profile->hit_counts[offset]   += 1;
+	profile->clock_counts[offset] += clocks;
+	profile->sizes[offset] = (u8)instr.Size;
+	
+	profile->total_hits   += 1;
+	profile->total_clocks += clocks;
+	
+	if (profile->next_is_leader) {
+		profile->flags[offset] |= Profile_Leader;
+		profile->next_is_leader = 0;
+	}
+	
+	if (is_control_transfer(instr.Op)) {
+		// NOTE(ema): Both the fallthrough and the actual destination start a new block, whether
+		// the jump was taken or not. The destination is marked when it gets executed, so that
+		// a jump to an address that is never reached doesn't create an empty block.
+		profile->flags[offset] |= Profile_Ends_Block;
+		profile->flags[(offset + instr.Size) % PROFILE_TABLE_SIZE] |= Profile_Leader;
+		profile->next_is_leader = 1;
+	}
+}
+
+static int compare_profile_entries_for_qsort(const void *a_entry, const void *b_entry) {
+	profile_entry_t *a = (profile_entry_t *)a_entry;
+	profile_entry_t *b = (profile_entry_t *)b_entry;
+	
+	int result = 0;
+	if      (a->clocks < b->clocks) result =  1;
+	else if (a->clocks > b->clocks) result = -1;
+	else if (a->hits   < b->hits)   result =  1;
+	else if (a->hits   > b->hits)   result = -1;
+	else if (a->offset > b->offset) result =  1;
+	else if (a->offset < b->offset) result = -1;
+	
+	return result;
+}
+
+// Fills `entries` with one entry per executed instruction, sorted from hottest to coldest.
+// Returns the number of entries written.
+static u32 collect_profile_instructions(guest_profile_t *profile, profile_entry_t *entries) {
+	u32 count = 0;
+	for (u32 offset = 0; offset < array_count(profile->hit_counts); offset += 1) {
+		if (profile->hit_counts[offset]) {
+			profile_entry_t *entry = &entries[count++];
+			entry->offset      = offset;
+			entry->last_offset = offset;
+			entry->hits        = profile->hit_counts[offset];
+			entry->clocks      = profile->clock_counts[offset];
+		}
+	}
+	
+	qsort(entries, count, sizeof(entries[0]), compare_profile_entries_for_qsort);
+	return count;
+}
+
+// Groups executed instructions in basic blocks by walking them in address order. A block
+// ends at a control transfer, before a leader, or before an instruction that was never executed.
+// The number of runs of a block is the hit count of its first instruction.
+static u32 collect_profile_blocks(guest_profile_t *profile, profile_entry_t *entries) {
+	u32 count = 0;
+	
+	profile_entry_t *block = 0;
+	u32 expected_offset = 0;
+	for (u32 offset = 0; offset < array_count(profile->hit_counts); offset += 1) {
+		if (profile->hit_counts[offset]) {
+			if (!block || offset != expected_offset || (profile->flags[offset] & Profile_Leader)) {
+				block = &entries[count++];
+				block->offset = offset;
+				block->hits   = profile->hit_counts[offset];
+				block->clocks = 0;
+			}
+			
+			block->last_offset = offset;
+			block->clocks += profile->clock_counts[offset];
+			expected_offset = offset + profile->sizes[offset];
+			
+			if (profile->flags[offset] & Profile_Ends_Block) {
+				block = 0;
+			}
+		}
+	}
+	
+	qsort(entries, count, sizeof(entries[0]), compare_profile_entries_for_qsort);
+	return count;
+}
+
+static double percent_of(u64 part, u64 total) {
+	double result = total ? (100.0 * (double)part / (double)total) : 0;
+	return result;
+}
+
+static void print_guest_profile(guest_profile_t *profile, u8 *code, u32 code_len, u32 max_entries) {
+	profile_entry_t *entries = malloc(sizeof(profile_entry_t) * array_count(profile->hit_counts));
+	if (entries) {
+		printf("Guest profile: %llu instructions, %llu clocks\n", profile->total_hits, profile->total_clocks);
+		
+		u32 count = collect_profile_instructions(profile, entries);
+		if (count > max_entries) count = max_entries;
+		
+		printf("\nHottest instructions:\n");
+		printf("   offset        hits      clocks        %%  instruction\n");
+		for (u32 entry_index = 0; entry_index < count; entry_index += 1) {
+			profile_entry_t *entry = &entries[entry_index];
+			
+			printf("  0x%05x  %10llu  %10llu  %6.2f%%  ", entry->offset, entry->hits, entry->clocks,
+				   percent_of(entry->clocks, profile->total_clocks));
+			
+			instruction decoded = {0};
+			if (entry->offset < code_len) {
+				Sim86_Decode8086Instruction(code_len - entry->offset, code + entry->offset, &decoded);
+			}
+			if (decoded.Op) {
+				print_8086_instruction(stdout, decoded);
+			}
+			printf("\n");
+		}
+		
+		count = collect_profile_blocks(profile, entries);
+		if (count > max_entries) count = max_entries;
+		
+		printf("\nHottest basic blocks:\n");
+		printf("                range        runs      clocks        %%\n");
+		for (u32 entry_index = 0; entry_index < count; entry_index += 1) {
+			profile_entry_t *entry = &entries[entry_index];
+			
+			printf("  0x%05x - 0x%05x  %10llu  %10llu  %6.2f%%\n", entry->offset, entry->last_offset,
+				   entry->hits, entry->clocks, percent_of(entry->clocks, profile->total_clocks));
+		}
+		
+		printf("\n");
+		free(entries);
+	} else {
+		fprintf(stderr, "Out of memory");
+	}
+}
+
+static void write_guest_profile_csv(guest_profile_t *profile, u8 *code, u32 code_len, char *name) {
+	profile_entry_t *entries = malloc(sizeof(profile_entry_t) * array_count(profile->hit_counts));
+	FILE *file = fopen(name, "wb");
+	if (entries && file) {
+		u32 count = collect_profile_instructions(profile, entries);
+		
+		fprintf(file, "offset,hits,clocks,clocks_percent,block_leader,instruction\n");
+		for (u32 entry_index = 0; entry_index < count; entry_index += 1) {
+			profile_entry_t *entry = &entries[entry_index];
+			
+			fprintf(file, "%u,%llu,%llu,%f,%u,\"", entry->offset, entry->hits, entry->clocks,
+					percent_of(entry->clocks, profile->total_clocks),
+					(profile->flags[entry->offset] & Profile_Leader) ? 1 : 0);
+			
+			instruction decoded = {0};
+			if (entry->offset < code_len) {
+				Sim86_Decode8086Instruction(code_len - entry->offset, code + entry->offset, &decoded);
+			}
+			if (decoded.Op) {
+				print_8086_instruction(file, decoded);
+			}
+			fprintf(file, "\"\n");
+		}
+	} else {
+		fprintf(stderr, "Error opening file '%s'\n", name);
+	}
+	
+	if (file) fclose(file);
+	free(entries);
+}
@@ -0,0 +1,45 @@
+#ifndef SIM8086_PROFILE_H
+#define SIM8086_PROFILE_H
+
+//////////////////////////////////////////
+// Guest profile
+
+typedef u8 profile_ip_flags_t;
+enum {
+	Profile_Leader     = 1 << 0, // First instruction of a basic block
+	Profile_Ends_Block = 1 << 1, // Control transfer: the basic block ends after this instruction
+} profile_ip_flags_enum_t;
+
+// NOTE(ema): Everything is indexed by the offset of the instruction in the code, not by IP, so
+// that a program that sets CS doesn't mix up instructions with the same IP in different
+// segments. The tables cover the whole address space, so every instruction the simulator can
+// possibly execute has a slot.
+#define PROFILE_TABLE_SIZE (1 << 20)
+
+typedef struct guest_profile_t guest_profile_t;
+struct guest_profile_t {
+	u64 hit_counts[PROFILE_TABLE_SIZE];
+	u64 clock_counts[PROFILE_TABLE_SIZE];
+	u8  sizes[PROFILE_TABLE_SIZE];
+	profile_ip_flags_t flags[PROFILE_TABLE_SIZE];
+	
+	u64 total_hits;
+	u64 total_clocks;
+	bool next_is_leader;
+};
+
+typedef struct profile_entry_t profile_entry_t;
+struct profile_entry_t {
+	u32 offset;
+	u32 last_offset; // Only meaningful for basic blocks
+	u64 hits;
+	u64 clocks;
+};
+
+static guest_profile_t *make_guest_profile(void);
+static void profile_record_instruction(guest_profile_t *profile, u32 offset, instruction instr, u32 clocks);
+
+static void print_guest_profile(guest_profile_t *profile, u8 *code, u32 code_len, u32 max_entries);
+static void write_guest_profile_csv(guest_profile_t *profile, u8 *code, u32 code_len, char *name);
+
+#endif
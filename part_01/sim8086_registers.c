@@ -37,3 +37,40 @@ static u16 read_register_u16(register_file_t *registers, u32 index) {
 	u16 result = read_register(registers, access);
     return result;
 }
+
+//////////////////////////////////////////
+// Flags
+
+static char cpu_flag_chars[] = {
+	[Flag_C_shift] = 'C',
+	[Flag_P_shift] = 'P',
+	[Flag_A_shift] = 'A',
+	[Flag_Z_shift] = 'Z',
+	[Flag_S_shift] = 'S',
+	[Flag_T_shift] = 'T',
+	[Flag_I_shift] = 'I',
+	[Flag_D_shift] = 'D',
+	[Flag_O_shift] = 'O',
+};
+
+static void print_cpu_flags(FILE *out, cpu_flags_t flags) {
+	for (int i = 0; i < array_count(cpu_flag_chars); i += 1) {
+		cpu_flags_t flag = 1 << i;
+		if (flag & flags) {
+			fprintf(out, "%c", cpu_flag_chars[i]);
+		}
+	}
+}
+
+// Inverse of print_cpu_flags. Characters that don't name a flag are ignored.
+static cpu_flags_t parse_cpu_flags(char *chars, u32 len) {
+	cpu_flags_t flags = 0;
+	for (u32 char_index = 0; char_index < len; char_index += 1) {
+		for (int i = 0; i < array_count(cpu_flag_chars); i += 1) {
+			if (cpu_flag_chars[i] && cpu_flag_chars[i] == chars[char_index]) {
+				flags |= 1 << i;
+			}
+		}
+	}
+	return flags;
+}
@@ -94,4 +94,7 @@ enum {
 	Flag_O = 1 << Flag_O_shift,
 } cpu_flags_enum_t;
 
+static void print_cpu_flags(FILE *out, cpu_flags_t flags);
+static cpu_flags_t parse_cpu_flags(char *chars, u32 len);
+
 #endif
@@ -0,0 +1,57 @@
+#ifndef SIM8086_SIMULATOR_H
+#define SIM8086_SIMULATOR_H
+
+//////////////////////////////////////////
+// Simulator state
+
+// NOTE(ema): Executes one decoded instruction; returns 1 if it halts the machine.
+// simulate_8086_instruction is the reference one.
+typedef bool simulate_instruction_proc_t(instruction instr, register_file_t *registers, memory_t memory, execution_info_t *info);
+
+typedef struct simulation_options_t simulation_options_t;
+struct simulation_options_t {
+	bool exec;
+	bool show;
+	bool clocks;
+	bus_mode_t bus;
+	
+	simulate_instruction_proc_t *engine; // Optional, simulate_8086_instruction if not set
+	
+	guest_profile_t *profile;
+	trace_writer_t *trace;        // Where the -show text goes. Required if show is set
+	trace_writer_t *binary_trace; // Optional
+	frame_writer_t *frames;       // Optional
+	u64 checkpoint_interval;      // Instructions between checkpoints to CHECKPOINT_FILE_NAME, 0 for none
+};
+
+typedef u32 fault_t;
+enum {
+	Fault_None,
+	Fault_Unrecognized_Instruction,  // The bytes at CS:IP don't decode
+	Fault_Unimplemented_Instruction, // The engine can't execute the decoded instruction
+} fault_enum_t;
+
+// NOTE(ema): Everything that changes while a program is simulated. The code is loaded at
+// CS:0 (so code_offset must be a multiple of 16), and the simulation stops when CS:IP leaves it.
+typedef struct simulator_t simulator_t;
+struct simulator_t {
+	memory_t memory;
+	u32 code_offset;
+	u32 code_len;
+	
+	register_file_t registers;
+	u64 clock_count;
+	u64 instruction_count;
+	bool stopped;
+	bool faulted; // Stopped because of an instruction that couldn't be decoded or executed
+	
+	// NOTE(ema): Kept here rather than printed, so that runs on worker threads can report it.
+	fault_t fault;
+	pointer_variable_t fault_address; // CS:IP of the faulting instruction
+};
+
+static simulator_t make_simulator(memory_t memory, u32 code_offset, u32 code_len);
+static bool step_8086(simulator_t *sim, simulation_options_t options);
+static char *get_fault_name(fault_t fault);
+
+#endif
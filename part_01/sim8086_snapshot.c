@@ -0,0 +1,160 @@
+
+//////////////////////////////////////////
+// Snapshots
+
+static bool start_snapshot_history(snapshot_history_t *history, simulator_t *sim, u64 interval) {
+	bool ok = 0;
+	
+	history->interval = interval ? interval : 1;
+	history->base_image.len  = sim->memory.bytes.len;
+	history->base_image.data = malloc(history->base_image.len);
+	if (history->base_image.data) {
+		memcpy(history->base_image.data, sim->memory.bytes.data, history->base_image.len);
+		memset(history->dirty_pages, 0, sizeof(history->dirty_pages));
+		
+		// NOTE(ema): From now on every write to the simulated memory marks its page.
+		sim->memory.dirty_pages = history->dirty_pages;
+		
+		ok = take_snapshot(history, sim);
+	}
+	
+	return ok;
+}
+
+static void free_snapshot_history(snapshot_history_t *history, simulator_t *sim) {
+	if (sim->memory.dirty_pages == history->dirty_pages) {
+		sim->memory.dirty_pages = 0;
+	}
+	
+	free(history->base_image.data);
+	free(history->snapshots);
+	free(history->page_indices);
+	free(history->page_data);
+	
+	memset(history, 0, sizeof(*history));
+}
+
+static bool take_snapshot(snapshot_history_t *history, simulator_t *sim) {
+	bool ok = 1;
+	
+	u32 dirty_count = 0;
+	for (u32 page_index = 0; page_index < MEMORY_PAGE_COUNT; page_index += 1) {
+		dirty_count += history->dirty_pages[page_index];
+	}
+	
+	if (history->snapshot_count == history->snapshot_capacity) {
+		u32 new_capacity = history->snapshot_capacity ? 2 * history->snapshot_capacity : 64;
+		snapshot_t *snapshots = realloc(history->snapshots, sizeof(snapshot_t) * new_capacity);
+		if (snapshots) {
+			history->snapshots = snapshots;
+			history->snapshot_capacity = new_capacity;
+		} else {
+			ok = 0;
+		}
+	}
+	
+	if (ok && history->page_count + dirty_count > history->page_capacity) {
+		u32 new_capacity = history->page_capacity ? 2 * history->page_capacity : 64;
+		while (new_capacity < history->page_count + dirty_count) new_capacity *= 2;
+		
+		u16 *page_indices = realloc(history->page_indices, sizeof(u16) * new_capacity);
+		if (page_indices) history->page_indices = page_indices;
+		
+		u8 *page_data = realloc(history->page_data, (u64)MEMORY_PAGE_SIZE * new_capacity);
+		if (page_data) history->page_data = page_data;
+		
+		if (page_indices && page_data) {
+			history->page_capacity = new_capacity;
+		} else {
+			ok = 0;
+		}
+	}
+	
+	if (ok) {
+		snapshot_t *snapshot = &history->snapshots[history->snapshot_count++];
+		snapshot->registers         = sim->registers;
+		snapshot->clock_count       = sim->clock_count;
+		snapshot->instruction_count = sim->instruction_count;
+		snapshot->stopped           = sim->stopped;
+		snapshot->faulted           = sim->faulted;
+		snapshot->fault             = sim->fault;
+		snapshot->fault_address     = sim->fault_address;
+		snapshot->first_page        = history->page_count;
+		snapshot->page_count        = dirty_count;
+		
+		for (u32 page_index = 0; page_index < MEMORY_PAGE_COUNT; page_index += 1) {
+			if (history->dirty_pages[page_index]) {
+				u32 store_index = history->page_count++;
+				history->page_indices[store_index] = (u16)page_index;
+				memcpy(history->page_data + (u64)store_index * MEMORY_PAGE_SIZE,
+					   sim->memory.bytes.data + (u64)page_index * MEMORY_PAGE_SIZE, MEMORY_PAGE_SIZE);
+				
+				history->dirty_pages[page_index] = 0;
+			}
+		}
+	} else {
+		fprintf(stderr, "Out of memory for snapshots\n");
+	}
+	
+	return ok;
+}
+
+// Restores the simulator to the given snapshot, and forgets all snapshots taken after it.
+// Only the pages written after the snapshot are copied back.
+static void restore_snapshot(snapshot_history_t *history, simulator_t *sim, u32 snapshot_index) {
+	assert(snapshot_index < history->snapshot_count);
+	snapshot_t *snapshot = &history->snapshots[snapshot_index];
+	
+	u8 stale_pages[MEMORY_PAGE_COUNT];
+	memcpy(stale_pages, history->dirty_pages, sizeof(stale_pages));
+	
+	u32 end_page = snapshot->first_page + snapshot->page_count;
+	for (u32 store_index = end_page; store_index < history->page_count; store_index += 1) {
+		stale_pages[history->page_indices[store_index]] = 1;
+	}
+	
+	// NOTE(ema): Walk the saved pages from newest to oldest, so the first copy found for a page
+	// is the one the snapshot saw.
+	for (u32 store_index = end_page; store_index > 0; store_index -= 1) {
+		u16 page_index = history->page_indices[store_index - 1];
+		if (stale_pages[page_index]) {
+			memcpy(sim->memory.bytes.data + (u64)page_index * MEMORY_PAGE_SIZE,
+				   history->page_data + (u64)(store_index - 1) * MEMORY_PAGE_SIZE, MEMORY_PAGE_SIZE);
+			stale_pages[page_index] = 0;
+		}
+	}
+	
+	for (u32 page_index = 0; page_index < MEMORY_PAGE_COUNT; page_index += 1) {
+		u64 page_offset = (u64)page_index * MEMORY_PAGE_SIZE;
+		if (stale_pages[page_index] && page_offset < history->base_image.len) {
+			u64 size = history->base_image.len - page_offset;
+			if (size > MEMORY_PAGE_SIZE) size = MEMORY_PAGE_SIZE;
+			
+			memcpy(sim->memory.bytes.data + page_offset, history->base_image.data + page_offset, size);
+		}
+	}
+	
+	sim->registers         = snapshot->registers;
+	sim->clock_count       = snapshot->clock_count;
+	sim->instruction_count = snapshot->instruction_count;
+	sim->stopped           = snapshot->stopped;
+	sim->faulted           = snapshot->faulted;
+	sim->fault             = snapshot->fault;
+	sim->fault_address     = snapshot->fault_address;
+	
+	history->snapshot_count = snapshot_index + 1;
+	history->page_count     = end_page;
+	memset(history->dirty_pages, 0, sizeof(history->dirty_pages));
+}
+
+// Returns the index of the newest snapshot taken at or before the given instruction.
+static u32 find_snapshot_before(snapshot_history_t *history, u64 instruction_count) {
+	u32 result = 0;
+	for (u32 snapshot_index = history->snapshot_count; snapshot_index > 0; snapshot_index -= 1) {
+		if (history->snapshots[snapshot_index - 1].instruction_count <= instruction_count) {
+			result = snapshot_index - 1;
+			break;
+		}
+	}
+	return result;
+}
@@ -0,0 +1,53 @@
+#ifndef SIM8086_SNAPSHOT_H
+#define SIM8086_SNAPSHOT_H
+
+//////////////////////////////////////////
+// Snapshots
+
+#if !defined(SNAPSHOT_INTERVAL)
+#define SNAPSHOT_INTERVAL 4096
+#endif
+
+// NOTE(ema): A snapshot only saves the memory pages that were written since the previous
+// snapshot, so the memory at any snapshot is rebuilt from the newest copy of each page saved
+// up to that snapshot, or from the base image if the page was never saved.
+typedef struct snapshot_t snapshot_t;
+struct snapshot_t {
+	register_file_t registers;
+	u64 clock_count;
+	u64 instruction_count;
+	bool stopped;
+	bool faulted;
+	fault_t fault;
+	pointer_variable_t fault_address;
+	
+	u32 first_page; // Index of the first page saved by this snapshot in the history's page store
+	u32 page_count;
+};
+
+typedef struct snapshot_history_t snapshot_history_t;
+struct snapshot_history_t {
+	u64 interval;
+	
+	buffer_t base_image; // The whole memory when the history was started
+	u8 dirty_pages[MEMORY_PAGE_COUNT];
+	
+	snapshot_t *snapshots;
+	u32 snapshot_count;
+	u32 snapshot_capacity;
+	
+	// NOTE(ema): Pages saved by all snapshots, in the order they were saved.
+	u16 *page_indices;
+	u8  *page_data;
+	u32  page_count;
+	u32  page_capacity;
+};
+
+static bool start_snapshot_history(snapshot_history_t *history, simulator_t *sim, u64 interval);
+static void free_snapshot_history(snapshot_history_t *history, simulator_t *sim);
+
+static bool take_snapshot(snapshot_history_t *history, simulator_t *sim);
+static void restore_snapshot(snapshot_history_t *history, simulator_t *sim, u32 snapshot_index);
+static u32  find_snapshot_before(snapshot_history_t *history, u64 instruction_count);
+
+#endif
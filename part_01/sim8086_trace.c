@@ -0,0 +1,393 @@
+#include <fcntl.h>
+
+#if _WIN32
+# include <io.h>
+# define write_file_descriptor(fd, data, len) _write(fd, data, len)
+# define open_file_for_writing(name) _open(name, _O_WRONLY|_O_CREAT|_O_TRUNC|_O_BINARY, _S_IREAD|_S_IWRITE)
+# define close_file_descriptor(fd) _close(fd)
+#else
+# include <unistd.h>
+# define write_file_descriptor(fd, data, len) write(fd, data, len)
+# define open_file_for_writing(name) open(name, O_WRONLY|O_CREAT|O_TRUNC, 0644)
+# define close_file_descriptor(fd) close(fd)
+#endif
+
+//////////////////////////////////////////
+// Trace writer
+
+static trace_writer_t make_trace_writer(u8 *data, u32 cap, int fd) {
+	trace_writer_t writer = {
+		.data = data,
+		.cap  = cap,
+		.fd   = fd,
+	};
+	
+	return writer;
+}
+
+static bool open_trace_writer(trace_writer_t *writer, char *name) {
+	bool ok = 0;
+	
+	u8 *data = malloc(TRACE_BUFFER_SIZE);
+	int fd = open_file_for_writing(name);
+	if (data && fd >= 0) {
+		*writer = make_trace_writer(data, TRACE_BUFFER_SIZE, fd);
+		ok = 1;
+	} else {
+		fprintf(stderr, "Error opening file '%s'\n", name);
+		if (fd >= 0) close_file_descriptor(fd);
+		free(data);
+	}
+	
+	return ok;
+}
+
+static void close_trace_writer(trace_writer_t *writer) {
+	flush_trace(writer);
+	if (writer->fd >= 0) close_file_descriptor(writer->fd);
+	free(writer->data);
+	
+	memset(writer, 0, sizeof(*writer));
+	writer->fd = -1;
+}
+
+static void flush_trace(trace_writer_t *writer) {
+	if (writer->fd >= 0) {
+		u32 written = 0;
+		while (written < writer->len) {
+			int result = (int)write_file_descriptor(writer->fd, writer->data + written, writer->len - written);
+			if (result <= 0) {
+				fprintf(stderr, "Error writing trace\n");
+				break;
+			}
+			written += (u32)result;
+		}
+		
+		writer->len = 0;
+	}
+}
+
+static void trace_bytes(trace_writer_t *writer, void *data, u32 len) {
+	if (writer->len + len > writer->cap) {
+		flush_trace(writer);
+	}
+	
+	if (writer->len + len <= writer->cap) {
+		memcpy(writer->data + writer->len, data, len);
+		writer->len += len;
+	}
+}
+
+static void trace_char(trace_writer_t *writer, char c) {
+	if (writer->len == writer->cap) {
+		flush_trace(writer);
+	}
+	
+	if (writer->len < writer->cap) {
+		writer->data[writer->len++] = (u8)c;
+	}
+}
+
+static void trace_string(trace_writer_t *writer, char *string) {
+	trace_bytes(writer, string, (u32)strlen(string));
+}
+
+static void trace_hex(trace_writer_t *writer, u32 value) {
+	static char hex_digits[] = "0123456789abcdef";
+	
+	// NOTE(ema): Digits are produced backwards from the end of a small buffer.
+	char digits[8];
+	u32 first = sizeof(digits);
+	do {
+		digits[--first] = hex_digits[value & 0xF];
+		value >>= 4;
+	} while (value);
+	
+	trace_bytes(writer, digits + first, sizeof(digits) - first);
+}
+
+static void trace_decimal(trace_writer_t *writer, u64 value) {
+	char digits[20];
+	u32 first = sizeof(digits);
+	do {
+		digits[--first] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value);
+	
+	trace_bytes(writer, digits + first, sizeof(digits) - first);
+}
+
+static void trace_signed(trace_writer_t *writer, i32 value) {
+	if (value < 0) {
+		trace_char(writer, '-');
+		trace_decimal(writer, (u64)(-(i64)value));
+	} else {
+		trace_decimal(writer, (u64)value);
+	}
+}
+
+//////////////////////////////////////////
+// Trace steps
+
+static void format_8086_instruction(trace_writer_t *writer, instruction instr) {
+	trace_string(writer, (char *) Sim86_MnemonicFromOperationType(instr.Op));
+	trace_char(writer, ' ');
+	
+	char *separator = "";
+	for (int operand_index = 0; operand_index < array_count(instr.Operands); operand_index += 1) {
+		instruction_operand *operand = &instr.Operands[operand_index];
+		
+		if (operand->Type != Operand_None) {
+			trace_string(writer, separator);
+			separator = ", ";
+			
+			switch (operand->Type) {
+				case Operand_None: break;
+				
+				case Operand_Register: {
+					trace_string(writer, (char *) Sim86_RegisterNameFromOperand(&operand->Register));
+				} break;
+				
+				case Operand_Memory: {
+					effective_address_expression *address = &operand->Address;
+					
+					// NOTE(ema): The size is ambiguous only if the other operand is not a register.
+					if (instr.Operands[0].Type != Operand_Register && instr.Operands[1].Type != Operand_Register) {
+						trace_string(writer, (instr.Flags & Inst_Wide) ? "word " : "byte ");
+					}
+					
+					if (address->Flags & Address_ExplicitSegment) {
+						register_access segment = {address->ExplicitSegment, 0, 2};
+						trace_string(writer, (char *) Sim86_RegisterNameFromOperand(&segment));
+						trace_char(writer, ':');
+					}
+					
+					trace_char(writer, '[');
+					char *term_separator = "";
+					for (int term_index = 0; term_index < array_count(address->Terms); term_index += 1) {
+						effective_address_term *term = &address->Terms[term_index];
+						if (term->Register.Index != Register_None) {
+							trace_string(writer, term_separator);
+							trace_string(writer, (char *) Sim86_RegisterNameFromOperand(&term->Register));
+							term_separator = " + ";
+						}
+					}
+					
+					if (*term_separator == 0) {
+						trace_signed(writer, address->Displacement);
+					} else if (address->Displacement != 0) {
+						trace_string(writer, (address->Displacement < 0) ? " - " : " + ");
+						trace_signed(writer, (address->Displacement < 0) ? -address->Displacement : address->Displacement);
+					}
+					trace_char(writer, ']');
+				} break;
+				
+				case Operand_Immediate: {
+					immediate *imm = &operand->Immediate;
+					
+					if (imm->Flags & Immediate_RelativeJumpDisplacement) {
+						i32 offset = imm->Value + 2;
+						trace_string(writer, (offset < 0) ? "$-" : "$+");
+						trace_decimal(writer, (u64)((offset < 0) ? -(i64)offset : offset));
+					} else {
+						trace_signed(writer, imm->Value);
+					}
+				} break;
+			}
+		}
+	}
+}
+
+static void trace_cpu_flags(trace_writer_t *writer, cpu_flags_t flags) {
+	for (int i = 0; i < array_count(cpu_flag_chars); i += 1) {
+		cpu_flags_t flag = 1 << i;
+		if (flag & flags) {
+			trace_char(writer, cpu_flag_chars[i]);
+		}
+	}
+}
+
+static void trace_step_text(trace_writer_t *writer, trace_step_t *step) {
+	format_8086_instruction(writer, step->instr);
+	
+	if (step->executed) {
+		trace_string(writer, " ; ");
+		
+		if (step->show_clocks) {
+			instruction_clocks_t clocks = step->clocks;
+			
+			trace_string(writer, "Clocks: +");
+			trace_decimal(writer, clocks.total);
+			trace_string(writer, " = ");
+			trace_decimal(writer, step->clock_count);
+			if (clocks.ea || clocks.penalty) {
+				trace_string(writer, " (");
+				trace_decimal(writer, clocks.base);
+				if (clocks.ea) {
+					trace_string(writer, " + ");
+					trace_decimal(writer, clocks.ea);
+					trace_string(writer, "ea");
+				}
+				if (clocks.penalty) {
+					trace_string(writer, " + ");
+					trace_decimal(writer, clocks.penalty);
+					trace_string(writer, "p");
+				}
+				trace_char(writer, ')');
+			}
+			trace_string(writer, " | ");
+		}
+		
+		register_file_t *old_registers = &step->old_registers;
+		register_file_t *new_registers = &step->new_registers;
+		
+		for (int reg_index = 0; reg_index < Register_Count; reg_index += 1) {
+			if (reg_index != Register_flags && old_registers->as_words[reg_index] != new_registers->as_words[reg_index]) {
+				register_access reg = {reg_index, 0, 2};
+				trace_string(writer, (char *) Sim86_RegisterNameFromOperand(&reg));
+				trace_string(writer, ": 0x");
+				trace_hex(writer, old_registers->as_words[reg_index]);
+				trace_string(writer, "->0x");
+				trace_hex(writer, new_registers->as_words[reg_index]);
+				trace_string(writer, ", ");
+			}
+		}
+		
+		cpu_flags_t old_flags = old_registers->as_words[Register_flags];
+		cpu_flags_t new_flags = new_registers->as_words[Register_flags];
+		
+		if (old_flags != new_flags) {
+			trace_string(writer, "flags: ");
+			trace_cpu_flags(writer, old_flags);
+			trace_string(writer, "->");
+			trace_cpu_flags(writer, new_flags);
+		}
+	}
+	
+	if (!step->stopped) {
+		trace_char(writer, '\n');
+	}
+}
+
+//////////////////////////////////////////
+// Binary traces
+
+static void trace_write_header(trace_writer_t *writer, trace_flags_t flags) {
+	trace_header_t header = {TRACE_MAGIC, TRACE_VERSION, flags};
+	trace_bytes(writer, &header, sizeof(header));
+}
+
+static void trace_step_binary(trace_writer_t *writer, trace_step_t *step) {
+	u16 record[3 + 3 + Register_Count];
+	u32 count = 0;
+	
+	u16 changed = 0;
+	for (int reg_index = 1; reg_index < Register_Count; reg_index += 1) {
+		if (step->old_registers.as_words[reg_index] != step->new_registers.as_words[reg_index]) {
+			changed |= 1 << reg_index;
+		}
+	}
+	
+	record[count++] = step->old_registers.ip;
+	record[count++] = (u16)step->instr.Op;
+	record[count++] = changed;
+	
+	if (step->show_clocks) {
+		record[count++] = (u16)step->clocks.base;
+		record[count++] = (u16)step->clocks.ea;
+		record[count++] = (u16)step->clocks.penalty;
+	}
+	
+	for (int reg_index = 1; reg_index < Register_Count; reg_index += 1) {
+		if (changed & (1 << reg_index)) {
+			record[count++] = step->new_registers.as_words[reg_index];
+		}
+	}
+	
+	trace_bytes(writer, record, count * sizeof(u16));
+}
+
+static bool expand_binary_trace(simulator_t *sim, simulation_options_t *options, trace_writer_t *text, char *name) {
+	bool ok = 1;
+	
+	buffer_t trace = {0};
+	trace.len  = get_file_size(name);
+	trace.data = malloc(trace.len);
+	
+	trace_header_t header = {0};
+	if (trace.data && read_file_into_buffer(trace, name) == trace.len && trace.len >= sizeof(header)) {
+		memcpy(&header, trace.data, sizeof(header));
+	}
+	
+	if (header.magic != TRACE_MAGIC || header.version != TRACE_VERSION) {
+		fprintf(stderr, "'%s' is not a binary trace\n", name);
+		ok = 0;
+	}
+	
+	if (ok) {
+		options->exec   = (header.flags & Trace_Exec)   != 0;
+		options->clocks = (header.flags & Trace_Clocks) != 0;
+		
+		u16 *words     = (u16 *)(trace.data + sizeof(header));
+		u16 *words_end = words + (trace.len - sizeof(header)) / sizeof(u16);
+		
+		while (ok && words + 3 <= words_end) {
+			trace_step_t step = {0};
+			step.executed      = options->exec;
+			step.show_clocks   = options->clocks;
+			step.old_registers = sim->registers;
+			
+			u16 ip      = *words++;
+			u16 op      = *words++;
+			u16 changed = *words++;
+			
+			// NOTE(ema): The code is decoded again, so this only works if the program never
+			// overwrites its own instructions.
+			pointer_variable_t instruction_pointer = {sim->registers.cs, ip};
+			u32 code_index = (physical_address_from_pointer_variable(instruction_pointer) & sim->memory.mask) - sim->code_offset;
+			if (ip == sim->registers.ip && code_index < sim->code_len) {
+				Sim86_Decode8086Instruction(sim->code_len - code_index, sim->memory.bytes.data + sim->code_offset + code_index, &step.instr);
+			}
+			
+			if (step.instr.Op != op) {
+				fprintf(stderr, "Trace doesn't match the program at instruction %llu\n", sim->instruction_count);
+				ok = 0;
+			}
+			
+			u32 clock_words = step.show_clocks ? 3 : 0;
+			u32 value_words = count_ones_i8((i8)(changed & 0xFF)) + count_ones_i8((i8)(changed >> 8));
+			if (ok && words + clock_words + value_words > words_end) {
+				fprintf(stderr, "Trace '%s' is truncated\n", name);
+				ok = 0;
+			}
+			
+			if (ok) {
+				if (step.show_clocks) {
+					step.clocks.base    = *words++;
+					step.clocks.ea      = *words++;
+					step.clocks.penalty = *words++;
+					step.clocks.total   = step.clocks.base + step.clocks.ea + step.clocks.penalty;
+				}
+				
+				for (int reg_index = 1; reg_index < Register_Count; reg_index += 1) {
+					if (changed & (1 << reg_index)) {
+						sim->registers.as_words[reg_index] = *words++;
+					}
+				}
+				
+				sim->instruction_count += 1;
+				sim->clock_count       += step.clocks.total;
+				sim->stopped = step.executed && step.instr.Op == Op_hlt;
+				
+				step.clock_count   = sim->clock_count;
+				step.new_registers = sim->registers;
+				step.stopped       = sim->stopped;
+				
+				trace_step_text(text, &step);
+			}
+		}
+	}
+	
+	free(trace.data);
+	return ok;
+}
@@ -0,0 +1,89 @@
+#ifndef SIM8086_TRACE_H
+#define SIM8086_TRACE_H
+
+//////////////////////////////////////////
+// Trace writer
+
+// NOTE(ema): Text is formatted directly into a big buffer that is handed to the OS in one
+// write() when it fills up, so tracing doesn't go through stdio at all. Anything else written to
+// the same file with stdio must be flushed before the trace writes, and vice versa.
+// A writer with fd < 0 never flushes: it just stops writing when the buffer is full.
+typedef struct trace_writer_t trace_writer_t;
+struct trace_writer_t {
+	u8 *data;
+	u32 len;
+	u32 cap;
+	int fd;
+};
+
+#define TRACE_BUFFER_SIZE (1024 * 1024)
+
+static trace_writer_t make_trace_writer(u8 *data, u32 cap, int fd);
+static bool open_trace_writer(trace_writer_t *writer, char *name); // Allocates a buffer and creates the file
+static void close_trace_writer(trace_writer_t *writer);
+static void flush_trace(trace_writer_t *writer);
+
+static void trace_bytes(trace_writer_t *writer, void *data, u32 len);
+static void trace_char(trace_writer_t *writer, char c);
+static void trace_string(trace_writer_t *writer, char *string);
+static void trace_hex(trace_writer_t *writer, u32 value);     // Same as "%x"
+static void trace_decimal(trace_writer_t *writer, u64 value); // Same as "%llu"
+static void trace_signed(trace_writer_t *writer, i32 value);  // Same as "%i"
+
+//////////////////////////////////////////
+// Trace steps
+
+// NOTE(ema): Everything that the -show output says about one instruction.
+typedef struct trace_step_t trace_step_t;
+struct trace_step_t {
+	instruction instr;
+	
+	bool executed;
+	bool show_clocks;
+	instruction_clocks_t clocks;
+	u64 clock_count; // After the instruction
+	
+	register_file_t old_registers;
+	register_file_t new_registers;
+	bool stopped;
+};
+
+static void format_8086_instruction(trace_writer_t *writer, instruction instr);
+static void trace_step_text(trace_writer_t *writer, trace_step_t *step);
+
+//////////////////////////////////////////
+// Binary traces
+
+// NOTE(ema): A binary trace is a header followed by one record per instruction:
+//   u16 ip (before the instruction), u16 op, u16 mask of changed registers (bit = register index),
+//   3 x u16 clocks (base, ea, penalty; only if Trace_Clocks),
+//   u16 new value of every changed register, in index order.
+// The text is rebuilt offline by decoding the program again at each IP.
+
+#define TRACE_MAGIC   0x54363853 // "S86T"
+#define TRACE_VERSION 1
+
+typedef u16 trace_flags_t;
+enum {
+	Trace_Exec   = 1 << 0,
+	Trace_Clocks = 1 << 1,
+} trace_flags_enum_t;
+
+typedef struct trace_header_t trace_header_t;
+struct trace_header_t {
+	u32 magic;
+	u16 version;
+	trace_flags_t flags;
+};
+
+typedef struct simulator_t simulator_t;
+typedef struct simulation_options_t simulation_options_t;
+
+static void trace_write_header(trace_writer_t *writer, trace_flags_t flags);
+static void trace_step_binary(trace_writer_t *writer, trace_step_t *step);
+
+// Replays a binary trace of the program loaded in `sim`, writing the same text that -show would
+// have, and leaves `sim` and `options` as the original run left them.
+static bool expand_binary_trace(simulator_t *sim, simulation_options_t *options, trace_writer_t *text, char *name);
+
+#endif
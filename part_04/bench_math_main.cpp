@@ -0,0 +1,444 @@
+#include "shared.h"
+#include "math.h"
+#include "math_check.h"
+#include "../part_03/repetition_tester.h"
+
+#include "shared.cpp"
+#include "math.cpp"
+#include "math_check.cpp"
+#include "../part_03/repetition_tester.cpp"
+
+//
+// Times the approximations in math.h with the Repetition_Tester and measures their error with
+// the Math_Tester, then prints both in one table so we can tell which ones are worth it.
+//
+// Latency: every call takes the result of the one before (times 0) as part of its input, so the
+// calls can't overlap. That's what a single haversine pays.
+// Throughput: the calls are independent, so the CPU overlaps as many as it can. That's what a
+// loop over many inputs pays.
+//
+// Times are in CPU timer ticks (the TSC), which are not core cycles if the clock changes.
+//
+
+#define BENCH_INPUT_COUNT 4096 // 32k of inputs, fits in L1 with the outputs
+#define BENCH_ACCURACY_STEP_COUNT 1000000
+
+// NOTE(ema): The compiler doesn't know this is 0, so y*bench_zero keeps the dependency on y.
+static volatile f64 bench_zero = 0;
+
+///////////////////////////
+// Kernels
+
+// NOTE(ema): The kernels take the function as a template argument so it gets inlined like it
+// would be in real code, and they have the signature of a Math_Batch_Func, so the throughput ones
+// double as sweep candidates for the accuracy.
+
+template <f64 Func(f64, u32), u32 Arg> static f64 bind_arg(f64 x) {
+	f64 result = Func(x, Arg);
+	return result;
+}
+
+template <f32 Func(f32)> static f64 widen_f32(f64 x) {
+	f64 result = (f64)Func((f32)x);
+	return result;
+}
+
+// NOTE(ema): The f32 versions only ever see the input rounded to f32, so that's what the reference
+// gets too. Otherwise near 1 asin would blame them for the rounding of the input.
+template <f64 Ref(f64)> static f64 reference_at_f32(f64 x) {
+	f64 result = Ref((f64)(f32)x);
+	return result;
+}
+
+template <u32 Count> static f64 sin_mftwp(f64 x) {
+	f64 result = odd_coefficients_table<Count>(x, SineRadiansC_MFTWP[Count]);
+	return result;
+}
+
+template <u32 Count> static f64 asin_mftwp(f64 x) {
+	f64 result = odd_coefficients_table<Count>(x, ArcsineRadiansC_MFTWP[Count]);
+	return result;
+}
+
+template <u32 Count> static f64 sin_remez(f64 x) {
+	f64 result = odd_coefficients_table<Count>(x, SineRadiansC_Remez[Count]);
+	return result;
+}
+
+template <u32 Count> static f64 asin_remez(f64 x) {
+	f64 result = odd_coefficients_table<Count>(x, ArcsineRadiansC_Remez[Count]);
+	return result;
+}
+
+static f64 identity_f64(f64 x) {
+	return x;
+}
+
+template <f64 Func(f64)> static void latency_kernel(f64 *inputs, f64 *outputs, u32 count, void *param) {
+	(void) param;
+	
+	f64 zero = bench_zero;
+	f64 y = 0;
+	for (u32 index = 0; index < count; index += 1) {
+		f64 x = inputs[index] + y*zero;
+		y = Func(x);
+	}
+	outputs[0] = y;
+}
+
+template <f64 Func(f64)> static void throughput_kernel(f64 *inputs, f64 *outputs, u32 count, void *param) {
+	(void) param;
+	
+	for (u32 index = 0; index < count; index += 1) {
+		outputs[index] = Func(inputs[index]);
+	}
+}
+
+#if MATH_AVX2
+static __m256d identity_x4(__m256d x) {
+	return x;
+}
+
+template <__m256d Func(__m256d)> static void latency_kernel_x4(f64 *inputs, f64 *outputs, u32 count, void *param) {
+	(void) param;
+	
+	__m256d zero = _mm256_set1_pd(bench_zero);
+	__m256d y = _mm256_setzero_pd();
+	for (u32 index = 0; index + 4 <= count; index += 4) {
+		__m256d x = _mm256_add_pd(_mm256_loadu_pd(inputs + index), _mm256_mul_pd(y, zero));
+		y = Func(x);
+	}
+	_mm256_storeu_pd(outputs, y);
+}
+
+template <__m256d Func(__m256d)> static void throughput_kernel_x4(f64 *inputs, f64 *outputs, u32 count, void *param) {
+	(void) param;
+	
+	u32 index = 0;
+	for (; index + 4 <= count; index += 4) {
+		_mm256_storeu_pd(outputs + index, Func(_mm256_loadu_pd(inputs + index)));
+	}
+	
+	if (index < count) {
+		f64 lanes[4] = {};
+		memcpy(lanes, inputs + index, (count - index)*sizeof(f64));
+		_mm256_storeu_pd(lanes, Func(_mm256_loadu_pd(lanes)));
+		memcpy(outputs + index, lanes, (count - index)*sizeof(f64));
+	}
+}
+#endif
+
+#if MATH_AVX512
+static __m512d identity_x8(__m512d x) {
+	return x;
+}
+
+template <__m512d Func(__m512d)> static void latency_kernel_x8(f64 *inputs, f64 *outputs, u32 count, void *param) {
+	(void) param;
+	
+	__m512d zero = _mm512_set1_pd(bench_zero);
+	__m512d y = _mm512_setzero_pd();
+	for (u32 index = 0; index + 8 <= count; index += 8) {
+		__m512d x = _mm512_add_pd(_mm512_loadu_pd(inputs + index), _mm512_mul_pd(y, zero));
+		y = Func(x);
+	}
+	_mm512_storeu_pd(outputs, y);
+}
+
+template <__m512d Func(__m512d)> static void throughput_kernel_x8(f64 *inputs, f64 *outputs, u32 count, void *param) {
+	(void) param;
+	
+	u32 index = 0;
+	for (; index + 8 <= count; index += 8) {
+		_mm512_storeu_pd(outputs + index, Func(_mm512_loadu_pd(inputs + index)));
+	}
+	
+	if (index < count) {
+		f64 lanes[8] = {};
+		memcpy(lanes, inputs + index, (count - index)*sizeof(f64));
+		_mm512_storeu_pd(lanes, Func(_mm512_loadu_pd(lanes)));
+		memcpy(outputs + index, lanes, (count - index)*sizeof(f64));
+	}
+}
+#endif
+
+///////////////////////////
+// Benchmarks
+
+struct Math_Bench {
+	char const *name;
+	Math_Func *reference;
+	f64 min_input, max_input;
+	u32 lane_count; // 4 and 8 need cpu_has_avx2() and cpu_has_avx512()
+	
+	Float_Precision precision;
+	Math_Func *sweep_reference; // If it's not the reference itself
+	
+	Math_Batch_Func *latency_kernel;
+	Math_Batch_Func *throughput_kernel;
+	
+	// NOTE(ema): Results
+	b32 skipped;
+	f64 max_diff;
+	f64 max_ulp_diff;
+	f64 latency;    // Ticks per call
+	f64 throughput; // Ticks per value
+	b32 pareto;
+};
+
+template <f64 Func(f64)> static Math_Bench make_bench(char const *name, Math_Func *reference, f64 min_input, f64 max_input) {
+	Math_Bench result = {name, reference, min_input, max_input, 1, Precision_F64, 0, latency_kernel<Func>, throughput_kernel<Func>};
+	return result;
+}
+
+template <f32 Func(f32), f64 Ref(f64)> static Math_Bench make_bench_f32(char const *name, f64 min_input, f64 max_input) {
+	Math_Bench result = {name, Ref, min_input, max_input, 1, Precision_F32, reference_at_f32<Ref>,
+		latency_kernel<widen_f32<Func>>, throughput_kernel<widen_f32<Func>>};
+	return result;
+}
+
+#if MATH_AVX2
+template <__m256d Func(__m256d)> static Math_Bench make_bench_x4(char const *name, Math_Func *reference, f64 min_input, f64 max_input) {
+	Math_Bench result = {name, reference, min_input, max_input, 4, Precision_F64, 0, latency_kernel_x4<Func>, throughput_kernel_x4<Func>};
+	return result;
+}
+#endif
+
+#if MATH_AVX512
+template <__m512d Func(__m512d)> static Math_Bench make_bench_x8(char const *name, Math_Func *reference, f64 min_input, f64 max_input) {
+	Math_Bench result = {name, reference, min_input, max_input, 8, Precision_F64, 0, latency_kernel_x8<Func>, throughput_kernel_x8<Func>};
+	return result;
+}
+#endif
+
+static Math_Bench benches[] = {
+	make_bench<sqrt>("sqrt (CRT)", sqrt, 0, 1),
+	make_bench<sqrt_sse>("sqrt_sse", sqrt, 0, 1),
+	make_bench<sqrt_hv>("sqrt_hv", sqrt, 0, 1),
+	make_bench_f32<sqrt_hv_f32, sqrt>("sqrt_hv_f32", 0, 1),
+	
+	make_bench<sin>("sin (CRT)", sin, -PI64, PI64),
+	make_bench<sin_q>("sin_q", sin, -PI64, PI64),
+	make_bench<sin_q_half>("sin_q_half", sin, -PI64, PI64),
+	make_bench<sin_q_quarter>("sin_q_quarter", sin, -PI64, PI64),
+	make_bench<bind_arg<sin_taylor_fast, 11>>("sin_taylor_fast(11)", sin, -PI64, PI64),
+	make_bench<bind_arg<sin_taylor_slow, 11>>("sin_taylor_slow(11)", sin, -PI64, PI64),
+	make_bench<bind_arg<sin_taylor_casey, 11>>("sin_taylor_casey(11)", sin, -PI64, PI64),
+	make_bench<bind_arg<sin_taylor_horner, 11>>("sin_taylor_horner(11)", sin, -PI64, PI64),
+	make_bench<bind_arg<sin_taylor_horner_fmadd, 11>>("sin_taylor_horner_fmadd(11)", sin, -PI64, PI64),
+	make_bench<bind_arg<sin_taylor_horner_fma, 11>>("sin_taylor_horner_fma(11)", sin, -PI64, PI64),
+	make_bench<bind_arg<sin_taylor_horner, 21>>("sin_taylor_horner(21)", sin, -PI64, PI64),
+	make_bench<bind_arg<sin_taylor_horner_fmadd, 21>>("sin_taylor_horner_fmadd(21)", sin, -PI64, PI64),
+	make_bench<bind_arg<sin_taylor_horner_fma, 21>>("sin_taylor_horner_fma(21)", sin, -PI64, PI64),
+	make_bench<sin_hv>("sin_hv", sin, -PI64, PI64),
+	make_bench_f32<sin_hv_f32, sin>("sin_hv_f32", -PI64, PI64),
+	
+	make_bench<sin_mftwp<5>>("sin mftwp(5)", sin, 0, PI64/2),
+	make_bench<sin_mftwp<7>>("sin mftwp(7)", sin, 0, PI64/2),
+	make_bench<sin_remez<7>>("sin remez(7)", sin, 0, PI64/2),
+	make_bench<sin_ce>("sin_ce", sin, 0, PI64/2),
+	make_bench<sin_mftwp<9>>("sin mftwp(9)", sin, 0, PI64/2),
+	make_bench<sin_remez<9>>("sin remez(9)", sin, 0, PI64/2),
+	
+	make_bench<cos>("cos (CRT)", cos, -PI64/2, PI64/2),
+	make_bench<cos_q_quarter>("cos_q_quarter", cos, -PI64/2, PI64/2),
+	make_bench<cos_hv>("cos_hv", cos, -PI64/2, PI64/2),
+	make_bench_f32<cos_hv_f32, cos>("cos_hv_f32", -PI64/2, PI64/2),
+	
+	make_bench<asin_mftwp<7>>("asin mftwp(7)", asin, 0, ONE_OVER_SQRT2),
+	make_bench<asin_mftwp<11>>("asin mftwp(11)", asin, 0, ONE_OVER_SQRT2),
+	make_bench<asin_ce>("asin_ce", asin, 0, ONE_OVER_SQRT2),
+	make_bench<asin_remez<11>>("asin remez(11)", asin, 0, ONE_OVER_SQRT2),
+	make_bench<asin_mftwp<15>>("asin mftwp(15)", asin, 0, ONE_OVER_SQRT2),
+	make_bench<asin_remez<15>>("asin remez(15)", asin, 0, ONE_OVER_SQRT2),
+	
+	make_bench<asin>("asin (CRT)", asin, 0, 1),
+	make_bench<asin_ce_ext_i>("asin_ce_ext_i", asin, 0, 1),
+	make_bench<asin_ce_ext_r>("asin_ce_ext_r", asin, 0, 1),
+	make_bench<asin_hv>("asin_hv", asin, 0, 1),
+	make_bench_f32<asin_hv_f32, asin>("asin_hv_f32", 0, 1),
+
+#if MATH_AVX2
+	make_bench_x4<sqrt_hv_x4>("sqrt_hv_x4", sqrt, 0, 1),
+	make_bench_x4<sin_hv_x4>("sin_hv_x4", sin, -PI64, PI64),
+	make_bench_x4<cos_hv_x4>("cos_hv_x4", cos, -PI64/2, PI64/2),
+	make_bench_x4<asin_hv_x4>("asin_hv_x4", asin, 0, 1),
+#endif
+
+#if MATH_AVX512
+	make_bench_x8<sqrt_hv_x8>("sqrt_hv_x8", sqrt, 0, 1),
+	make_bench_x8<sin_hv_x8>("sin_hv_x8", sin, -PI64, PI64),
+	make_bench_x8<cos_hv_x8>("cos_hv_x8", cos, -PI64/2, PI64/2),
+	make_bench_x8<asin_hv_x8>("asin_hv_x8", asin, 0, 1),
+#endif
+};
+
+static b32 cpu_has_lanes(u32 lane_count) {
+	b32 result = true;
+	if (lane_count == 4) result = cpu_has_avx2();
+	if (lane_count == 8) result = cpu_has_avx512();
+	return result;
+}
+
+static void fill_inputs(f64 *inputs, u32 count, f64 min_input, f64 max_input) {
+	// NOTE(ema): Random rather than evenly spaced, so the branches of the scalar versions are as
+	// unpredictable as with real data. Always the same seed, so the runs are comparable.
+	u64 state = 0x9e3779b97f4a7c15ULL;
+	for (u32 index = 0; index < count; index += 1) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		
+		f64 t = (f64)(state >> 11) * 0x1p-53;
+		inputs[index] = min_input + t*(max_input - min_input);
+	}
+}
+
+static f64 time_kernel(Math_Batch_Func *kernel, f64 *inputs, f64 *outputs, u32 count, u64 cpu_freq, u32 seconds_to_try) {
+	Repetition_Tester tester = {};
+	start_test_wave(&tester, count*sizeof(f64), cpu_freq, seconds_to_try);
+	while (is_testing(&tester)) {
+		begin_timed_block(&tester);
+		kernel(inputs, outputs, count, 0);
+		end_timed_block(&tester);
+		
+		accumulate_byte_count(&tester, count*sizeof(f64));
+	}
+	
+	f64 result = (f64)tester.min_time;
+	return result;
+}
+
+static b32 same_group(Math_Bench *a, Math_Bench *b) {
+	b32 result = (a->reference == b->reference && a->min_input == b->min_input && a->max_input == b->max_input);
+	return result;
+}
+
+static void mark_pareto() {
+	// NOTE(ema): A benchmark is on the front if no other one of the same function and range is at
+	// least as fast and as accurate, and strictly better at one of the two.
+	for (u32 bench_index = 0; bench_index < array_count(benches); bench_index += 1) {
+		Math_Bench *bench = &benches[bench_index];
+		bench->pareto = !bench->skipped;
+		
+		for (u32 other_index = 0; other_index < array_count(benches) && bench->pareto; other_index += 1) {
+			Math_Bench *other = &benches[other_index];
+			if (other != bench && !other->skipped && same_group(bench, other) &&
+				other->max_diff <= bench->max_diff && other->throughput <= bench->throughput &&
+				(other->max_diff < bench->max_diff || other->throughput < bench->throughput)) {
+				bench->pareto = false;
+			}
+		}
+	}
+}
+
+static void print_table(f64 *chain_overheads) {
+	printf("\nThe latencies include the ticks per call for chaining the inputs: %.2f (f64), %.2f (x4), %.2f (x8).\n",
+		   chain_overheads[1], chain_overheads[4], chain_overheads[8]);
+	printf("* = nothing of the same function and range is both faster and more accurate.\n");
+	printf("The ulps are the ones of the type the function returns, and get huge where the result gets\n");
+	printf("close to 0 if the error doesn't.\n");
+	
+	for (u32 bench_index = 0; bench_index < array_count(benches); bench_index += 1) {
+		Math_Bench *bench = &benches[bench_index];
+		
+		// NOTE(ema): The table lists one group at a time, fastest first.
+		b32 first_of_group = true;
+		for (u32 other_index = 0; other_index < bench_index; other_index += 1) {
+			if (same_group(&benches[other_index], bench)) first_of_group = false;
+		}
+		if (!first_of_group) continue;
+		
+		printf("\n%-30s %12s %10s %14s %14s\n", "", "max error", "ulp", "latency/call", "ticks/value");
+		
+		u32 group[array_count(benches)];
+		u32 group_count = 0;
+		for (u32 other_index = bench_index; other_index < array_count(benches); other_index += 1) {
+			if (same_group(&benches[other_index], bench) && !benches[other_index].skipped) {
+				// NOTE(ema): Insertion sort by throughput, there's only a handful.
+				u32 insert_index = group_count;
+				while (insert_index > 0 && benches[group[insert_index - 1]].throughput > benches[other_index].throughput) {
+					group[insert_index] = group[insert_index - 1];
+					insert_index -= 1;
+				}
+				group[insert_index] = other_index;
+				group_count += 1;
+			}
+		}
+		
+		for (u32 group_index = 0; group_index < group_count; group_index += 1) {
+			Math_Bench *row = &benches[group[group_index]];
+			printf("%c %-28s %12.3e %10.3g %14.2f %14.2f\n", row->pareto ? '*' : ' ', row->name,
+				   row->max_diff, row->max_ulp_diff, row->latency, row->throughput);
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	u32 seconds_to_try = (argc > 1) ? (u32)atoi(argv[1]) : 2;
+	if (seconds_to_try == 0) seconds_to_try = 1;
+	
+	u64 cpu_freq = estimate_cpu_timer_frequency();
+	
+	static f64 inputs[BENCH_INPUT_COUNT];
+	static f64 outputs[BENCH_INPUT_COUNT];
+	
+	// NOTE(ema): Accuracy, with a sweep per benchmark
+	Math_Tester tester = {};
+	for (u32 bench_index = 0; bench_index < array_count(benches); bench_index += 1) {
+		Math_Bench *bench = &benches[bench_index];
+		bench->skipped = !cpu_has_lanes(bench->lane_count);
+		
+		if (!bench->skipped) {
+			Math_Func *reference = bench->sweep_reference ? bench->sweep_reference : bench->reference;
+			Math_Sweep sweep = make_sweep(reference, bench->min_input, bench->max_input, BENCH_ACCURACY_STEP_COUNT);
+			add_candidate(&sweep, bench->throughput_kernel, 0, "%s", bench->name);
+			sweep.candidates[sweep.candidate_count - 1].precision = bench->precision;
+			run_sweep(&tester, &sweep);
+			
+			Math_Test *test = &tester.tests[tester.completed_test_count - 1];
+			bench->max_diff = test->max_diff;
+			bench->max_ulp_diff = test->max_ulp_diff;
+		}
+	}
+	
+	// NOTE(ema): Speed
+	f64 chain_overheads[9] = {}; // By lane count
+	fill_inputs(inputs, BENCH_INPUT_COUNT, 0, 1);
+	
+	printf("\n--- Now testing: chain overhead ---\n");
+	chain_overheads[1] = time_kernel(latency_kernel<identity_f64>, inputs, outputs, BENCH_INPUT_COUNT, cpu_freq, seconds_to_try) / BENCH_INPUT_COUNT;
+
+#if MATH_AVX2
+	if (cpu_has_avx2()) {
+		printf("\n--- Now testing: chain overhead x4 ---\n");
+		chain_overheads[4] = time_kernel(latency_kernel_x4<identity_x4>, inputs, outputs, BENCH_INPUT_COUNT, cpu_freq, seconds_to_try) / (BENCH_INPUT_COUNT/4);
+	}
+#endif
+
+#if MATH_AVX512
+	if (cpu_has_avx512()) {
+		printf("\n--- Now testing: chain overhead x8 ---\n");
+		chain_overheads[8] = time_kernel(latency_kernel_x8<identity_x8>, inputs, outputs, BENCH_INPUT_COUNT, cpu_freq, seconds_to_try) / (BENCH_INPUT_COUNT/8);
+	}
+#endif
+
+	for (u32 bench_index = 0; bench_index < array_count(benches); bench_index += 1) {
+		Math_Bench *bench = &benches[bench_index];
+		if (!bench->skipped) {
+			fill_inputs(inputs, BENCH_INPUT_COUNT, bench->min_input, bench->max_input);
+			u32 call_count = BENCH_INPUT_COUNT / bench->lane_count;
+			
+			printf("\n--- Now testing: %s latency ---\n", bench->name);
+			bench->latency = time_kernel(bench->latency_kernel, inputs, outputs, BENCH_INPUT_COUNT, cpu_freq, seconds_to_try) / call_count;
+			
+			printf("\n--- Now testing: %s throughput ---\n", bench->name);
+			bench->throughput = time_kernel(bench->throughput_kernel, inputs, outputs, BENCH_INPUT_COUNT, cpu_freq, seconds_to_try) / BENCH_INPUT_COUNT;
+		}
+	}
+	
+	mark_pareto();
+	print_table(chain_overheads);
+	
+	return 0;
+}
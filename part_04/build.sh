@@ -0,0 +1,4 @@
+#!/usr/bin/bash
+# Same as build.bat, for Linux: ./build.sh check_precision_main.cpp -o check_precision
+# -march=native turns on the AVX2/AVX-512 versions where the machine has them.
+${CXX:-g++} "$@" -g -O2 -march=native -pthread -Wall -Wextra -Wno-unused-function -Wno-unused-variable -Wno-missing-field-initializers -Wno-write-strings
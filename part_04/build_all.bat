@@ -1,5 +1,8 @@
 @echo off
 
 del *.pdb > NUL 2> NUL
-call build check_ranges_main.cpp    /Fecheck_ranges.exe
-call build check_precision_main.cpp /Fecheck_precision.exe
+call build check_ranges_main.cpp     /Fecheck_ranges.exe
+call build check_precision_main.cpp  /Fecheck_precision.exe
+call build fit_coefficients_main.cpp /Fefit_coefficients.exe
+call build bench_math_main.cpp       /Febench_math.exe /O2
+call build haversine_f32_main.cpp    /Fehaversine_f32.exe /O2
@@ -0,0 +1,8 @@
+#!/usr/bin/bash
+cd "$(dirname "$0")"
+
+./build.sh check_ranges_main.cpp     -o check_ranges
+./build.sh check_precision_main.cpp  -o check_precision
+./build.sh fit_coefficients_main.cpp -o fit_coefficients
+./build.sh bench_math_main.cpp       -o bench_math
+./build.sh haversine_f32_main.cpp    -o haversine_f32
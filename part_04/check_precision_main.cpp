@@ -55,7 +55,164 @@ static void test_against_reference_implem(char *ref_name, Math_Func *ref_func, c
 }
 #endif
 
-int main() {
+///////////////////////////
+// Wide versions
+
+// NOTE(ema): Every lane is checked as a test of its own. Lane 0 gets the input of the tester and
+// the other lanes get inputs spread over the rest of the range, so the lanes of one call usually
+// take different sides of the selects. The input of the tester is swapped with the one of the lane
+// while comparing, so the input at the max error is reported correctly.
+
+static f64 get_lane_input(Math_Tester *tester, f64 min_input, f64 max_input, u32 lane, u32 lane_count) {
+	f64 x = tester->input_value + (max_input - min_input)*(f64)lane/(f64)lane_count;
+	if (x > max_input) x -= (max_input - min_input);
+	return x;
+}
+
+static void compare_lanes(Math_Tester *tester, Math_Func *reference, f64 *inputs, f64 *outputs, u32 lane_count, char const *name) {
+	f64 input_value = tester->input_value;
+	for (u32 lane = 0; lane < lane_count; lane += 1) {
+		tester->input_value = inputs[lane];
+		compare_outputs(tester, reference(inputs[lane]), outputs[lane], "%s[%u]", name, lane);
+	}
+	tester->input_value = input_value;
+}
+
+#if MATH_AVX2
+typedef __m256d Math_Func_X4(__m256d);
+
+static void compare_outputs_x4(Math_Tester *tester, f64 min_input, f64 max_input, Math_Func *reference, Math_Func_X4 *func, char const *name) {
+	f64 inputs[4], outputs[4];
+	for (u32 lane = 0; lane < array_count(inputs); lane += 1) {
+		inputs[lane] = get_lane_input(tester, min_input, max_input, lane, array_count(inputs));
+	}
+	
+	_mm256_storeu_pd(outputs, func(_mm256_loadu_pd(inputs)));
+	compare_lanes(tester, reference, inputs, outputs, array_count(inputs), name);
+}
+#endif
+
+#if MATH_AVX512
+typedef __m512d Math_Func_X8(__m512d);
+
+static void compare_outputs_x8(Math_Tester *tester, f64 min_input, f64 max_input, Math_Func *reference, Math_Func_X8 *func, char const *name) {
+	f64 inputs[8], outputs[8];
+	for (u32 lane = 0; lane < array_count(inputs); lane += 1) {
+		inputs[lane] = get_lane_input(tester, min_input, max_input, lane, array_count(inputs));
+	}
+	
+	_mm512_storeu_pd(outputs, func(_mm512_loadu_pd(inputs)));
+	compare_lanes(tester, reference, inputs, outputs, array_count(inputs), name);
+}
+#endif
+
+///////////////////////////
+// Haversine
+
+// NOTE(ema): Compares haversine_hv() against reference_haversine() on every pair of a file made by
+// haversine_gen (data_N_haveranswer.f64: x0, y0, x1, y1 for every pair, then the average distance).
+static void check_haversine(char *file_name) {
+	Buffer file = read_entire_file(file_name);
+	if (file.len >= sizeof(f64)) {
+		f64 *values = (f64 *) file.data;
+		u64 pair_count = (file.len - sizeof(f64)) / (4*sizeof(f64));
+		f64 answer = values[4*pair_count];
+		
+		f64 max_diff = 0;
+		f64 total_diff = 0;
+		u64 pair_index_at_max_diff = 0;
+		f64 reference_sum = 0;
+		f64 sum = 0;
+		for (u64 pair_index = 0; pair_index < pair_count; pair_index += 1) {
+			f64 *pair = values + 4*pair_index;
+			f64 expected = reference_haversine(pair[0], pair[1], pair[2], pair[3], EARTH_RADIUS);
+			f64 output   = haversine_hv(pair[0], pair[1], pair[2], pair[3], EARTH_RADIUS);
+			
+			f64 diff = fabs(expected - output);
+			total_diff += diff;
+			if (max_diff < diff) {
+				max_diff = diff;
+				pair_index_at_max_diff = pair_index;
+			}
+			
+			reference_sum += expected;
+			sum += output;
+		}
+		
+		printf("\nhaversine_hv over %llu pairs of %s:\n", (unsigned long long)pair_count, file_name);
+		if (pair_count > 0) {
+			f64 *pair = values + 4*pair_index_at_max_diff;
+			printf("Max error: %+.24f (pair %llu: %f, %f, %f, %f)\n", max_diff, (unsigned long long)pair_index_at_max_diff,
+				   pair[0], pair[1], pair[2], pair[3]);
+			printf("Avg error: %+.24f\n", total_diff / (f64)pair_count);
+			printf("Average: %.16f (reference %.16f, file %.16f)\n", sum / (f64)pair_count, reference_sum / (f64)pair_count, answer);
+		}
+	} else if (is_valid(file)) {
+		fprintf(stderr, "Error: %s is too small to be a haversine input.\n", file_name);
+	}
+	
+	if (file.data) {
+		free_buffer(&file);
+	}
+}
+
+///////////////////////////
+// Exhaustive f32
+
+// NOTE(ema): These are the guarantees of the f32 versions, and every f32 in the ranges is checked
+// against them, so they hold as written. The ulps are the ones of the f64 result rounded to f32.
+// They take a while on a single core, so they only run with -f32.
+static b32 check_f32_functions(Math_Tester *tester) {
+	b32 ok = true;
+	
+	{
+		Math_Sweep sweep = make_float32_sweep(sin, -PI32, PI32);
+		add_candidate(&sweep, sin_hv_f32, "sin_hv_f32 (every f32)");
+		run_sweep(tester, &sweep);
+		ok &= check_last_test(tester, 2e-7, 2.5);
+	}
+	
+	{
+		Math_Sweep sweep = make_float32_sweep(cos, -PI32/2, PI32/2);
+		add_candidate(&sweep, cos_hv_f32, "cos_hv_f32 (every f32)");
+		run_sweep(tester, &sweep);
+		ok &= check_last_test(tester, 2e-7, 2.5);
+	}
+	
+	{
+		Math_Sweep sweep = make_float32_sweep(asin, 0, 1);
+		add_candidate(&sweep, asin_hv_f32, "asin_hv_f32 (every f32)");
+		run_sweep(tester, &sweep);
+		ok &= check_last_test(tester, 4e-7, 2.6);
+	}
+	
+	{
+		Math_Sweep sweep = make_float32_sweep(sqrt, 0, 1);
+		add_candidate(&sweep, sqrt_hv_f32, "sqrt_hv_f32 (every f32)");
+		run_sweep(tester, &sweep);
+		ok &= check_last_test(tester, 3e-8, 0.5);
+	}
+	
+	for (u32 test_index = tester->completed_test_count - 4; test_index < tester->completed_test_count; test_index += 1) {
+		print_ulp_histogram(&tester->tests[test_index]);
+	}
+	
+	return ok;
+}
+
+int main(int argc, char **argv) {
+	b32 do_f32 = false;
+	char *haversine_file_name = 0;
+	for (int arg_index = 1; arg_index < argc; arg_index += 1) {
+		if (strcmp(argv[arg_index], "-f32") == 0) {
+			do_f32 = true;
+		} else {
+			haversine_file_name = argv[arg_index];
+		}
+	}
+	
+	b32 ok = true;
+	
 	{
 #if 0
 		test_against_hardcoded_values("sqrt", sqrt, array_count(sqrt_ref_answers), sqrt_ref_answers);
@@ -84,34 +241,44 @@ int main() {
 		compare_outputs(&tester, cos(tester.input_value), cos_q_quarter(tester.input_value), "cos_q_quarter");
 	}
 	
-	while (try_start_precision_test(&tester, -PI64, PI64)) {
+	{
+		Math_Sweep sweep = make_sweep(sin, -PI64, PI64, 1000000);
 		for (u32 exp = 3; exp < 31; exp += 2) {
-			compare_outputs(&tester, sin(tester.input_value), sin_taylor_fast(tester.input_value, exp), "sin_taylor_fast(%u)", exp);
+			add_candidate(&sweep, sin_taylor_fast, exp, "sin_taylor_fast(%u)", exp);
 		}
+		run_sweep(&tester, &sweep);
 	}
 	
-	while (try_start_precision_test(&tester, -PI64, PI64)) {
+	{
+		Math_Sweep sweep = make_sweep(sin, -PI64, PI64, 1000000);
 		for (u32 exp = 3; exp < 31; exp += 2) {
-			compare_outputs(&tester, sin(tester.input_value), sin_taylor_slow(tester.input_value, exp), "sin_taylor_slow(%u)", exp);
+			add_candidate(&sweep, sin_taylor_slow, exp, "sin_taylor_slow(%u)", exp);
 		}
+		run_sweep(&tester, &sweep);
 	}
 	
-	while (try_start_precision_test(&tester, -PI64, PI64)) {
+	{
+		Math_Sweep sweep = make_sweep(sin, -PI64, PI64, 1000000);
 		for (u32 exp = 3; exp < 31; exp += 2) {
-			compare_outputs(&tester, sin(tester.input_value), sin_taylor_casey(tester.input_value, exp), "sin_taylor_casey(%u)", exp);
+			add_candidate(&sweep, sin_taylor_casey, exp, "sin_taylor_casey(%u)", exp);
 		}
+		run_sweep(&tester, &sweep);
 	}
 	
-	while (try_start_precision_test(&tester, -PI64, PI64)) {
+	{
+		Math_Sweep sweep = make_sweep(sin, -PI64, PI64, 1000000);
 		for (u32 exp = 3; exp < 31; exp += 2) {
-			compare_outputs(&tester, sin(tester.input_value), sin_taylor_horner(tester.input_value, exp), "sin_taylor_horner(%u)", exp);
+			add_candidate(&sweep, sin_taylor_horner, exp, "sin_taylor_horner(%u)", exp);
 		}
+		run_sweep(&tester, &sweep);
 	}
 	
-	while (try_start_precision_test(&tester, -PI64, PI64)) {
+	{
+		Math_Sweep sweep = make_sweep(sin, -PI64, PI64, 1000000);
 		for (u32 exp = 3; exp < 31; exp += 2) {
-			compare_outputs(&tester, sin(tester.input_value), sin_taylor_horner_fmadd(tester.input_value, exp), "sin_taylor_horner_fmadd(%u)", exp);
+			add_candidate(&sweep, sin_taylor_horner_fmadd, exp, "sin_taylor_horner_fmadd(%u)", exp);
 		}
+		run_sweep(&tester, &sweep);
 	}
 #endif
 	
@@ -121,11 +288,11 @@ int main() {
 			f64 expected = sin(tester.input_value);
 			
 			if (count < array_count(SineRadiansC_Taylor)) {
-				compare_outputs(&tester, expected, sin_coefficients_table(tester.input_value, SineRadiansC_Taylor, count), "taylor(%u)", count);
+				compare_outputs(&tester, expected, odd_coefficients_table(tester.input_value, SineRadiansC_Taylor, count), "taylor(%u)", count);
 			}
 			
 			if (count < array_count(SineRadiansC_MFTWP)) {
-				compare_outputs(&tester, expected, sin_coefficients_table(tester.input_value, SineRadiansC_MFTWP[count], count), "mftwp(%u)", count);
+				compare_outputs(&tester, expected, odd_coefficients_table(tester.input_value, SineRadiansC_MFTWP[count], count), "mftwp(%u)", count);
 			}
 			
 			if (count == 9) {
@@ -141,11 +308,11 @@ int main() {
 			f64 expected = asin(tester.input_value);
 			
 			if (count < array_count(SineRadiansC_Taylor)) {
-				compare_outputs(&tester, expected, sin_coefficients_table(tester.input_value, ArcsineRadiansC_Taylor, count), "taylor(%u)", count);
+				compare_outputs(&tester, expected, odd_coefficients_table(tester.input_value, ArcsineRadiansC_Taylor, count), "taylor(%u)", count);
 			}
 			
 			if (count < array_count(SineRadiansC_MFTWP)) {
-				compare_outputs(&tester, expected, sin_coefficients_table(tester.input_value, ArcsineRadiansC_MFTWP[count], count), "mftwp(%u)", count);
+				compare_outputs(&tester, expected, odd_coefficients_table(tester.input_value, ArcsineRadiansC_MFTWP[count], count), "mftwp(%u)", count);
 			}
 			
 			if (count == 11) {
@@ -165,24 +332,126 @@ int main() {
 #endif
 	
 #if 1
-	while (try_start_precision_test(&tester, -PI64, PI64)) {
-		compare_outputs(&tester, sin(tester.input_value), sin_hv(tester.input_value), "sin_hv");
+	{
+		Math_Sweep sweep = make_sweep(sin, -PI64, PI64);
+		add_candidate(&sweep, sin_hv, "sin_hv");
+		run_sweep(&tester, &sweep);
 	}
 	
-	while (try_start_precision_test(&tester, -PI64/2, PI64/2)) {
-		compare_outputs(&tester, cos(tester.input_value), cos_hv(tester.input_value), "cos_hv");
+	{
+		Math_Sweep sweep = make_sweep(cos, -PI64/2, PI64/2);
+		add_candidate(&sweep, cos_hv, "cos_hv");
+		run_sweep(&tester, &sweep);
 	}
 	
-	while (try_start_precision_test(&tester, 0, 1)) {
-		compare_outputs(&tester, asin(tester.input_value), asin_hv(tester.input_value), "asin_hv");
+	{
+		Math_Sweep sweep = make_sweep(asin, 0, 1);
+		add_candidate(&sweep, asin_hv, "asin_hv");
+		run_sweep(&tester, &sweep);
 	}
 	
-	while (try_start_precision_test(&tester, 0, 1)) {
-		compare_outputs(&tester, sqrt(tester.input_value), sqrt_hv(tester.input_value), "sqrt_hv");
+	{
+		Math_Sweep sweep = make_float32_sweep(sqrt, 0, 1);
+		add_candidate(&sweep, sqrt_hv, "sqrt_hv (every f32)");
+		run_sweep(&tester, &sweep);
 	}
 #endif
 	
+#if 1
+	for (u32 count = 2; count < array_count(SineRadiansC_MFTWP); count += 1) {
+		while (try_start_precision_test(&tester, 0, PI64/2)) {
+			compare_outputs(&tester, sin(tester.input_value), odd_coefficients_table(tester.input_value, SineRadiansC_MFTWP[count], count), "sin mftwp(%u)", count);
+		}
+		ok &= check_last_test(&tester, SineRadiansC_MFTWP_MaxError[count]);
+	}
+	
+	for (u32 count = 2; count < array_count(ArcsineRadiansC_MFTWP); count += 1) {
+		while (try_start_precision_test(&tester, 0, ONE_OVER_SQRT2)) {
+			compare_outputs(&tester, asin(tester.input_value), odd_coefficients_table(tester.input_value, ArcsineRadiansC_MFTWP[count], count), "asin mftwp(%u)", count);
+		}
+		ok &= check_last_test(&tester, ArcsineRadiansC_MFTWP_MaxError[count]);
+	}
+	
+	for (u32 count = 2; count < array_count(SineRadiansC_Remez); count += 1) {
+		while (try_start_precision_test(&tester, 0, PI64/2)) {
+			compare_outputs(&tester, sin(tester.input_value), odd_coefficients_table(tester.input_value, SineRadiansC_Remez[count], count), "sin remez(%u)", count);
+		}
+		ok &= check_last_test(&tester, SineRadiansC_Remez_MaxError[count]);
+	}
+	
+	for (u32 count = 2; count < array_count(ArcsineRadiansC_Remez); count += 1) {
+		while (try_start_precision_test(&tester, 0, ONE_OVER_SQRT2)) {
+			compare_outputs(&tester, asin(tester.input_value), odd_coefficients_table(tester.input_value, ArcsineRadiansC_Remez[count], count), "asin remez(%u)", count);
+		}
+		ok &= check_last_test(&tester, ArcsineRadiansC_Remez_MaxError[count]);
+	}
+	
+	{
+		constexpr u32 sin_count  = lowest_coefficient_count(SineRadiansC_MFTWP_MaxError, 1e-9);
+		constexpr u32 asin_count = lowest_coefficient_count(ArcsineRadiansC_MFTWP_MaxError, 1e-9);
+		
+		while (try_start_precision_test(&tester, 0, PI64/2)) {
+			compare_outputs(&tester, sin(tester.input_value), odd_coefficients_table<sin_count>(tester.input_value, SineRadiansC_MFTWP[sin_count]), "sin within 1e-9 (%u)", sin_count);
+		}
+		ok &= check_last_test(&tester, 1e-9);
+		
+		while (try_start_precision_test(&tester, 0, ONE_OVER_SQRT2)) {
+			compare_outputs(&tester, asin(tester.input_value), odd_coefficients_table<asin_count>(tester.input_value, ArcsineRadiansC_MFTWP[asin_count]), "asin within 1e-9 (%u)", asin_count);
+		}
+		ok &= check_last_test(&tester, 1e-9);
+	}
+#endif
+	
+#if MATH_AVX2
+	if (cpu_has_avx2()) {
+		while (try_start_precision_test(&tester, -PI64, PI64)) {
+			compare_outputs_x4(&tester, -PI64, PI64, sin, sin_hv_x4, "sin_hv_x4");
+		}
+		
+		while (try_start_precision_test(&tester, -PI64/2, PI64/2)) {
+			compare_outputs_x4(&tester, -PI64/2, PI64/2, cos, cos_hv_x4, "cos_hv_x4");
+		}
+		
+		while (try_start_precision_test(&tester, 0, 1)) {
+			compare_outputs_x4(&tester, 0, 1, asin, asin_hv_x4, "asin_hv_x4");
+		}
+		
+		while (try_start_precision_test(&tester, 0, 1)) {
+			compare_outputs_x4(&tester, 0, 1, sqrt, sqrt_hv_x4, "sqrt_hv_x4");
+		}
+	}
+#endif
+	
+#if MATH_AVX512
+	if (cpu_has_avx512()) {
+		while (try_start_precision_test(&tester, -PI64, PI64)) {
+			compare_outputs_x8(&tester, -PI64, PI64, sin, sin_hv_x8, "sin_hv_x8");
+		}
+		
+		while (try_start_precision_test(&tester, -PI64/2, PI64/2)) {
+			compare_outputs_x8(&tester, -PI64/2, PI64/2, cos, cos_hv_x8, "cos_hv_x8");
+		}
+		
+		while (try_start_precision_test(&tester, 0, 1)) {
+			compare_outputs_x8(&tester, 0, 1, asin, asin_hv_x8, "asin_hv_x8");
+		}
+		
+		while (try_start_precision_test(&tester, 0, 1)) {
+			compare_outputs_x8(&tester, 0, 1, sqrt, sqrt_hv_x8, "sqrt_hv_x8");
+		}
+	}
+#endif
+	
+	if (do_f32) {
+		ok &= check_f32_functions(&tester);
+	}
+	
 	print_results(&tester);
 	
-	return 0;
+	if (haversine_file_name) {
+		check_haversine(haversine_file_name);
+	}
+	
+	int exit_code = ok ? 0 : 1;
+	return exit_code;
 }
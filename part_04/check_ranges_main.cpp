@@ -3,104 +3,229 @@
 
 #include "shared.cpp"
 #include "math.cpp"
-#include "reference_haversine.cpp"
+
+//
+// Finds the range of the inputs of every function the haversine formula calls, over the pairs of
+// a data_N_haveranswer.f64 file, with a histogram of each. A range that only fills part of the
+// domain, or a histogram with most of the inputs in a few buckets, is where a piecewise
+// approximation could get away with a cheaper polynomial. The file is mapped instead of read,
+// and the pairs are split in blocks across threads.
+//
+
+#define RANGE_HISTOGRAM_BUCKET_COUNT 32
+#define RANGE_BLOCK_PAIR_COUNT 4096
+
+enum Range_Func {
+	Range_Sin,
+	Range_Cos,
+	Range_Sqrt,
+	Range_Asin,
+	
+	Range_Func_Count,
+};
+
+struct Range_Domain {
+	char const *name;
+	f64 min, max;   // Of the histogram; inputs outside of it go to the first or last bucket
+	f64 split;      // Where the *_hv() version reflects |x|, or 0 if it doesn't
+	char const *split_label;
+};
+
+// NOTE(ema): dlon/2 goes up to PI, which is why sin has twice the domain of cos.
+static Range_Domain range_domains[Range_Func_Count] = {
+	{"sin",  -PI64,   PI64,   PI64/2,         "|x| > PI/2"},
+	{"cos",  -PI64/2, PI64/2, 0,              0},
+	{"sqrt", 0,       1,      0,              0},
+	{"asin", 0,       1,      ONE_OVER_SQRT2, "x > 1/sqrt(2)"},
+};
 
 struct Func_Range {
 	f64 min, max;
+	u64 count;
+	u64 split_count;
+	u64 histogram[RANGE_HISTOGRAM_BUCKET_COUNT];
 };
 
 struct Haversine_Ranges {
-	Func_Range sqrt, asin, sin, cos;
+	Func_Range funcs[Range_Func_Count];
+};
+
+struct Range_Context {
+	f64 *points; // x0, y0, x1, y1 for every pair
+	u64 pair_count;
+	Haversine_Ranges *thread_ranges;
+	
+	volatile u64 next_block;
+	volatile u32 next_thread;
 };
 
-static void update_range(f64 x, Func_Range *range) {
+static void init_ranges(Haversine_Ranges *ranges) {
+	*ranges = {};
+	for (u32 func = 0; func < Range_Func_Count; func += 1) {
+		ranges->funcs[func].min =  DBL_MAX;
+		ranges->funcs[func].max = -DBL_MAX;
+	}
+}
+
+static void update_range(Haversine_Ranges *ranges, Range_Func func, f64 x) {
+	Func_Range *range = &ranges->funcs[func];
+	Range_Domain *domain = &range_domains[func];
+	
 	if (range->min > x) { range->min = x; }
 	if (range->max < x) { range->max = x; }
+	
+	f64 t = (x - domain->min) / (domain->max - domain->min);
+	u32 bucket = 0;
+	if (t >= 1) {
+		bucket = RANGE_HISTOGRAM_BUCKET_COUNT - 1;
+	} else if (t > 0) {
+		bucket = (u32)(t*RANGE_HISTOGRAM_BUCKET_COUNT);
+	}
+	range->histogram[bucket] += 1;
+	range->count += 1;
+	
+	if (domain->split > 0 && fabs(x) > domain->split) {
+		range->split_count += 1;
+	}
 }
 
 static void update_haversine_ranges(f64 x0, f64 y0, f64 x1, f64 y1, Haversine_Ranges *ranges) {
-	f64 lat1 = y0;
-    f64 lat2 = y1;
-    f64 lon1 = x0;
-    f64 lon2 = x1;
-    
-    f64 dLat = radians_from_degrees_f64(lat2 - lat1);
-    f64 dLon = radians_from_degrees_f64(lon2 - lon1);
-    lat1 = radians_from_degrees_f64(lat1);
-    lat2 = radians_from_degrees_f64(lat2);
-    
-	update_range(dLat/2.0, &ranges->sin);
-	update_range(dLon/2.0, &ranges->sin);
+	f64 lat1 = radians_from_degrees_f64(y0);
+	f64 lat2 = radians_from_degrees_f64(y1);
+	f64 half_dlat = radians_from_degrees_f64(y1 - y0) / 2.0;
+	f64 half_dlon = radians_from_degrees_f64(x1 - x0) / 2.0;
 	
-	update_range(lat1, &ranges->cos);
-	update_range(lat2, &ranges->cos);
+	update_range(ranges, Range_Sin, half_dlat);
+	update_range(ranges, Range_Sin, half_dlon);
 	
-    f64 a = square_f64(sin(dLat/2.0)) + cos(lat1)*cos(lat2)*square_f64(sin(dLon/2.0));
-    
-	update_range(a, &ranges->sqrt);
-	update_range(sqrt(a), &ranges->asin);
+	update_range(ranges, Range_Cos, lat1);
+	update_range(ranges, Range_Cos, lat2);
 	
-	return;
+	// NOTE(ema): The *_hv() versions are within some ulps of libm on these ranges, which is plenty
+	// to find the ranges of sqrt and asin, and much cheaper.
+	f64 a = square_f64(sin_hv(half_dlat)) + cos_hv(lat1)*cos_hv(lat2)*square_f64(sin_hv(half_dlon));
+	
+	update_range(ranges, Range_Sqrt, a);
+	update_range(ranges, Range_Asin, sqrt_hv(a));
+}
+
+static void run_range_thread(void *param) {
+	Range_Context *context = (Range_Context *)param;
+	
+	u32 thread_index = atomic_add_u32(&context->next_thread, 1);
+	Haversine_Ranges *ranges = &context->thread_ranges[thread_index];
+	init_ranges(ranges);
+	
+	u64 block_count = (context->pair_count + RANGE_BLOCK_PAIR_COUNT - 1) / RANGE_BLOCK_PAIR_COUNT;
+	for (;;) {
+		u64 block_index = atomic_add_u64(&context->next_block, 1);
+		if (block_index >= block_count) break;
+		
+		u64 first_pair = block_index*RANGE_BLOCK_PAIR_COUNT;
+		u64 end_pair = first_pair + RANGE_BLOCK_PAIR_COUNT;
+		if (end_pair > context->pair_count) end_pair = context->pair_count;
+		
+		for (u64 pair_index = first_pair; pair_index < end_pair; pair_index += 1) {
+			f64 *pair = context->points + 4*pair_index;
+			update_haversine_ranges(pair[0], pair[1], pair[2], pair[3], ranges);
+		}
+	}
+}
+
+static void merge_ranges(Haversine_Ranges *dest, Haversine_Ranges *source) {
+	for (u32 func = 0; func < Range_Func_Count; func += 1) {
+		Func_Range *d = &dest->funcs[func];
+		Func_Range *s = &source->funcs[func];
+		
+		// NOTE(ema): A thread that could not start never initialized its ranges.
+		if (s->count == 0) continue;
+		
+		if (d->min > s->min) { d->min = s->min; }
+		if (d->max < s->max) { d->max = s->max; }
+		d->count += s->count;
+		d->split_count += s->split_count;
+		for (u32 bucket = 0; bucket < RANGE_HISTOGRAM_BUCKET_COUNT; bucket += 1) {
+			d->histogram[bucket] += s->histogram[bucket];
+		}
+	}
+}
+
+static void print_range(Range_Domain *domain, Func_Range *range) {
+	printf("\n%s: [%.17g, %.17g], %llu inputs\n", domain->name, range->min, range->max, (unsigned long long)range->count);
+	if (domain->split > 0 && range->count) {
+		printf("  %s: %llu (%.4f%%)\n", domain->split_label, (unsigned long long)range->split_count,
+			   100.0*(f64)range->split_count / (f64)range->count);
+	}
+	
+	f64 bucket_width = (domain->max - domain->min) / RANGE_HISTOGRAM_BUCKET_COUNT;
+	for (u32 bucket = 0; bucket < RANGE_HISTOGRAM_BUCKET_COUNT; bucket += 1) {
+		u64 count = range->histogram[bucket];
+		if (count) {
+			char label[64];
+			snprintf(label, sizeof(label), "[%+.4f, %+.4f)", domain->min + bucket*bucket_width, domain->min + (bucket + 1)*bucket_width);
+			
+			f64 percent = 100.0*(f64)count / (f64)range->count;
+			printf("  %-24s %12llu %8.4f%% ", label, (unsigned long long)count, percent);
+			
+			u32 bar_length = (u32)(percent / 2.0 + 0.5);
+			if (bar_length == 0) bar_length = 1;
+			for (u32 index = 0; index < bar_length; index += 1) {
+				printf("#");
+			}
+			printf("\n");
+		}
+	}
 }
 
 int main(int argc, char **argv) {
 	int exit_code = 0;
 	
-	if (argc == 2) {
-		char *file_name = argv[1];
-		u64 file_size = get_file_size(file_name);
-		if (file_size > 0) {
-			Buffer file_buf = alloc_buffer(file_size);
-			if (is_valid(file_buf)) {
-				FILE *file = fopen(file_name, "rb");
-				if (file) {
-					if (fread(file_buf.data, 1, file_buf.len, file) == file_buf.len) {
-						
-						f64 *points = (f64 *) file_buf.data;
-						u64  point_count = file_buf.len / sizeof(f64);
-						
-						Func_Range inv_inf = {DBL_MAX, -DBL_MAX};
-						Haversine_Ranges ranges = {};
-						ranges.sqrt = inv_inf;
-						ranges.asin = inv_inf;
-						ranges.sin = inv_inf;
-						ranges.cos = inv_inf;
-						
-						for (u64 point_index = 0; point_index < point_count - 3; point_index += 4) {
-							f64 x0 = points[point_index];
-							f64 y0 = points[point_index + 1];
-							f64 x1 = points[point_index + 2];
-							f64 y1 = points[point_index + 3];
-							
-							update_haversine_ranges(x0, y0, x1, y1, &ranges);
-						}
-						
-						printf("Ranges:\n");
-						printf("  sqrt: [%f, %f]\n", ranges.sqrt.min, ranges.sqrt.max);
-						printf("  asin: [%f, %f]\n", ranges.asin.min, ranges.asin.max);
-						printf("  sin: [%f, %f]\n", ranges.sin.min, ranges.sin.max);
-						printf("  cos: [%f, %f]\n", ranges.cos.min, ranges.cos.max);
-					} else {
-						fprintf(stderr, "Error: Cannot read file.\n");
-						exit_code = 1;
-					}
-					
-					fclose(file);
-					fclose(file);
-				} else {
-					fprintf(stderr, "Error: Cannot open file.\n");
-					exit_code = 1;
+	if (argc == 2 || argc == 3) {
+		u32 thread_count = (argc == 3) ? (u32)atoi(argv[2]) : get_processor_count();
+		if (thread_count == 0) thread_count = 1;
+		
+		Buffer file = map_file(argv[1]);
+		if (file.len >= sizeof(f64) && (file.len - sizeof(f64)) % (4*sizeof(f64)) == 0) {
+			// NOTE(ema): The last f64 is the answer, not part of a pair.
+			Range_Context context = {};
+			context.points = (f64 *) file.data;
+			context.pair_count = (file.len - sizeof(f64)) / (4*sizeof(f64));
+			context.thread_ranges = (Haversine_Ranges *)calloc(thread_count, sizeof(Haversine_Ranges));
+			
+			if (context.thread_ranges) {
+				u64 start = read_os_timer();
+				run_on_threads(thread_count, run_range_thread, &context);
+				u64 elapsed = read_os_timer() - start;
+				
+				Haversine_Ranges ranges = {};
+				init_ranges(&ranges);
+				for (u32 thread_index = 0; thread_index < thread_count; thread_index += 1) {
+					merge_ranges(&ranges, &context.thread_ranges[thread_index]);
 				}
+				
+				f64 seconds = (f64)elapsed / (f64)get_os_timer_frequency();
+				printf("%llu pairs on %u threads in %.3fms (%.3fgb/s)\n", (unsigned long long)context.pair_count, thread_count,
+					   1000.0*seconds, seconds > 0 ? (f64)file.len / (seconds*GIGABYTE) : 0);
+				
+				for (u32 func = 0; func < Range_Func_Count; func += 1) {
+					print_range(&range_domains[func], &ranges.funcs[func]);
+				}
+				
+				free(context.thread_ranges);
 			} else {
 				fprintf(stderr, "Error: Out of memory.\n");
 				exit_code = 1;
 			}
 		} else {
-			fprintf(stderr, "Error: Cannot use an input file of size 0.\n");
+			if (file.data) {
+				fprintf(stderr, "Error: %s is not a haversine input (x0, y0, x1, y1 for every pair, then the answer).\n", argv[1]);
+			}
 			exit_code = 1;
 		}
+		
+		unmap_file(&file);
 	} else {
-		fprintf(stderr, "Usage:\n\t%s <pairs_file.f64> <answers_file.f64>\n", argv[0]);
+		fprintf(stderr, "Usage: %s <data_N_haveranswer.f64> [thread count]\n", argv[0]);
 		exit_code = 1;
 	}
 	
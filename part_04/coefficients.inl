@@ -40,6 +40,13 @@ static f64 SineRadiansC_MFTWP[][11] = {
     {0x1p0, -0x1.5555555555555p-3, 0x1.11111111110dp-7, -0x1.a01a01a01559ap-13, 0x1.71de3a52ad36dp-19, -0x1.ae64549aa7ca9p-26, 0x1.612392f66fdcdp-33, -0x1.ae11556cad6c4p-41, 0x1.71744c339ad03p-49, 0x1.52947c90f8199p-55, -0x1.ff1898c107cfap-59},
 };
 
+// NOTE(ema): Max error of odd_coefficients_table(x, SineRadiansC_MFTWP[count], count) against
+// sin(x) on [0, PI/2], by count, measured on 10M samples and rounded up. check_precision
+// makes sure they still hold.
+static constexpr f64 SineRadiansC_MFTWP_MaxError[] = {
+    1, 1, 7.3e-3, 1.1e-4, 9.4e-7, 5.4e-9, 2.2e-11, 6.3e-14, 3.8e-16, 2.4e-16, 2.4e-16, 2.4e-16,
+};
+
 static f64 ArcsineRadiansC_Taylor[] = {
     1.0,
     0.1666666666666666666666666666666666666666666666666666666666666666666666666666667,
@@ -100,4 +107,13 @@ static f64 ArcsineRadiansC_MFTWP[][22] = {
     {0x1p0, 0x1.5555555555558p-3, 0x1.3333333332aedp-4, 0x1.6db6db6e45234p-5, 0x1.f1c71c24301p-6, 0x1.6e8baf9ddc763p-6, 0x1.1c4d64d353371p-6, 0x1.c9cf1f8de89e6p-7, 0x1.778d723247697p-7, 0x1.5fcac651d07d4p-7, 0x1.799c2f33c0274p-12, 0x1.e288894a8bc33p-5, -0x1.0446ef7fdb149p-2, 0x1.0ba0fa7048fb2p0, -0x1.a273e0e74ee85p1, 0x1.034f776a3db58p3, -0x1.f1adf47b08719p3, 0x1.6c271c319b92ap4, -0x1.886f83ada1ccfp4, 0x1.26c247c3a321bp4, -0x1.146482ddd5f29p3, 0x1.ed3ada8793e41p0},
 };
 
+// NOTE(ema): Same as SineRadiansC_MFTWP_MaxError, against asin(x) on [0, 1/sqrt(2)].
+static constexpr f64 ArcsineRadiansC_MFTWP_MaxError[] = {
+    1, 1, 3.1e-3, 3.0e-4, 3.3e-5, 4.3e-6, 5.8e-7, 8.1e-8, 1.2e-8, 1.7e-9, 2.5e-10, 3.8e-11,
+    5.7e-12, 8.8e-13, 1.4e-13, 2.2e-14, 3.5e-15, 6.7e-16, 2.3e-16, 1.6e-16, 1.5e-16, 1.5e-16, 1.4e-16,
+};
+
+// NOTE(ema): Our own fits, regenerated by fit_coefficients.
+#include "coefficients_remez.inl"
+
 #endif
@@ -0,0 +1,62 @@
+#ifndef COEFFICIENTS_REMEZ_H
+#define COEFFICIENTS_REMEZ_H
+
+// NOTE(ema): Generated by fit_coefficients, don't edit by hand. Row `count` holds `count`
+// coefficients of an odd polynomial, lowest power first, and the _MaxError tables hold the
+// error the Math_Tester measured for every row, with some headroom.
+
+// sin(x) on [0, 1.5707963267948966]
+static f64 SineRadiansC_Remez[][11] = {
+    {},
+    {},
+    {0x1.f8975408b262ep-1, -0x1.23fa061ecf353p-3},
+    {0x1.ffd84165190c7p-1, -0x1.534c684c132b2p-3, 0x1.ec76543b0918ep-8},
+    {0x1.ffff8e72deff7p-1, -0x1.554bb2077ed3p-3, 0x1.102e8199ad20dp-7, -0x1.811d1dd85b484p-13},
+    {0x1.ffffff36e89ccp-1, -0x1.55553bc9fa89ap-3, 0x1.110d6e1c6e60dp-7, -0x1.9f4142a9a746ep-13, 0x1.5bb081d0ec8bp-19},
+    {0x1.ffffffff0dc82p-1, -0x1.5555552a4e34bp-3, 0x1.111108542da71p-7, -0x1.a016f6603801p-13, 0x1.715a116800977p-19, -0x1.98ca41c393d26p-26},
+    {0x1.ffffffffff2ccp-1, -0x1.5555555523536p-3, 0x1.111111035e142p-7, -0x1.a019fb0130304p-13, 0x1.71dc95929cfefp-19, -0x1.adf44f885ba04p-26, 0x1.51e689cf7755bp-33},
+    {0x1.ffffffffffff7p-1, -0x1.55555555552aep-3, 0x1.1111111101fe8p-7, -0x1.a01a01967ddbfp-13, 0x1.71de37155e4f7p-19, -0x1.ae6317099e64bp-26, 0x1.60de7126a66a9p-33, -0x1.9e330ea46dc81p-41},
+    {0x1p+0, -0x1.5555555555554p-3, 0x1.111111111104dp-7, -0x1.a01a01a010103p-13, 0x1.71de3a510dcf1p-19, -0x1.ae64543d9cc18p-26, 0x1.6123acce84467p-33, -0x1.ae3c3365b608dp-41, 0x1.878343520cc21p-49},
+    {0x1p+0, -0x1.5555555555555p-3, 0x1.1111111111111p-7, -0x1.a01a01a019f9fp-13, 0x1.71de3a5568347p-19, -0x1.ae64567c82fep-26, 0x1.6124600e5ef8cp-33, -0x1.ae7ea0a41964cp-41, 0x1.94f98bde8f18cp-49, -0x1.261204c13157ap-57},
+    {0x1p+0, -0x1.5555555555555p-3, 0x1.1111111111111p-7, -0x1.a01a01a01a01ap-13, 0x1.71de3a556c702p-19, -0x1.ae64567f51bbcp-26, 0x1.612461392997dp-33, -0x1.ae7f3d805e3f6p-41, 0x1.952c08d914712p-49, -0x1.2f2a4d0765e6dp-57, 0x1.677e81d1e2ce5p-66},
+};
+
+static constexpr f64 SineRadiansC_Remez_MaxError[] = {
+    1, 1, 4.9e-03, 7.4e-05, 6.5e-07, 3.7e-09, 1.5e-11, 4.3e-14, 3.7e-16, 2.4e-16, 2.4e-16,
+    2.4e-16,
+};
+
+// asin(x) on [0, 0.70710678118654757]
+static f64 ArcsineRadiansC_Remez[][22] = {
+    {},
+    {},
+    {0x1.fa9caef4fadc7p-1, 0x1.e753d14a80baap-3},
+    {0x1.0063928b5db59p+0, 0x1.29812516cb2cp-3, 0x1.29ae13881fa11p-3},
+    {0x1.ffe1df8ac22e1p-1, 0x1.60a50166b3cfdp-3, 0x1.4983833aa69cap-5, 0x1.e41413911dccbp-4},
+    {0x1.000256fbc5d91p+0, 0x1.52a7db8d6c228p-3, 0x1.693ede163467dp-4, -0x1.e702a704fe4dp-8, 0x1.c308fa0217371p-4},
+    {0x1.ffff42b81973ap-1, 0x1.55eebbe2a88ap-3, 0x1.219b912ca507ep-4, 0x1.22fddd890c95fp-4, -0x1.6cc745c6cf618p-5, 0x1.c72d4ea45ea7fp-4},
+    {0x1.00000f222967dp+0, 0x1.553455d524a22p-3, 0x1.385f2c1fbdd21p-4, 0x1.138305ae06b87p-5, 0x1.40c2ab921ae46p-4, -0x1.53dba99dd1bbap-4, 0x1.e41e5957c379p-4},
+    {0x1.fffffb1df3559p-1, 0x1.555c39ef6e5cap-3, 0x1.31c9755f37dc2p-4, 0x1.8eb2ba2052699p-5, 0x1.81e7cf4ab85b1p-8, 0x1.ab054340ed49dp-4, -0x1.07ac0b637738fp-3, 0x1.0b32c604c424ap-3},
+    {0x1.0000006587ebp+0, 0x1.5553ecf942d8cp-3, 0x1.3390b67d55c1ap-4, 0x1.62c18e3eeab15p-5, 0x1.50e7278cc0821p-5, -0x1.bfda42f29db0fp-6, 0x1.3671095c1164dp-3, -0x1.7ea8be2377704p-3, 0x1.2f3b53d5c0644p-3},
+    {0x1.ffffffded5447p-1, 0x1.55559d9cdf69ap-3, 0x1.331c0dbd14e3fp-4, 0x1.7118d7eda9c88p-5, 0x1.acc58840d1a63p-6, 0x1.8810bbc088abcp-5, -0x1.3c7bd2e2379a8p-4, 0x1.d21bff47a3523p-3, -0x1.0d2069d28e713p-2, 0x1.5f9534742769p-3},
+    {0x1.00000002b8841p+0, 0x1.5555470be1a9ap-3, 0x1.3338bb6551e16p-4, 0x1.6cbaabb7c8501p-5, 0x1.054a07a59b5d7p-5, 0x1.632d1b0513e36p-7, 0x1.2ae8f7735ed06p-4, -0x1.434fc320b3c95p-3, 0x1.605ba2c94120dp-2, -0x1.74564313493c6p-2, 0x1.9eabc17a34b54p-3},
+    {0x1.ffffffff1a9a1p-1, 0x1.5555581f8da0cp-3, 0x1.3331ea5b17107p-4, 0x1.6dfce3ce641adp-5, 0x1.e976948c10517p-6, 0x1.bc1f6dfe842bp-6, -0x1.6f81d28b742d5p-7, 0x1.0638fd95688b6p-3, -0x1.286d55a3e0511p-2, 0x1.098f359482173p-1, -0x1.fe466c22319e9p-2, 0x1.eff288af9e4bep-3},
+    {0x1.0000000012f29p+0, 0x1.555554cb47e91p-3, 0x1.33337dbb74558p-4, 0x1.6da4298f893ap-5, 0x1.f4691eeea324bp-6, 0x1.511875deef021p-6, 0x1.f49c4129e80eep-6, -0x1.a72c342d43deep-5, 0x1.e04a1f3582fbcp-3, -0x1.017c164483c93p-1, 0x1.8db37c91f505ap-1, -0x1.5bae922e3e9dep-1, 0x1.2c09211c0e79ap-2},
+    {0x1.fffffffff9b92p-1, 0x1.5555556fc91e6p-3, 0x1.333322a6dae4bp-4, 0x1.6dbbaf00f1363p-5, 0x1.f0fba58ed6a55p-6, 0x1.79065ccd793d3p-6, 0x1.8112b13f047c3p-7, 0x1.86bfaa4a73d74p-5, -0x1.0b67e17401d1fp-3, 0x1.b78426f105a7dp-2, -0x1.b0a3e6419c292p-1, 0x1.27a63c9a0e216p+0, -0x1.d825d6577ace4p-1, 0x1.6e99a627da6d7p-2},
+    {0x1.0000000000856p+0, 0x1.555555504d8aap-3, 0x1.333336cf3d177p-4, 0x1.6db5a5724bf5bp-5, 0x1.f20215186bcb1p-6, 0x1.6b03a2289d58ep-6, 0x1.4094218c32ae1p-6, -0x1.e84cdc435013p-10, 0x1.7900f84660c1ep-4, -0x1.22ae16b467c13p-2, 0x1.8bf1f974fff8bp-1, -0x1.630cbc8fea994p+0, 0x1.b4841d02ca7f4p+0, -0x1.3fe4daeac393dp+0, 0x1.c3b3a86913ef7p-2},
+    {0x1.ffffffffffd3ap-1, 0x1.5555555648a05p-3, 0x1.3333326cbce9cp-4, 0x1.6db72749ef957p-5, 0x1.f1b69bbc171fcp-6, 0x1.6fae6491f05b2p-6, 0x1.0ece78df0fedp-6, 0x1.558e9c72d2018p-6, -0x1.e906e72563806p-6, 0x1.88314459b9752p-3, -0x1.268d8c4b04894p-1, 0x1.5de865e02bc8cp+0, -0x1.1e36df2c66226p+1, 0x1.4036afa4c266fp+1, -0x1.b0e6603f6e707p+0, 0x1.184e129e87ce9p-1},
+    {0x1.000000000003bp+0, 0x1.5555555527a2ap-3, 0x1.3333335d400c5p-4, 0x1.6db6c943698aap-5, 0x1.f1cb9717d00cp-6, 0x1.6e31d18bf158dp-6, 0x1.2114bf36c0af4p-6, 0x1.6dac165dc3b62p-7, 0x1.ff2c3d6a26e9bp-6, -0x1.78aca1451a483p-4, 0x1.9a2208fcdba3bp-2, -0x1.1dc3594eebe2ap+0, 0x1.2f7988bc4facap+1, -0x1.c6e1fca373c14p+1, 0x1.d32814042dc39p+1, -0x1.24aea5846a1d3p+1, 0x1.5e19bc3d7f33bp-1},
+    {0x1.fffffffffffecp-1, 0x1.555555555ddf7p-3, 0x1.3333332a659b1p-4, 0x1.6db6dfb20f00dp-5, 0x1.f1c5ed7dfaa0fp-6, 0x1.6ea66b3c84bc8p-6, 0x1.1ab1a67eb57ap-6, 0x1.ed0bbe2532447p-7, 0x1.74d12eeea02dp-9, 0x1.fcb8f4bc9a5cep-5, -0x1.d4ece670cd1p-3, 0x1.a4c8ba0effd4cp-1, -0x1.0c97a574fcc3cp+1, 0x1.02bbffe3b8045p+2, -0x1.653438e380b0cp+2, 0x1.531443c41380ep+2, -0x1.8b9791a8fe62dp+1, 0x1.b7b9ab6b338e5p-1},
+    {0x1.0000000000002p+0, 0x1.5555555553bebp-3, 0x1.3333333505f38p-4, 0x1.6db6da717a5d2p-5, 0x1.f1c76a990159ap-6, 0x1.6e83e544fcff4p-6, 0x1.1cd50c552a496p-6, 0x1.bc946b675ab86p-7, 0x1.f1b755de8cb36p-7, -0x1.f55c99b30346bp-7, 0x1.1ec78ce8d2cc8p-3, -0x1.0bc796bb74a01p-1, 0x1.a5092525b15cdp+0, -0x1.ec5c86285efdfp+1, 0x1.b27ea3c3851e3p+2, -0x1.15afcb34d0de7p+3, 0x1.ea17c0ad45938p+2, -0x1.0b4ab0cf90084p+2, 0x1.1585488123b34p+0},
+    {0x1.fffffffffffffp-1, 0x1.5555555555a0bp-3, 0x1.33333332d3749p-4, 0x1.6db6dba712aa5p-5, 0x1.f1c708b571b44p-6, 0x1.6e8dcff349bf9p-6, 0x1.1c249e6034a0ap-6, 0x1.ce2ebe9cd48b8p-7, 0x1.4b4090cd22e3p-7, 0x1.58b1cef2d43a7p-6, -0x1.e63c3c4a72c81p-5, 0x1.4a8182f1bd928p-2, -0x1.22ab075a32e22p+0, 0x1.9af23dda8ba1cp+1, -0x1.b9e94a1272bacp+2, 0x1.67ec9cbbececap+3, -0x1.ac016ae80bd55p+3, 0x1.60d3f41745311p+3, -0x1.6931d33b7944cp+2, 0x1.5fdb5a00eac5ep+0},
+    {0x1p+0, 0x1.5555555555477p-3, 0x1.3333333346ab9p-4, 0x1.6db6db60d98fap-5, 0x1.f1c721555f651p-6, 0x1.6e8b0a2d7aa5fp-6, 0x1.1c5b984b5706ap-6, 0x1.c80c16dcf9911p-7, 0x1.8c71f30cefd2dp-7, 0x1.44d8504e23f53p-8, 0x1.5063afa8983aap-5, -0x1.54ae95d122194p-3, 0x1.76a69ea564168p-1, -0x1.301a3139607f2p+1, 0x1.8806585f92845p+2, -0x1.85905a3b12f87p+3, 0x1.2699c16a0d9cp+4, -0x1.475b037ee3652p+4, 0x1.fa4e0e311da49p+3, -0x1.e8209ffb8d13cp+2, 0x1.bfe367c29d35p+0},
+    {0x1p+0, 0x1.555555555557ep-3, 0x1.333333332f459p-4, 0x1.6db6db70904b7p-5, 0x1.f1c71b410eef3p-6, 0x1.6e8bcbdad67fap-6, 0x1.1c4af96cac742p-6, 0x1.ca1bca24cacd2p-7, 0x1.7402d20b74f45p-7, 0x1.7fcad03b27dfcp-7, -0x1.a99f6fd1a8e45p-8, 0x1.8c12092c99272p-4, -0x1.ad01826485a99p-2, 0x1.9d668ea79e933p+0, -0x1.34dd643d9a8a6p+2, 0x1.6e5b811f54e9dp+3, -0x1.52134e7378063p+4, 0x1.dd27fb11df859p+4, -0x1.f169cb33b4027p+4, 0x1.6a3040f6478f7p+4, -0x1.49e2f002e08f4p+3, 0x1.1e1859dbc3f0ap+1},
+};
+
+static constexpr f64 ArcsineRadiansC_Remez_MaxError[] = {
+    1, 1, 1.8e-03, 1.8e-04, 2.1e-05, 2.6e-06, 3.5e-07, 4.8e-08, 6.9e-09, 9.9e-10, 1.5e-10,
+    2.2e-11, 3.3e-12, 5.1e-13, 7.8e-14, 1.2e-14, 2.1e-15, 4.9e-16, 2.4e-16, 2.4e-16, 2.4e-16,
+    1.2e-16, 1.2e-16,
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "shared.h"
+#include "math.h"
+#include "math_check.h"
+#include "remez.h"
+
+#include "shared.cpp"
+#include "math.cpp"
+#include "math_check.cpp"
+#include "remez.cpp"
+
+//
+// Fits minimax polynomials with the Remez exchange and checks them with the Math_Tester.
+// Without arguments it regenerates the tables in coefficients_remez.inl, otherwise it fits
+// a single polynomial for the given function and range and prints its coefficients.
+//
+
+struct Fit_Function {
+	char const *name;
+	DD_Func *dd_func;
+	Math_Func *reference;
+};
+
+static Fit_Function fit_functions[] = {
+	{"sin",  sin_dd,  sin},
+	{"cos",  cos_dd,  cos},
+	{"asin", asin_dd, asin},
+};
+
+struct Fit_Table {
+	char const *name;
+	Fit_Function *function;
+	f64 min, max;
+	u32 max_count;
+};
+
+static Fit_Table fit_tables[] = {
+	{"SineRadiansC_Remez",    &fit_functions[0], 0, PI64/2,         11},
+	{"ArcsineRadiansC_Remez", &fit_functions[2], 0, ONE_OVER_SQRT2, 22},
+};
+
+static f64 test_fit(Math_Tester *tester, Fit_Function *function, Remez_Fit *fit) {
+	while (try_start_precision_test(tester, fit->min, fit->max)) {
+		compare_outputs(tester, function->reference(tester->input_value), eval_fit(fit, tester->input_value),
+						"%s remez(%u)%s", function->name, fit->count, fit->converged ? "" : " (not converged)");
+	}
+	
+	f64 result = 0;
+	if (tester->completed_test_count > 0) {
+		result = tester->tests[tester->completed_test_count - 1].max_diff;
+	}
+	return result;
+}
+
+static void print_fit(Fit_Function *function, Remez_Fit *fit) {
+	printf("\n%s on [%.17g, %.17g], %u %s coefficients: %s after %u iterations, levelled error %.3e\n",
+		   function->name, fit->min, fit->max, fit->count, (fit->parity == Parity_Odd) ? "odd" : "even",
+		   fit->converged ? "converged" : "NOT converged", fit->iteration_count, fit->levelled_error);
+	
+	printf("{");
+	for (u32 index = 0; index < fit->count; index += 1) {
+		printf("%s%a", index ? ", " : "", fit->coefficients[index]);
+	}
+	printf("}\n");
+}
+
+static b32 write_fit_tables(char const *file_name, Math_Tester *tester) {
+	b32 ok = true;
+	
+	FILE *file = fopen(file_name, "wb");
+	if (file) {
+		fprintf(file, "#ifndef COEFFICIENTS_REMEZ_H\n#define COEFFICIENTS_REMEZ_H\n\n");
+		fprintf(file, "// NOTE(ema): Generated by fit_coefficients, don't edit by hand. Row `count` holds `count`\n");
+		fprintf(file, "// coefficients of an odd polynomial, lowest power first, and the _MaxError tables hold the\n");
+		fprintf(file, "// error the Math_Tester measured for every row, with some headroom.\n");
+		
+		for (u32 table_index = 0; table_index < array_count(fit_tables); table_index += 1) {
+			Fit_Table *table = &fit_tables[table_index];
+			
+			f64 max_errors[MAX_REMEZ_COEFFICIENT_COUNT] = {};
+			
+			fprintf(file, "\n// %s(x) on [%.17g, %.17g]\n", table->function->name, table->min, table->max);
+			fprintf(file, "static f64 %s[][%u] = {\n    {},\n    {},\n", table->name, table->max_count);
+			for (u32 count = 2; count <= table->max_count; count += 1) {
+				Remez_Fit fit = fit_minimax(table->function->dd_func, table->min, table->max, count, Parity_Odd);
+				print_fit(table->function, &fit);
+				max_errors[count] = test_fit(tester, table->function, &fit);
+				
+				fprintf(file, "    {");
+				for (u32 index = 0; index < fit.count; index += 1) {
+					fprintf(file, "%s%a", index ? ", " : "", fit.coefficients[index]);
+				}
+				fprintf(file, "},%s\n", fit.converged ? "" : " // NOTE(ema): Did not converge");
+			}
+			fprintf(file, "};\n\n");
+			
+			fprintf(file, "static constexpr f64 %s_MaxError[] = {\n    1, 1,", table->name);
+			for (u32 count = 2; count <= table->max_count; count += 1) {
+				// NOTE(ema): 10% on top, so a different sampling doesn't trip the check.
+				fprintf(file, "%s %.1e,", ((count - 2) % 10 == 9) ? "\n   " : "", 1.1*max_errors[count]);
+			}
+			fprintf(file, "\n};\n");
+		}
+		
+		fprintf(file, "\n#endif\n");
+		
+		ok = (fclose(file) == 0);
+	} else {
+		ok = false;
+	}
+	
+	if (!ok) {
+		fprintf(stderr, "Error: Cannot write \"%s\".\n", file_name);
+	}
+	
+	return ok;
+}
+
+int main(int argc, char **argv) {
+	int exit_code = 0;
+	
+	Math_Tester tester = {};
+	
+	if (argc == 1) {
+		if (!write_fit_tables("coefficients_remez.inl", &tester)) {
+			exit_code = 1;
+		}
+		print_results(&tester);
+	} else if (argc == 5 || argc == 6) {
+		Fit_Function *function = 0;
+		for (u32 function_index = 0; function_index < array_count(fit_functions); function_index += 1) {
+			if (strcmp(argv[1], fit_functions[function_index].name) == 0) {
+				function = &fit_functions[function_index];
+			}
+		}
+		
+		f64 min = atof(argv[2]);
+		f64 max = atof(argv[3]);
+		u32 count = (u32)atoi(argv[4]);
+		Polynomial_Parity parity = (argc == 6 && strcmp(argv[5], "even") == 0) ? Parity_Even : Parity_Odd;
+		
+		if (function && min < max && count > 0 && count < MAX_REMEZ_COEFFICIENT_COUNT) {
+			Remez_Fit fit = fit_minimax(function->dd_func, min, max, count, parity);
+			print_fit(function, &fit);
+			test_fit(&tester, function, &fit);
+			
+			if (!fit.converged) exit_code = 1;
+		} else {
+			fprintf(stderr, "Error: Invalid function, range or coefficient count.\n");
+			exit_code = 1;
+		}
+	} else {
+		fprintf(stderr, "Usage:\n\t%s\n\t%s <sin|cos|asin> <min> <max> <coefficient count> [odd|even]\n", argv[0], argv[0]);
+		exit_code = 1;
+	}
+	
+	return exit_code;
+}
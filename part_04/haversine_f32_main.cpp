@@ -0,0 +1,299 @@
+#include "shared.h"
+#include "math.h"
+#include "../part_03/repetition_tester.h"
+
+#include "shared.cpp"
+#include "math.cpp"
+#include "reference_haversine.cpp"
+#include "../part_03/repetition_tester.cpp"
+
+//
+// The haversine sum in f32, next to the f64 one. The pairs of a data_N_haveranswer.f64 file are
+// split into one array per coordinate (f64 and f32), then summed with haversine_hv() and
+// haversine_hv_f32(), scalar and 4/8 lanes wide. It prints where the error of f32 comes from,
+// checks the averages against the answer in the file and times every version.
+//
+
+// NOTE(ema): In km. The f32 inputs alone are off by up to half an ulp of 180 degrees (about
+// 1.7 m on the Earth), so single pairs can't do better than some meters (we measured up to 6 m).
+// The errors are as likely to be positive as negative though, so the average of many pairs gets
+// much closer (we measured 1e-5 km on a million pairs).
+#define HAVERSINE_F32_AVERAGE_TOLERANCE 1e-4
+#define HAVERSINE_F32_PAIR_TOLERANCE    1e-2
+
+struct Pairs_F64 {
+	u64 count;     // Rounded up to 8, the extra pairs are all 0 and have a distance of 0
+	f64 *x0, *y0, *x1, *y1;
+};
+
+struct Pairs_F32 {
+	u64 count;
+	f32 *x0, *y0, *x1, *y1;
+};
+
+///////////////////////////
+// Sums
+
+typedef f64 Sum_Proc_F64(Pairs_F64 *pairs);
+typedef f64 Sum_Proc_F32(Pairs_F32 *pairs);
+
+static f64 sum_haversine_hv(Pairs_F64 *pairs) {
+	f64 sum = 0;
+	for (u64 index = 0; index < pairs->count; index += 1) {
+		sum += haversine_hv(pairs->x0[index], pairs->y0[index], pairs->x1[index], pairs->y1[index], EARTH_RADIUS);
+	}
+	return sum;
+}
+
+// NOTE(ema): The f32 versions sum the angles and scale by the radius once, in f64. EARTH_RADIUS
+// rounded to f32 is 3e-8 too small, which is 3e-4 km on every distance of 10000 km and doesn't
+// average out. The sum is f64 too, a million f32 distances would lose the digits we're checking.
+
+static f64 sum_haversine_hv_f32(Pairs_F32 *pairs) {
+	f64 sum = 0;
+	for (u64 index = 0; index < pairs->count; index += 1) {
+		sum += haversine_hv_f32(pairs->x0[index], pairs->y0[index], pairs->x1[index], pairs->y1[index], 1.0f);
+	}
+	
+	f64 result = sum*EARTH_RADIUS;
+	return result;
+}
+
+#if MATH_AVX2
+static f64 sum_haversine_hv_x4(Pairs_F64 *pairs) {
+	__m256d r = _mm256_set1_pd(EARTH_RADIUS);
+	__m256d sum = _mm256_setzero_pd();
+	for (u64 index = 0; index < pairs->count; index += 4) {
+		__m256d x0 = _mm256_loadu_pd(pairs->x0 + index);
+		__m256d y0 = _mm256_loadu_pd(pairs->y0 + index);
+		__m256d x1 = _mm256_loadu_pd(pairs->x1 + index);
+		__m256d y1 = _mm256_loadu_pd(pairs->y1 + index);
+		sum = _mm256_add_pd(sum, haversine_hv_x4(x0, y0, x1, y1, r));
+	}
+	
+	f64 lanes[4];
+	_mm256_storeu_pd(lanes, sum);
+	f64 result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	return result;
+}
+
+static f64 sum_haversine_hv_f32_x8(Pairs_F32 *pairs) {
+	__m256 r = _mm256_set1_ps(1.0f);
+	__m256d sum_low  = _mm256_setzero_pd();
+	__m256d sum_high = _mm256_setzero_pd();
+	for (u64 index = 0; index < pairs->count; index += 8) {
+		__m256 x0 = _mm256_loadu_ps(pairs->x0 + index);
+		__m256 y0 = _mm256_loadu_ps(pairs->y0 + index);
+		__m256 x1 = _mm256_loadu_ps(pairs->x1 + index);
+		__m256 y1 = _mm256_loadu_ps(pairs->y1 + index);
+		__m256 distance = haversine_hv_f32_x8(x0, y0, x1, y1, r);
+		
+		sum_low  = _mm256_add_pd(sum_low,  _mm256_cvtps_pd(_mm256_castps256_ps128(distance)));
+		sum_high = _mm256_add_pd(sum_high, _mm256_cvtps_pd(_mm256_extractf128_ps(distance, 1)));
+	}
+	
+	f64 lanes[4];
+	_mm256_storeu_pd(lanes, _mm256_add_pd(sum_low, sum_high));
+	f64 result = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]))*EARTH_RADIUS;
+	return result;
+}
+#endif
+
+///////////////////////////
+// Error budget
+
+struct Error_Stat {
+	f64 max;
+	f64 total;
+	u64 index_at_max;
+};
+
+static void add_error(Error_Stat *stat, f64 diff, u64 index) {
+	diff = fabs(diff);
+	stat->total += diff;
+	if (stat->max < diff) {
+		stat->max = diff;
+		stat->index_at_max = index;
+	}
+}
+
+static void print_error(char const *label, Error_Stat *stat, u64 pair_count) {
+	printf("  %-34s max %.6e km (pair %llu), avg %.6e km\n", label, stat->max, (unsigned long long)stat->index_at_max,
+		   pair_count ? stat->total / (f64)pair_count : 0);
+}
+
+///////////////////////////
+// Timing
+
+static f64 time_sum(Sum_Proc_F64 *proc_f64, Pairs_F64 *pairs_f64, Sum_Proc_F32 *proc_f32, Pairs_F32 *pairs_f32,
+					u64 bytes_per_pair, u64 cpu_freq, u32 seconds_to_try) {
+	u64 byte_count = pairs_f64->count*bytes_per_pair;
+	
+	Repetition_Tester tester = {};
+	start_test_wave(&tester, byte_count, cpu_freq, seconds_to_try);
+	while (is_testing(&tester)) {
+		begin_timed_block(&tester);
+		volatile f64 sum = proc_f64 ? proc_f64(pairs_f64) : proc_f32(pairs_f32);
+		(void) sum;
+		end_timed_block(&tester);
+		
+		accumulate_byte_count(&tester, byte_count);
+	}
+	
+	f64 result = (f64)tester.min_time / (f64)pairs_f64->count;
+	return result;
+}
+
+int main(int argc, char **argv) {
+	int exit_code = 0;
+	
+	if (argc == 2 || argc == 3) {
+		u32 seconds_to_try = (argc == 3) ? (u32)atoi(argv[2]) : 5;
+		if (seconds_to_try == 0) seconds_to_try = 1;
+		
+		Buffer file = read_entire_file(argv[1]);
+		if (file.len >= sizeof(f64) && (file.len - sizeof(f64)) % (4*sizeof(f64)) == 0) {
+			f64 *values = (f64 *) file.data;
+			u64 pair_count = (file.len - sizeof(f64)) / (4*sizeof(f64));
+			f64 answer = values[4*pair_count];
+			
+			// NOTE(ema): One array per coordinate, so the wide versions load 4 or 8 of the same one
+			// at once.
+			u64 padded_count = (pair_count + 7) & ~7ULL;
+			Buffer soa = alloc_buffer(padded_count*4*(sizeof(f64) + sizeof(f32)));
+			if (soa.data) {
+				Pairs_F64 pairs_f64 = {padded_count};
+				pairs_f64.x0 = (f64 *) soa.data;
+				pairs_f64.y0 = pairs_f64.x0 + padded_count;
+				pairs_f64.x1 = pairs_f64.y0 + padded_count;
+				pairs_f64.y1 = pairs_f64.x1 + padded_count;
+				
+				Pairs_F32 pairs_f32 = {padded_count};
+				pairs_f32.x0 = (f32 *) (pairs_f64.y1 + padded_count);
+				pairs_f32.y0 = pairs_f32.x0 + padded_count;
+				pairs_f32.x1 = pairs_f32.y0 + padded_count;
+				pairs_f32.y1 = pairs_f32.x1 + padded_count;
+				
+				for (u64 index = 0; index < pair_count; index += 1) {
+					f64 *pair = values + 4*index;
+					pairs_f64.x0[index] = pair[0];
+					pairs_f64.y0[index] = pair[1];
+					pairs_f64.x1[index] = pair[2];
+					pairs_f64.y1[index] = pair[3];
+					
+					pairs_f32.x0[index] = (f32) pair[0];
+					pairs_f32.y0[index] = (f32) pair[1];
+					pairs_f32.x1[index] = (f32) pair[2];
+					pairs_f32.y1[index] = (f32) pair[3];
+				}
+				
+				// NOTE(ema): Where the error of f32 comes from, pair by pair. The reference at the
+				// inputs rounded to f32 splits it into what the rounding of the inputs costs and what
+				// the f32 arithmetic and polynomials cost on top of that.
+				Error_Stat input_error = {};
+				Error_Stat approximation_error = {};
+				Error_Stat total_error = {};
+				Error_Stat f64_error = {};
+				f64 reference_sum = 0;
+				for (u64 index = 0; index < pair_count; index += 1) {
+					f64 reference = reference_haversine(pairs_f64.x0[index], pairs_f64.y0[index], pairs_f64.x1[index], pairs_f64.y1[index], EARTH_RADIUS);
+					f64 rounded = reference_haversine(pairs_f32.x0[index], pairs_f32.y0[index], pairs_f32.x1[index], pairs_f32.y1[index], EARTH_RADIUS);
+					f64 output = EARTH_RADIUS*haversine_hv_f32(pairs_f32.x0[index], pairs_f32.y0[index], pairs_f32.x1[index], pairs_f32.y1[index], 1.0f);
+					f64 output_f64 = haversine_hv(pairs_f64.x0[index], pairs_f64.y0[index], pairs_f64.x1[index], pairs_f64.y1[index], EARTH_RADIUS);
+					
+					add_error(&input_error, rounded - reference, index);
+					add_error(&approximation_error, output - rounded, index);
+					add_error(&total_error, output - reference, index);
+					add_error(&f64_error, output_f64 - reference, index);
+					reference_sum += reference;
+				}
+				
+				printf("%llu pairs, answer in the file %.16f\n", (unsigned long long)pair_count, answer);
+				printf("\nError budget of haversine_hv_f32, against reference_haversine in f64:\n");
+				print_error("inputs rounded to f32", &input_error, pair_count);
+				print_error("f32 arithmetic and polynomials", &approximation_error, pair_count);
+				print_error("total", &total_error, pair_count);
+				print_error("(haversine_hv in f64)", &f64_error, pair_count);
+				
+				if (total_error.max > HAVERSINE_F32_PAIR_TOLERANCE) {
+					fprintf(stderr, "Error: haversine_hv_f32 is off by %.6e km on pair %llu, the tolerance is %.1e km.\n",
+							total_error.max, (unsigned long long)total_error.index_at_max, HAVERSINE_F32_PAIR_TOLERANCE);
+					exit_code = 1;
+				}
+				
+				struct Sum_Version {
+					char const *name;
+					Sum_Proc_F64 *proc_f64;
+					Sum_Proc_F32 *proc_f32;
+					u32 lane_count;
+				};
+				
+				Sum_Version versions[] = {
+					{"haversine_hv",        sum_haversine_hv,     0,                       1},
+					{"haversine_hv_f32",    0,                    sum_haversine_hv_f32,    1},
+#if MATH_AVX2
+					{"haversine_hv_x4",     sum_haversine_hv_x4,  0,                       4},
+					{"haversine_hv_f32_x8", 0,                    sum_haversine_hv_f32_x8, 8},
+#endif
+				};
+				
+				f64 ticks_per_pair[array_count(versions)] = {};
+				f64 averages[array_count(versions)] = {};
+				b32 skipped[array_count(versions)] = {};
+				
+				u64 cpu_freq = estimate_cpu_timer_frequency();
+				for (u32 version_index = 0; version_index < array_count(versions); version_index += 1) {
+					Sum_Version *version = &versions[version_index];
+					skipped[version_index] = (version->lane_count > 1 && !cpu_has_avx2());
+					
+					if (!skipped[version_index]) {
+						f64 sum = version->proc_f64 ? version->proc_f64(&pairs_f64) : version->proc_f32(&pairs_f32);
+						averages[version_index] = sum / (f64)pair_count;
+						
+						u64 bytes_per_pair = 4*(version->proc_f64 ? sizeof(f64) : sizeof(f32));
+						
+						printf("\n--- Now testing: %s ---\n", version->name);
+						ticks_per_pair[version_index] = time_sum(version->proc_f64, &pairs_f64, version->proc_f32, &pairs_f32,
+																 bytes_per_pair, cpu_freq, seconds_to_try);
+					}
+				}
+				
+				printf("\nAverage of reference_haversine: %.16f (%+.6e from the file)\n", reference_sum / (f64)pair_count, reference_sum / (f64)pair_count - answer);
+				printf("\n%-22s %22s %14s %12s %12s\n", "", "average", "vs file", "ticks/pair", "bytes/pair");
+				for (u32 version_index = 0; version_index < array_count(versions); version_index += 1) {
+					Sum_Version *version = &versions[version_index];
+					if (!skipped[version_index]) {
+						f64 diff = averages[version_index] - answer;
+						printf("%-22s %22.16f %+14.6e %12.2f %12u\n", version->name, averages[version_index], diff,
+							   ticks_per_pair[version_index], version->proc_f64 ? 32 : 16);
+						
+						if (!version->proc_f64 && !(fabs(diff) <= HAVERSINE_F32_AVERAGE_TOLERANCE)) {
+							fprintf(stderr, "Error: The average of %s is off by %.6e km, the tolerance is %.1e km.\n",
+									version->name, diff, HAVERSINE_F32_AVERAGE_TOLERANCE);
+							exit_code = 1;
+						}
+					}
+				}
+				
+				free_buffer(&soa);
+			} else {
+				fprintf(stderr, "Error: Out of memory.\n");
+				exit_code = 1;
+			}
+		} else {
+			if (is_valid(file)) {
+				fprintf(stderr, "Error: %s is not a haversine input (x0, y0, x1, y1 for every pair, then the answer).\n", argv[1]);
+			}
+			exit_code = 1;
+		}
+		
+		if (file.data) {
+			free_buffer(&file);
+		}
+	} else {
+		fprintf(stderr, "Usage: %s [data_N_haveranswer.f64] [seconds to try]\n", argv[0]);
+		exit_code = 1;
+	}
+	
+	return exit_code;
+}
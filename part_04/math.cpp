@@ -6,12 +6,12 @@ static f64 square_f64(f64 x) {
     return y;
 }
 
-__declspec(noinline) static f64 cvt_01_to_neg1pos1(f64 b) {
+NOINLINE static f64 cvt_01_to_neg1pos1(f64 b) {
 	f64 y = 2*b - 1;
 	return y;
 }
 
-__declspec(noinline) static f64 sign_f64(f64 x) {
+NOINLINE static f64 sign_f64(f64 x) {
 #if 0
 	union IEEE_F64 { f64 x; u64 u; };
 	IEEE_F64 sign_bit = {};
@@ -220,20 +220,62 @@ static f64 sin_taylor_horner_fma(f64 x, u32 max_exp) {
 	return y;
 }
 
-static f64 odd_coefficients_table(f64 x, f64 *values, u32 count) {
-	// NOTE(ema): Approximate any function given a table of coefficients.
-	f64 y = values[count - 1];
-	
-	f64 x2 = x*x;
-	for (u32 index = count - 1; index != 0; index -= 1) {
-		f64 c = values[index - 1];
-		y = fma(y, x2, c);
+template <u32 Count>
+struct Odd_Horner {
+	static f64 eval(f64 y, f64 x2, f64 const *values) {
+		f64 result = Odd_Horner<Count - 1>::eval(fma(y, x2, values[Count - 1]), x2, values);
+		return result;
 	}
+};
+
+template <>
+struct Odd_Horner<0> {
+	static f64 eval(f64 y, f64 x2, f64 const *values) {
+		(void)x2; (void)values;
+		return y;
+	}
+};
+
+template <u32 Count>
+static f64 odd_coefficients_table(f64 x, f64 const *values) {
+	// NOTE(ema): Approximate any function given a table of coefficients. The recursion on Count
+	// is resolved at compile time, which leaves nothing but the FMAs.
+	static_assert(Count > 0, "at least one coefficient is needed");
+	f64 x2 = x*x;
+	
+	f64 y = Odd_Horner<Count - 1>::eval(values[Count - 1], x2, values);
 	y *= x;
 	
 	return y;
 }
 
+typedef f64 Odd_Coefficients_Proc(f64 x, f64 const *values);
+
+static Odd_Coefficients_Proc *odd_coefficients_procs[MAX_ODD_COEFFICIENT_COUNT + 1] = {
+	0,
+	odd_coefficients_table<1>,  odd_coefficients_table<2>,  odd_coefficients_table<3>,  odd_coefficients_table<4>,
+	odd_coefficients_table<5>,  odd_coefficients_table<6>,  odd_coefficients_table<7>,  odd_coefficients_table<8>,
+	odd_coefficients_table<9>,  odd_coefficients_table<10>, odd_coefficients_table<11>, odd_coefficients_table<12>,
+	odd_coefficients_table<13>, odd_coefficients_table<14>, odd_coefficients_table<15>, odd_coefficients_table<16>,
+	odd_coefficients_table<17>, odd_coefficients_table<18>, odd_coefficients_table<19>, odd_coefficients_table<20>,
+	odd_coefficients_table<21>, odd_coefficients_table<22>,
+};
+
+static f64 odd_coefficients_table(f64 x, f64 const *values, u32 count) {
+	assert(count > 0 && count <= MAX_ODD_COEFFICIENT_COUNT);
+	f64 y = odd_coefficients_procs[count](x, values);
+	return y;
+}
+
+template <u32 Table_Count>
+constexpr u32 lowest_coefficient_count(f64 const (&max_errors)[Table_Count], f64 max_error) {
+	u32 result = Table_Count - 1;
+	for (u32 count = Table_Count - 1; count > 0; count -= 1) {
+		if (max_errors[count] <= max_error) result = count;
+	}
+	return result;
+}
+
 static f64 sin_ce(f64 x) {
 	// NOTE(ema): Approximate sin(x) in the range [0, PI/2] using 9 minimax coefficients.
 	// The coefficients were donated by Demetri Spanos.
@@ -316,22 +358,29 @@ static f64 sqrt_hv(f64 x) {
 	return y;
 }
 
+// NOTE(ema): The coefficients of sin_hv() and asin_hv(), from the highest power down. They were
+// donated by Demetri Spanos.
+static f64 sin_hv_coefficients[] = {
+	0x1.883c1c5deffbep-49, -0x1.ae43dc9bf8ba7p-41, 0x1.6123ce513b09fp-33, -0x1.ae6454d960ac4p-26, 0x1.71de3a52aab96p-19,
+	-0x1.a01a01a014eb6p-13, 0x1.11111111110c9p-7, -0x1.5555555555555p-3, 0x1p0,
+};
+
+static f64 asin_hv_coefficients[] = {
+	0x1.699a7715830d2p-3, -0x1.2deb335977b56p-2, 0x1.103aa8bb00a4ep-2, -0x1.ba657aa72abeep-4, 0x1.b627b3be92bd4p-5,
+	0x1.0076fe3314273p-6, 0x1.fe5b240c320ebp-6, 0x1.6d4c8c3659p-5, 0x1.3334fd1dd69f5p-4, 0x1.5555525723f64p-3,
+	0x1.0000000034db9p0,
+};
+
 static f64 sin_hv(f64 x) {
-	// NOTE(ema): The coefficients were donated by Demetri Spanos.
 	f64 t = fabs(x);
 	if (t > PI64/2) t = (PI64 - t);
 	
 	f64 t2 = t*t;
 	
-	f64 y = 0x1.883c1c5deffbep-49;
-	y = fma(y, t2, -0x1.ae43dc9bf8ba7p-41);
-	y = fma(y, t2, 0x1.6123ce513b09fp-33);
-	y = fma(y, t2, -0x1.ae6454d960ac4p-26);
-	y = fma(y, t2, 0x1.71de3a52aab96p-19);
-	y = fma(y, t2, -0x1.a01a01a014eb6p-13);
-	y = fma(y, t2, 0x1.11111111110c9p-7);
-	y = fma(y, t2, -0x1.5555555555555p-3);
-	y = fma(y, t2, 0x1p0);
+	f64 y = sin_hv_coefficients[0];
+	for (u32 index = 1; index < array_count(sin_hv_coefficients); index += 1) {
+		y = fma(y, t2, sin_hv_coefficients[index]);
+	}
 	y *= t;
 	
 	if (x < 0) y = -y;
@@ -345,7 +394,6 @@ static f64 cos_hv(f64 x) {
 }
 
 static f64 asin_hv(f64 x) {
-	// NOTE(ema): The coefficients were donated by Demetri Spanos.
 	f64 t = x;
 	if (x > ONE_OVER_SQRT2) {
 		t = sqrt_sse(1 - square_f64(x));
@@ -353,17 +401,10 @@ static f64 asin_hv(f64 x) {
 	
 	f64 t2 = t*t;
 	
-	f64 y = 0x1.699a7715830d2p-3;
-	y = fma(y, t2, -0x1.2deb335977b56p-2);
-	y = fma(y, t2, 0x1.103aa8bb00a4ep-2);
-	y = fma(y, t2, -0x1.ba657aa72abeep-4);
-	y = fma(y, t2, 0x1.b627b3be92bd4p-5);
-	y = fma(y, t2, 0x1.0076fe3314273p-6);
-	y = fma(y, t2, 0x1.fe5b240c320ebp-6);
-	y = fma(y, t2, 0x1.6d4c8c3659p-5);
-	y = fma(y, t2, 0x1.3334fd1dd69f5p-4);
-	y = fma(y, t2, 0x1.5555525723f64p-3);
-	y = fma(y, t2, 0x1.0000000034db9p0);
+	f64 y = asin_hv_coefficients[0];
+	for (u32 index = 1; index < array_count(asin_hv_coefficients); index += 1) {
+		y = fma(y, t2, asin_hv_coefficients[index]);
+	}
 	y *= t;
 	
 	if (x > ONE_OVER_SQRT2) {
@@ -372,3 +413,473 @@ static f64 asin_hv(f64 x) {
 	
 	return y;
 }
+
+///////////////////////////
+// f32 finalized math functions
+
+// NOTE(ema): PI/2 and PI as the sum of the nearest f32 and what's left. Subtracting from the high
+// part is exact where the argument is close to it, which is where the result gets small, so the
+// reductions stay accurate to the last bit there.
+#define HALF_PI32_HI  0x1.921fb6p+0f
+#define HALF_PI32_LO -0x1.777a5cp-25f
+#define PI32_HI       0x1.921fb6p+1f
+#define PI32_LO      -0x1.777a5cp-24f
+
+static f32 sqrt_hv_f32(f32 x) {
+	__m128 sse_x = _mm_set_ss(x);
+	__m128 sse_y = _mm_sqrt_ss(sse_x);
+	f32 y = _mm_cvtss_f32(sse_y);
+	return y;
+}
+
+// NOTE(ema): From the highest power down, like the f64 ones.
+static f32 sin_hv_f32_coefficients[] = {
+	-0x1.98ca42p-26f, 0x1.715a12p-19f, -0x1.a016f6p-13f, 0x1.111108p-7f, -0x1.555556p-3f, 0x1p0f,
+};
+
+static f32 asin_hv_f32_coefficients[] = {
+	0x1.2f3b54p-3f, -0x1.7ea8bep-3f, 0x1.36710ap-3f, -0x1.bfda42p-6f, 0x1.50e728p-5f, 0x1.62c18ep-5f,
+	0x1.3390b6p-4f, 0x1.5553ecp-3f, 0x1p0f,
+};
+
+static f32 sin_hv_f32_quarter(f32 t) {
+	// NOTE(ema): t in [0, PI/2].
+	f32 t2 = t*t;
+	
+	f32 y = sin_hv_f32_coefficients[0];
+	for (u32 index = 1; index < array_count(sin_hv_f32_coefficients); index += 1) {
+		y = fmaf(y, t2, sin_hv_f32_coefficients[index]);
+	}
+	y *= t;
+	
+	return y;
+}
+
+static f32 sin_hv_f32(f32 x) {
+	f32 t = fabsf(x);
+	if (t > HALF_PI32_HI) t = (PI32_HI - t) + PI32_LO;
+	
+	f32 y = sin_hv_f32_quarter(t);
+	
+	if (x < 0) y = -y;
+	
+	return y;
+}
+
+static f32 cos_hv_f32(f32 x) {
+	// NOTE(ema): cos(x) = sin(PI/2 - |x|), which is better than shifting x by PI/2 when the result
+	// is close to 0.
+	f32 t = (HALF_PI32_HI - fabsf(x)) + HALF_PI32_LO;
+	
+	f32 y = sin_hv_f32_quarter(t);
+	return y;
+}
+
+static f32 asin_hv_f32(f32 x) {
+	f32 t = x;
+	b32 reflect = x > (f32)ONE_OVER_SQRT2;
+	if (reflect) {
+		// NOTE(ema): 1 - x is exact for x in [0.5, 1], which 1 - x*x wouldn't be.
+		t = sqrt_hv_f32((1 - x)*(1 + x));
+	}
+	
+	f32 t2 = t*t;
+	
+	f32 y = asin_hv_f32_coefficients[0];
+	for (u32 index = 1; index < array_count(asin_hv_f32_coefficients); index += 1) {
+		y = fmaf(y, t2, asin_hv_f32_coefficients[index]);
+	}
+	y *= t;
+	
+	if (reflect) y = HALF_PI32_HI + (HALF_PI32_LO - y);
+	
+	return y;
+}
+
+///////////////////////////
+// Wide finalized math functions
+
+#if MATH_AVX2
+
+static __m256d sqrt_hv_x4(__m256d x) {
+	__m256d y = _mm256_sqrt_pd(x);
+	return y;
+}
+
+static __m256d sin_hv_x4(__m256d x) {
+	__m256d sign_bit = _mm256_set1_pd(-0.0);
+	
+	__m256d t = _mm256_andnot_pd(sign_bit, x);
+	__m256d reflected = _mm256_sub_pd(_mm256_set1_pd(PI64), t);
+	t = _mm256_blendv_pd(t, reflected, _mm256_cmp_pd(t, _mm256_set1_pd(PI64/2), _CMP_GT_OQ));
+	
+	__m256d t2 = _mm256_mul_pd(t, t);
+	
+	__m256d y = _mm256_set1_pd(sin_hv_coefficients[0]);
+	for (u32 index = 1; index < array_count(sin_hv_coefficients); index += 1) {
+		y = _mm256_fmadd_pd(y, t2, _mm256_set1_pd(sin_hv_coefficients[index]));
+	}
+	y = _mm256_mul_pd(y, t);
+	
+	// NOTE(ema): y is never negative here, so the sign of x can be copied over.
+	y = _mm256_or_pd(y, _mm256_and_pd(x, sign_bit));
+	
+	return y;
+}
+
+static __m256d cos_hv_x4(__m256d x) {
+	__m256d y = sin_hv_x4(_mm256_add_pd(x, _mm256_set1_pd(PI64/2)));
+	return y;
+}
+
+static __m256d asin_hv_x4(__m256d x) {
+	__m256d one = _mm256_set1_pd(1.0);
+	__m256d use_sqrt = _mm256_cmp_pd(x, _mm256_set1_pd(ONE_OVER_SQRT2), _CMP_GT_OQ);
+	
+	__m256d t = _mm256_sqrt_pd(_mm256_sub_pd(one, _mm256_mul_pd(x, x)));
+	t = _mm256_blendv_pd(x, t, use_sqrt);
+	
+	__m256d t2 = _mm256_mul_pd(t, t);
+	
+	__m256d y = _mm256_set1_pd(asin_hv_coefficients[0]);
+	for (u32 index = 1; index < array_count(asin_hv_coefficients); index += 1) {
+		y = _mm256_fmadd_pd(y, t2, _mm256_set1_pd(asin_hv_coefficients[index]));
+	}
+	y = _mm256_mul_pd(y, t);
+	
+	y = _mm256_blendv_pd(y, _mm256_sub_pd(_mm256_set1_pd(PI64/2), y), use_sqrt);
+	
+	return y;
+}
+
+#endif
+
+#if MATH_AVX512
+
+static __m512d sqrt_hv_x8(__m512d x) {
+	// NOTE(ema): Same as _mm512_sqrt_pd(), which GCC 12 implements with an uninitialized
+	// pass-through operand and then warns about it.
+	__m512d y = _mm512_maskz_sqrt_pd((__mmask8)0xff, x);
+	return y;
+}
+
+static __m512d sin_hv_x8(__m512d x) {
+	__m512d t = _mm512_abs_pd(x);
+	__mmask8 reflect = _mm512_cmp_pd_mask(t, _mm512_set1_pd(PI64/2), _CMP_GT_OQ);
+	t = _mm512_mask_sub_pd(t, reflect, _mm512_set1_pd(PI64), t);
+	
+	__m512d t2 = _mm512_mul_pd(t, t);
+	
+	__m512d y = _mm512_set1_pd(sin_hv_coefficients[0]);
+	for (u32 index = 1; index < array_count(sin_hv_coefficients); index += 1) {
+		y = _mm512_fmadd_pd(y, t2, _mm512_set1_pd(sin_hv_coefficients[index]));
+	}
+	y = _mm512_mul_pd(y, t);
+	
+	__mmask8 negative = _mm512_cmp_pd_mask(x, _mm512_setzero_pd(), _CMP_LT_OQ);
+	y = _mm512_mask_sub_pd(y, negative, _mm512_setzero_pd(), y);
+	
+	return y;
+}
+
+static __m512d cos_hv_x8(__m512d x) {
+	__m512d y = sin_hv_x8(_mm512_add_pd(x, _mm512_set1_pd(PI64/2)));
+	return y;
+}
+
+static __m512d asin_hv_x8(__m512d x) {
+	__mmask8 use_sqrt = _mm512_cmp_pd_mask(x, _mm512_set1_pd(ONE_OVER_SQRT2), _CMP_GT_OQ);
+	
+	__m512d t = _mm512_mask_sqrt_pd(x, use_sqrt, _mm512_sub_pd(_mm512_set1_pd(1.0), _mm512_mul_pd(x, x)));
+	
+	__m512d t2 = _mm512_mul_pd(t, t);
+	
+	__m512d y = _mm512_set1_pd(asin_hv_coefficients[0]);
+	for (u32 index = 1; index < array_count(asin_hv_coefficients); index += 1) {
+		y = _mm512_fmadd_pd(y, t2, _mm512_set1_pd(asin_hv_coefficients[index]));
+	}
+	y = _mm512_mul_pd(y, t);
+	
+	y = _mm512_mask_sub_pd(y, use_sqrt, _mm512_set1_pd(PI64/2), y);
+	
+	return y;
+}
+
+#endif
+
+///////////////////////////
+// Fused haversine
+
+static f64 haversine_hv(f64 x0, f64 y0, f64 x1, f64 y1, f64 r) {
+	f64 half_radians_per_degree = 0.01745329251994329577 / 2;
+	
+	f64 lat1 = radians_from_degrees_f64(y0);
+	f64 lat2 = radians_from_degrees_f64(y1);
+	f64 half_dlat = half_radians_per_degree * (y1 - y0);
+	f64 half_dlon = half_radians_per_degree * (x1 - x0);
+	
+	// NOTE(ema): The four sines are evaluated together, in one pass over the coefficients:
+	//  - half_dlat is in [-PI/2, PI/2] and its sine is squared, so the sign can stay.
+	//  - half_dlon is in [-PI, PI] and its sine is squared too, so only the reflection of
+	//    sin_hv() is needed.
+	//  - cos(lat) = sin(PI/2 - |lat|), and PI/2 - |lat| is in [0, PI/2] because lat is.
+	f64 t_dlat = half_dlat;
+	f64 t_dlon = fabs(half_dlon);
+	if (t_dlon > PI64/2) t_dlon = PI64 - t_dlon;
+	f64 t_lat1 = PI64/2 - fabs(lat1);
+	f64 t_lat2 = PI64/2 - fabs(lat2);
+	
+	f64 t2_dlat = t_dlat*t_dlat;
+	f64 t2_dlon = t_dlon*t_dlon;
+	f64 t2_lat1 = t_lat1*t_lat1;
+	f64 t2_lat2 = t_lat2*t_lat2;
+	
+	f64 sin_dlat = sin_hv_coefficients[0];
+	f64 sin_dlon = sin_hv_coefficients[0];
+	f64 cos_lat1 = sin_hv_coefficients[0];
+	f64 cos_lat2 = sin_hv_coefficients[0];
+	for (u32 index = 1; index < array_count(sin_hv_coefficients); index += 1) {
+		f64 c = sin_hv_coefficients[index];
+		sin_dlat = fma(sin_dlat, t2_dlat, c);
+		sin_dlon = fma(sin_dlon, t2_dlon, c);
+		cos_lat1 = fma(cos_lat1, t2_lat1, c);
+		cos_lat2 = fma(cos_lat2, t2_lat2, c);
+	}
+	sin_dlat *= t_dlat;
+	sin_dlon *= t_dlon;
+	cos_lat1 *= t_lat1;
+	cos_lat2 *= t_lat2;
+	
+	f64 a = sin_dlat*sin_dlat + cos_lat1*cos_lat2*(sin_dlon*sin_dlon);
+	
+	// NOTE(ema): a is in [0, 1], so asin() only sees [0, 1] and never needs the sign. Above
+	// 1/sqrt(2), asin_hv() takes sqrt(1 - x*x), and x*x is a itself: that's one sqrt either way,
+	// and the square of the polynomial argument comes for free.
+	// Rounding can push a just past 1 for antipodal points, which would make the sqrt a NaN.
+	b32 reflect = a > 0.5;
+	f64 u2 = reflect ? (1 - a) : a;
+	if (u2 < 0) u2 = 0;
+	f64 u  = sqrt_hv(u2);
+	
+	f64 y = asin_hv_coefficients[0];
+	for (u32 index = 1; index < array_count(asin_hv_coefficients); index += 1) {
+		y = fma(y, u2, asin_hv_coefficients[index]);
+	}
+	y *= u;
+	
+	if (reflect) y = (PI64/2) - y;
+	
+	f64 result = r * 2.0 * y;
+	return result;
+}
+
+// NOTE(ema): Same as haversine_hv(), with the f32 polynomials, but a is not computed the same
+// way. Near antipodes a gets close to 1, and 1 - a loses all the bits that asin() then needs:
+// in f32 that's almost a km. Writing cos(lat1)*cos(lat2) with the half sum and difference of the
+// latitudes gives both a and 1 - a as sums of positive terms, so neither of them cancels:
+//
+//   a     = sin^2(dlat/2)*cos^2(dlon/2) + cos^2(slat/2)*sin^2(dlon/2)
+//   1 - a = cos^2(dlat/2)*cos^2(dlon/2) + sin^2(slat/2)*sin^2(dlon/2)
+//
+// where slat = lat1 + lat2. It takes six sines instead of four, all in [-PI/2, PI/2] after the
+// same reductions as sin_hv_f32() and cos_hv_f32().
+static f32 haversine_hv_f32(f32 x0, f32 y0, f32 x1, f32 y1, f32 r) {
+	f32 half_radians_per_degree = 0.01745329251994329577f / 2;
+	
+	f32 half_dlat = half_radians_per_degree * (y1 - y0);
+	f32 half_slat = half_radians_per_degree * (y1 + y0);
+	f32 half_dlon = half_radians_per_degree * (x1 - x0);
+	
+	f32 t_sin_dlat = half_dlat;
+	f32 t_cos_dlat = (HALF_PI32_HI - fabsf(half_dlat)) + HALF_PI32_LO;
+	f32 t_sin_slat = half_slat;
+	f32 t_cos_slat = (HALF_PI32_HI - fabsf(half_slat)) + HALF_PI32_LO;
+	f32 t_sin_dlon = fabsf(half_dlon);
+	if (t_sin_dlon > HALF_PI32_HI) t_sin_dlon = (PI32_HI - t_sin_dlon) + PI32_LO;
+	f32 t_cos_dlon = (HALF_PI32_HI - fabsf(half_dlon)) + HALF_PI32_LO; // Negative past PI/2, but it gets squared
+	
+	f32 t2_sin_dlat = t_sin_dlat*t_sin_dlat;
+	f32 t2_cos_dlat = t_cos_dlat*t_cos_dlat;
+	f32 t2_sin_slat = t_sin_slat*t_sin_slat;
+	f32 t2_cos_slat = t_cos_slat*t_cos_slat;
+	f32 t2_sin_dlon = t_sin_dlon*t_sin_dlon;
+	f32 t2_cos_dlon = t_cos_dlon*t_cos_dlon;
+	
+	f32 sin_dlat = sin_hv_f32_coefficients[0];
+	f32 cos_dlat = sin_hv_f32_coefficients[0];
+	f32 sin_slat = sin_hv_f32_coefficients[0];
+	f32 cos_slat = sin_hv_f32_coefficients[0];
+	f32 sin_dlon = sin_hv_f32_coefficients[0];
+	f32 cos_dlon = sin_hv_f32_coefficients[0];
+	for (u32 index = 1; index < array_count(sin_hv_f32_coefficients); index += 1) {
+		f32 c = sin_hv_f32_coefficients[index];
+		sin_dlat = fmaf(sin_dlat, t2_sin_dlat, c);
+		cos_dlat = fmaf(cos_dlat, t2_cos_dlat, c);
+		sin_slat = fmaf(sin_slat, t2_sin_slat, c);
+		cos_slat = fmaf(cos_slat, t2_cos_slat, c);
+		sin_dlon = fmaf(sin_dlon, t2_sin_dlon, c);
+		cos_dlon = fmaf(cos_dlon, t2_cos_dlon, c);
+	}
+	sin_dlat *= t_sin_dlat;
+	cos_dlat *= t_cos_dlat;
+	sin_slat *= t_sin_slat;
+	cos_slat *= t_cos_slat;
+	sin_dlon *= t_sin_dlon;
+	cos_dlon *= t_cos_dlon;
+	
+	f32 sin2_dlon = sin_dlon*sin_dlon;
+	f32 cos2_dlon = cos_dlon*cos_dlon;
+	f32 a     = (sin_dlat*sin_dlat)*cos2_dlon + (cos_slat*cos_slat)*sin2_dlon;
+	f32 not_a = (cos_dlat*cos_dlat)*cos2_dlon + (sin_slat*sin_slat)*sin2_dlon;
+	
+	b32 reflect = a > not_a;
+	f32 u2 = reflect ? not_a : a;
+	f32 u  = sqrt_hv_f32(u2);
+	
+	f32 y = asin_hv_f32_coefficients[0];
+	for (u32 index = 1; index < array_count(asin_hv_f32_coefficients); index += 1) {
+		y = fmaf(y, u2, asin_hv_f32_coefficients[index]);
+	}
+	y *= u;
+	
+	if (reflect) y = HALF_PI32_HI + (HALF_PI32_LO - y);
+	
+	f32 result = r * 2.0f * y;
+	return result;
+}
+
+///////////////////////////
+// Wide fused haversine
+
+#if MATH_AVX2
+
+static __m256d haversine_hv_x4(__m256d x0, __m256d y0, __m256d x1, __m256d y1, __m256d r) {
+	__m256d sign_bit = _mm256_set1_pd(-0.0);
+	__m256d radians_per_degree = _mm256_set1_pd(0.01745329251994329577);
+	__m256d half_radians_per_degree = _mm256_set1_pd(0.01745329251994329577 / 2);
+	__m256d half_pi = _mm256_set1_pd(PI64/2);
+	
+	__m256d lat1 = _mm256_mul_pd(radians_per_degree, y0);
+	__m256d lat2 = _mm256_mul_pd(radians_per_degree, y1);
+	__m256d half_dlat = _mm256_mul_pd(half_radians_per_degree, _mm256_sub_pd(y1, y0));
+	__m256d half_dlon = _mm256_mul_pd(half_radians_per_degree, _mm256_sub_pd(x1, x0));
+	
+	__m256d t_dlat = half_dlat;
+	__m256d t_dlon = _mm256_andnot_pd(sign_bit, half_dlon);
+	t_dlon = _mm256_blendv_pd(t_dlon, _mm256_sub_pd(_mm256_set1_pd(PI64), t_dlon), _mm256_cmp_pd(t_dlon, half_pi, _CMP_GT_OQ));
+	__m256d t_lat1 = _mm256_sub_pd(half_pi, _mm256_andnot_pd(sign_bit, lat1));
+	__m256d t_lat2 = _mm256_sub_pd(half_pi, _mm256_andnot_pd(sign_bit, lat2));
+	
+	__m256d t2_dlat = _mm256_mul_pd(t_dlat, t_dlat);
+	__m256d t2_dlon = _mm256_mul_pd(t_dlon, t_dlon);
+	__m256d t2_lat1 = _mm256_mul_pd(t_lat1, t_lat1);
+	__m256d t2_lat2 = _mm256_mul_pd(t_lat2, t_lat2);
+	
+	__m256d sin_dlat = _mm256_set1_pd(sin_hv_coefficients[0]);
+	__m256d sin_dlon = sin_dlat;
+	__m256d cos_lat1 = sin_dlat;
+	__m256d cos_lat2 = sin_dlat;
+	for (u32 index = 1; index < array_count(sin_hv_coefficients); index += 1) {
+		__m256d c = _mm256_set1_pd(sin_hv_coefficients[index]);
+		sin_dlat = _mm256_fmadd_pd(sin_dlat, t2_dlat, c);
+		sin_dlon = _mm256_fmadd_pd(sin_dlon, t2_dlon, c);
+		cos_lat1 = _mm256_fmadd_pd(cos_lat1, t2_lat1, c);
+		cos_lat2 = _mm256_fmadd_pd(cos_lat2, t2_lat2, c);
+	}
+	sin_dlat = _mm256_mul_pd(sin_dlat, t_dlat);
+	sin_dlon = _mm256_mul_pd(sin_dlon, t_dlon);
+	cos_lat1 = _mm256_mul_pd(cos_lat1, t_lat1);
+	cos_lat2 = _mm256_mul_pd(cos_lat2, t_lat2);
+	
+	__m256d a = _mm256_add_pd(_mm256_mul_pd(sin_dlat, sin_dlat),
+							  _mm256_mul_pd(_mm256_mul_pd(cos_lat1, cos_lat2), _mm256_mul_pd(sin_dlon, sin_dlon)));
+	
+	__m256d reflect = _mm256_cmp_pd(a, _mm256_set1_pd(0.5), _CMP_GT_OQ);
+	__m256d u2 = _mm256_blendv_pd(a, _mm256_sub_pd(_mm256_set1_pd(1.0), a), reflect);
+	u2 = _mm256_max_pd(u2, _mm256_setzero_pd());
+	__m256d u = _mm256_sqrt_pd(u2);
+	
+	__m256d y = _mm256_set1_pd(asin_hv_coefficients[0]);
+	for (u32 index = 1; index < array_count(asin_hv_coefficients); index += 1) {
+		y = _mm256_fmadd_pd(y, u2, _mm256_set1_pd(asin_hv_coefficients[index]));
+	}
+	y = _mm256_mul_pd(y, u);
+	
+	y = _mm256_blendv_pd(y, _mm256_sub_pd(half_pi, y), reflect);
+	
+	__m256d result = _mm256_mul_pd(_mm256_mul_pd(r, _mm256_set1_pd(2.0)), y);
+	return result;
+}
+
+static __m256 haversine_hv_f32_x8(__m256 x0, __m256 y0, __m256 x1, __m256 y1, __m256 r) {
+	__m256 sign_bit = _mm256_set1_ps(-0.0f);
+	__m256 half_radians_per_degree = _mm256_set1_ps(0.01745329251994329577f / 2);
+	__m256 half_pi_hi = _mm256_set1_ps(HALF_PI32_HI);
+	__m256 half_pi_lo = _mm256_set1_ps(HALF_PI32_LO);
+	
+	__m256 half_dlat = _mm256_mul_ps(half_radians_per_degree, _mm256_sub_ps(y1, y0));
+	__m256 half_slat = _mm256_mul_ps(half_radians_per_degree, _mm256_add_ps(y1, y0));
+	__m256 half_dlon = _mm256_mul_ps(half_radians_per_degree, _mm256_sub_ps(x1, x0));
+	__m256 abs_dlon  = _mm256_andnot_ps(sign_bit, half_dlon);
+	
+	__m256 t_sin_dlat = half_dlat;
+	__m256 t_cos_dlat = _mm256_add_ps(_mm256_sub_ps(half_pi_hi, _mm256_andnot_ps(sign_bit, half_dlat)), half_pi_lo);
+	__m256 t_sin_slat = half_slat;
+	__m256 t_cos_slat = _mm256_add_ps(_mm256_sub_ps(half_pi_hi, _mm256_andnot_ps(sign_bit, half_slat)), half_pi_lo);
+	__m256 reflected_dlon = _mm256_add_ps(_mm256_sub_ps(_mm256_set1_ps(PI32_HI), abs_dlon), _mm256_set1_ps(PI32_LO));
+	__m256 t_sin_dlon = _mm256_blendv_ps(abs_dlon, reflected_dlon, _mm256_cmp_ps(abs_dlon, half_pi_hi, _CMP_GT_OQ));
+	__m256 t_cos_dlon = _mm256_add_ps(_mm256_sub_ps(half_pi_hi, abs_dlon), half_pi_lo);
+	
+	__m256 t2_sin_dlat = _mm256_mul_ps(t_sin_dlat, t_sin_dlat);
+	__m256 t2_cos_dlat = _mm256_mul_ps(t_cos_dlat, t_cos_dlat);
+	__m256 t2_sin_slat = _mm256_mul_ps(t_sin_slat, t_sin_slat);
+	__m256 t2_cos_slat = _mm256_mul_ps(t_cos_slat, t_cos_slat);
+	__m256 t2_sin_dlon = _mm256_mul_ps(t_sin_dlon, t_sin_dlon);
+	__m256 t2_cos_dlon = _mm256_mul_ps(t_cos_dlon, t_cos_dlon);
+	
+	__m256 sin_dlat = _mm256_set1_ps(sin_hv_f32_coefficients[0]);
+	__m256 cos_dlat = sin_dlat;
+	__m256 sin_slat = sin_dlat;
+	__m256 cos_slat = sin_dlat;
+	__m256 sin_dlon = sin_dlat;
+	__m256 cos_dlon = sin_dlat;
+	for (u32 index = 1; index < array_count(sin_hv_f32_coefficients); index += 1) {
+		__m256 c = _mm256_set1_ps(sin_hv_f32_coefficients[index]);
+		sin_dlat = _mm256_fmadd_ps(sin_dlat, t2_sin_dlat, c);
+		cos_dlat = _mm256_fmadd_ps(cos_dlat, t2_cos_dlat, c);
+		sin_slat = _mm256_fmadd_ps(sin_slat, t2_sin_slat, c);
+		cos_slat = _mm256_fmadd_ps(cos_slat, t2_cos_slat, c);
+		sin_dlon = _mm256_fmadd_ps(sin_dlon, t2_sin_dlon, c);
+		cos_dlon = _mm256_fmadd_ps(cos_dlon, t2_cos_dlon, c);
+	}
+	sin_dlat = _mm256_mul_ps(sin_dlat, t_sin_dlat);
+	cos_dlat = _mm256_mul_ps(cos_dlat, t_cos_dlat);
+	sin_slat = _mm256_mul_ps(sin_slat, t_sin_slat);
+	cos_slat = _mm256_mul_ps(cos_slat, t_cos_slat);
+	sin_dlon = _mm256_mul_ps(sin_dlon, t_sin_dlon);
+	cos_dlon = _mm256_mul_ps(cos_dlon, t_cos_dlon);
+	
+	__m256 sin2_dlon = _mm256_mul_ps(sin_dlon, sin_dlon);
+	__m256 cos2_dlon = _mm256_mul_ps(cos_dlon, cos_dlon);
+	__m256 a     = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(sin_dlat, sin_dlat), cos2_dlon),
+								 _mm256_mul_ps(_mm256_mul_ps(cos_slat, cos_slat), sin2_dlon));
+	__m256 not_a = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(cos_dlat, cos_dlat), cos2_dlon),
+								 _mm256_mul_ps(_mm256_mul_ps(sin_slat, sin_slat), sin2_dlon));
+	
+	__m256 reflect = _mm256_cmp_ps(a, not_a, _CMP_GT_OQ);
+	__m256 u2 = _mm256_blendv_ps(a, not_a, reflect);
+	__m256 u = _mm256_sqrt_ps(u2);
+	
+	__m256 y = _mm256_set1_ps(asin_hv_f32_coefficients[0]);
+	for (u32 index = 1; index < array_count(asin_hv_f32_coefficients); index += 1) {
+		y = _mm256_fmadd_ps(y, u2, _mm256_set1_ps(asin_hv_f32_coefficients[index]));
+	}
+	y = _mm256_mul_ps(y, u);
+	
+	y = _mm256_blendv_ps(y, _mm256_add_ps(half_pi_hi, _mm256_sub_ps(half_pi_lo, y)), reflect);
+	
+	__m256 result = _mm256_mul_ps(_mm256_mul_ps(r, _mm256_set1_ps(2.0f)), y);
+	return result;
+}
+
+#endif
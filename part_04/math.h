@@ -8,6 +8,7 @@
 #endif
 
 #define PI64 3.14159265358979323846264338327950288419716939937510582097494459230781640628
+#define PI32 3.14159265358979323846264338327950288419716939937510582097494459230781640628f
 #define ONE_OVER_SQRT2 0.707106781186547524400844362104849039284835937688474036588339868995366239231053519425193767163820786367506923115456148512462418027925368606322061
 
 static f64 square_f64(f64 x);
@@ -26,7 +27,22 @@ static f64 sin_taylor_horner(f64 x, u32 max_exp);
 static f64 sin_taylor_horner_fmadd(f64 x, u32 max_exp);
 static f64 sin_taylor_horner_fma(f64 x, u32 max_exp);
 
-static f64 odd_coefficients_table(f64 x, f64 *values, u32 count);
+// NOTE(ema): Evaluates values[0]*x + values[1]*x^3 + ... + values[Count - 1]*x^(2*Count - 1) as
+// one unrolled chain of FMAs. When only some precision is needed, let the error tables in
+// coefficients.inl pick the number of coefficients at compile time:
+//
+// constexpr u32 count = lowest_coefficient_count(SineRadiansC_MFTWP_MaxError, 1e-9);
+// f64 y = odd_coefficients_table<count>(x, SineRadiansC_MFTWP[count]);
+//
+// The version with a runtime count goes through a table of the unrolled ones.
+#define MAX_ODD_COEFFICIENT_COUNT 22
+
+template <u32 Count> static f64 odd_coefficients_table(f64 x, f64 const *values);
+static f64 odd_coefficients_table(f64 x, f64 const *values, u32 count);
+
+// Returns the lowest count whose max error is at most `max_error`, or the highest count there
+// is if none of them is good enough.
+template <u32 Table_Count> constexpr u32 lowest_coefficient_count(f64 const (&max_errors)[Table_Count], f64 max_error);
 
 static f64 sin_ce(f64 x);
 static f64 asin_ce(f64 x);
@@ -41,4 +57,47 @@ static f64 sin_hv(f64 x);
 static f64 cos_hv(f64 x);
 static f64 asin_hv(f64 x);
 
+// NOTE(ema): f32 versions, with coefficients from our Remez fits rounded to f32, and just enough
+// of them that the rounding of f32 dominates the error. They work on the same ranges, and
+// check_precision -f32 tries every f32 in them.
+static f32 sqrt_hv_f32(f32 x);
+static f32 sin_hv_f32(f32 x);
+static f32 cos_hv_f32(f32 x);
+static f32 asin_hv_f32(f32 x);
+
+// NOTE(ema): Great circle distance between (x0, y0) and (x1, y1), in degrees, with x in
+// [-180, 180] and y in [-90, 90]. Same formula as reference_haversine(), but with the *_hv
+// approximations inlined and simplified for those ranges.
+static f64 haversine_hv(f64 x0, f64 y0, f64 x1, f64 y1, f64 r);
+
+// NOTE(ema): The f32 version computes a and 1 - a without cancellation (see math.cpp), otherwise
+// it would be off by almost a km near antipodes.
+static f32 haversine_hv_f32(f32 x0, f32 y0, f32 x1, f32 y1, f32 r);
+
+// NOTE(ema): Wide versions of the functions above, with the same coefficients and the branches
+// turned into selects, so every lane gives the same result as the scalar function. MSVC lets us
+// use the intrinsics anywhere, other compilers need -mavx2 -mfma (and -mavx512f). Check
+// cpu_has_avx2() and cpu_has_avx512() before calling them.
+
+#if _MSC_VER || (__AVX2__ && __FMA__)
+#define MATH_AVX2 1
+
+static __m256d sqrt_hv_x4(__m256d x);
+static __m256d sin_hv_x4(__m256d x);
+static __m256d cos_hv_x4(__m256d x);
+static __m256d asin_hv_x4(__m256d x);
+
+static __m256d haversine_hv_x4(__m256d x0, __m256d y0, __m256d x1, __m256d y1, __m256d r);
+static __m256  haversine_hv_f32_x8(__m256 x0, __m256 y0, __m256 x1, __m256 y1, __m256 r);
+#endif
+
+#if _MSC_VER || __AVX512F__
+#define MATH_AVX512 1
+
+static __m512d sqrt_hv_x8(__m512d x);
+static __m512d sin_hv_x8(__m512d x);
+static __m512d cos_hv_x8(__m512d x);
+static __m512d asin_hv_x8(__m512d x);
+#endif
+
 #endif
@@ -34,7 +34,83 @@ static void test_against_hardcoded_values(char *name, Math_Func *func, u32 ref_c
 static void print_result(Math_Test result);
 static f64  compute_average_diff(Math_Test from);
 static void print_decimal_bars();
-static int  compare_tests_for_qsort(void *context, const void *a_index, const void *b_index);
+static int  compare_tests(Math_Tester *tester, u32 a_index, u32 b_index);
+static void sort_ranking(Math_Tester *tester, u32 *ranking, u32 count);
+
+// NOTE(ema): The distance between x and the next float of the given precision away from 0, with
+// the subnormal spacing below the smallest normal.
+static f64 get_ulp(f64 x, Float_Precision precision) {
+	int mantissa_bits = (precision == Precision_F32) ? 23 : 52;
+	int min_exponent  = (precision == Precision_F32) ? -125 : -1021;
+	
+	int exponent = min_exponent;
+	if (x != 0) {
+		frexp(x, &exponent);
+		if (exponent < min_exponent) exponent = min_exponent;
+	}
+	
+	f64 result = ldexp(1.0, exponent - 1 - mantissa_bits);
+	return result;
+}
+
+static u32 get_ulp_histogram_bucket(f64 ulp_diff) {
+	u32 result = ULP_HISTOGRAM_BUCKET_COUNT - 1;
+	if (ulp_diff < 0.5) {
+		result = 0;
+	} else if (ulp_diff < ldexp(1.0, ULP_HISTOGRAM_BUCKET_COUNT - 2)) {
+		// NOTE(ema): ulp_diff is in [2^(exponent-1), 2^exponent), exponent >= 0.
+		int exponent = 0;
+		frexp(ulp_diff, &exponent);
+		result = (u32)(exponent + 1);
+	}
+	return result;
+}
+
+static void update_test(Math_Test *test, f64 input, f64 expected, f64 output) {
+	f64 diff = fabs(expected - output);
+	test->total_diff += diff;
+	test->diff_count += 1;
+	if (test->max_diff < diff) {
+		test->max_diff = diff;
+		test->input_value_at_max_diff = input;
+		test->output_value_at_max_diff = output;
+		test->expected_value_at_max_diff = expected;
+	}
+	
+	f64 ulp_diff = diff / get_ulp(expected, test->precision);
+	test->total_ulp_diff += ulp_diff;
+	if (test->max_ulp_diff < ulp_diff) {
+		test->max_ulp_diff = ulp_diff;
+		test->input_value_at_max_ulp_diff = input;
+	}
+	test->ulp_histogram[get_ulp_histogram_bucket(ulp_diff)] += 1;
+	
+	if (diff != 0) {
+		f64 rel_diff = (expected != 0) ? diff / fabs(expected) : INFINITY;
+		if (test->max_rel_diff < rel_diff) {
+			test->max_rel_diff = rel_diff;
+		}
+	}
+}
+
+static void complete_tests(Math_Tester *tester, u32 test_count) {
+	tester->completed_test_count += test_count;
+	
+	// NOTE(ema): Log error
+	if (tester->completed_test_count > array_count(tester->tests)) {
+		tester->completed_test_count = array_count(tester->tests);
+		fprintf(stderr, "Out of room to store math test results.\n");
+	}
+	
+	// NOTE(ema): Print newly completed tests
+	if (tester->printed_test_count < tester->completed_test_count) {
+		print_decimal_bars();
+		while (tester->printed_test_count < tester->completed_test_count) {
+			print_result(tester->tests[tester->printed_test_count]);
+			tester->printed_test_count += 1;
+		}
+	}
+}
 
 // TODO(ema): I can't seem to find a decent name for this function, they're all confusing...
 static b32  try_start_precision_test(Math_Tester *tester, f64 min_input, f64 max_input, u32 step_count) {
@@ -53,22 +129,7 @@ static b32  try_start_precision_test(Math_Tester *tester, f64 min_input, f64 max
         tester->input_value = (1.0 - t_step)*min_input + t_step*max_input;
     } else {
         // NOTE(ema): We did all the steps, mark vacant tests as completed
-		tester->completed_test_count += tester->current_test_offset;
-        
-		// NOTE(ema): Log error
-		if (tester->completed_test_count > array_count(tester->tests)) {
-            tester->completed_test_count = array_count(tester->tests);
-            fprintf(stderr, "Out of room to store math test results.\n");
-        }
-        
-		// NOTE(ema): Print newly completed tests
-        if (tester->printed_test_count < tester->completed_test_count) {
-            print_decimal_bars();
-            while (tester->printed_test_count < tester->completed_test_count) {
-                print_result(tester->tests[tester->printed_test_count]);
-				tester->printed_test_count += 1;
-            }
-        }
+		complete_tests(tester, tester->current_test_offset);
         
         tester->testing = false;
     }
@@ -95,15 +156,7 @@ static void compare_outputs(Math_Tester *tester, f64 expected, f64 output, char
     }
     
 	// NOTE(ema): Update the test
-    f64 diff = fabs(expected - output);
-    test->total_diff += diff;
-    test->diff_count += 1;
-    if (test->max_diff < diff) {
-        test->max_diff = diff;
-        test->input_value_at_max_diff = tester->input_value;
-        test->output_value_at_max_diff = output;
-        test->expected_value_at_max_diff = expected;
-    }
+	update_test(test, tester->input_value, expected, output);
     
 	// NOTE(ema): Go to next test
     tester->current_test_offset += 1;
@@ -120,12 +173,12 @@ static void print_results(Math_Tester *tester) {
             ranking[test_index] = test_index;
         }
         
-        qsort_s(ranking, tester->completed_test_count, sizeof(ranking[0]), compare_tests_for_qsort, tester);
+        sort_ranking(tester, ranking, tester->completed_test_count);
         
         for (u32 test_index = 0; test_index < tester->completed_test_count; test_index += 1) {
 			Math_Test test = tester->tests[ranking[test_index]];
             
-            printf("%+.24f (%+.24f) [%s", test.max_diff, compute_average_diff(test), test.label);
+            printf("%+.24f (%+.24f) %10.2f ulp [%s", test.max_diff, compute_average_diff(test), test.max_ulp_diff, test.label);
             while ((test_index + 1) < tester->completed_test_count) {
 				Math_Test next_test = tester->tests[ranking[test_index + 1]];
                 if (next_test.max_diff   == test.max_diff &&
@@ -143,6 +196,54 @@ static void print_results(Math_Tester *tester) {
 
 static void print_result(Math_Test test) {
     printf("%+.24f (%+.24f) at %+.24f [%s] \n", test.max_diff, compute_average_diff(test), test.input_value_at_max_diff, test.label);
+    printf("    %.2f ulp (%.3f) at %+.24f, %.3e relative\n", test.max_ulp_diff,
+           test.diff_count ? test.total_ulp_diff / (f64)test.diff_count : 0, test.input_value_at_max_ulp_diff, test.max_rel_diff);
+}
+
+static void print_ulp_histogram(Math_Test *test) {
+	printf("\n%s, error in ulps over %llu inputs:\n", test->label, (unsigned long long)test->diff_count);
+	for (u32 bucket = 0; bucket < ULP_HISTOGRAM_BUCKET_COUNT; bucket += 1) {
+		u64 count = test->ulp_histogram[bucket];
+		if (count) {
+			char range[32];
+			if (bucket == 0) {
+				snprintf(range, sizeof(range), "[0, 0.5)");
+			} else if (bucket == 1) {
+				snprintf(range, sizeof(range), "[0.5, 1)");
+			} else if (bucket < ULP_HISTOGRAM_BUCKET_COUNT - 1) {
+				snprintf(range, sizeof(range), "[%u, %u)", 1u << (bucket - 2), 1u << (bucket - 1));
+			} else {
+				snprintf(range, sizeof(range), ">= %u", 1u << (bucket - 2));
+			}
+			
+			f64 percent = 100.0*(f64)count / (f64)test->diff_count;
+			printf("  %-24s %12llu %8.4f%% ", range, (unsigned long long)count, percent);
+			
+			u32 bar_length = (u32)(percent / 2.0 + 0.5);
+			if (bar_length == 0) bar_length = 1;
+			for (u32 index = 0; index < bar_length; index += 1) {
+				printf("#");
+			}
+			printf("\n");
+		}
+	}
+}
+
+static b32 check_last_test(Math_Tester *tester, f64 max_diff, f64 max_ulp_diff) {
+	b32 result = true;
+	if (tester->completed_test_count > 0) {
+		Math_Test *test = &tester->tests[tester->completed_test_count - 1];
+		// NOTE(ema): Written so that NaNs fail too.
+		if (!(test->max_diff <= max_diff)) {
+			fprintf(stderr, "%s is off by %.3e at %.17g, the bound is %.3e\n", test->label, test->max_diff, test->input_value_at_max_diff, max_diff);
+			result = false;
+		}
+		if (!(test->max_ulp_diff <= max_ulp_diff)) {
+			fprintf(stderr, "%s is off by %.2f ulp at %.17g, the bound is %.2f ulp\n", test->label, test->max_ulp_diff, test->input_value_at_max_ulp_diff, max_ulp_diff);
+			result = false;
+		}
+	}
+	return result;
 }
 
 static f64 compute_average_diff(Math_Test from) {
@@ -154,11 +255,9 @@ static void print_decimal_bars() {
     printf("   ________________             ________________\n");
 }
 
-static int compare_tests_for_qsort(void *context, const void *a_index, const void *b_index) {
-	Math_Tester *tester = (Math_Tester *)context;
-    
-	Math_Test *a = tester->tests + (*(u32 *)a_index);
-	Math_Test *b = tester->tests + (*(u32 *)b_index);
+static int compare_tests(Math_Tester *tester, u32 a_index, u32 b_index) {
+	Math_Test *a = tester->tests + a_index;
+	Math_Test *b = tester->tests + b_index;
     
     int result = 0;
     if        (a->max_diff   > b->max_diff) {
@@ -173,3 +272,281 @@ static int compare_tests_for_qsort(void *context, const void *a_index, const voi
     
     return result;
 }
+
+// NOTE(ema): Bottom-up merge sort, instead of qsort_s which only MSVC has (and glibc's qsort_r
+// takes the arguments in another order). It's stable, so tests with the same errors stay in the
+// order they ran on every platform, which keeps the grouped labels of print_results the same.
+static void sort_ranking(Math_Tester *tester, u32 *ranking, u32 count) {
+	u32 scratch[array_count(tester->tests)];
+	
+	u32 *from = ranking;
+	u32 *to = scratch;
+	for (u32 width = 1; width < count; width *= 2) {
+		for (u32 first = 0; first < count; first += 2*width) {
+			u32 middle = (first + width < count)   ? first + width   : count;
+			u32 last   = (first + 2*width < count) ? first + 2*width : count;
+			
+			u32 a = first;
+			u32 b = middle;
+			for (u32 index = first; index < last; index += 1) {
+				if (a < middle && (b >= last || compare_tests(tester, from[a], from[b]) <= 0)) {
+					to[index] = from[a];
+					a += 1;
+				} else {
+					to[index] = from[b];
+					b += 1;
+				}
+			}
+		}
+		
+		u32 *swap = from;
+		from = to;
+		to = swap;
+	}
+	
+	if (from != ranking) {
+		memcpy(ranking, from, count*sizeof(ranking[0]));
+	}
+}
+
+///////////////////////////
+// Batched sweeps
+
+static Math_Sweep make_sweep(Math_Func *reference, f64 min_input, f64 max_input, u64 step_count) {
+	Math_Sweep sweep = {};
+	sweep.reference  = reference;
+	sweep.inputs     = Sweep_Steps;
+	sweep.min_input  = min_input;
+	sweep.max_input  = max_input;
+	sweep.step_count = step_count;
+	
+	return sweep;
+}
+
+// NOTE(ema): Maps f32 bit patterns to integers in the same order as the floats, so that
+// consecutive floats get consecutive keys (-0 and +0 included).
+static u32 get_f32_order_key(f32 x) {
+	u32 bits = 0;
+	memcpy(&bits, &x, sizeof(bits));
+	u32 result = (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+	return result;
+}
+
+static f32 get_f32_from_order_key(u32 key) {
+	u32 bits = (key & 0x80000000) ? (key & 0x7fffffff) : ~key;
+	f32 result = 0;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+static Math_Sweep make_float32_sweep(Math_Func *reference, f32 min_input, f32 max_input) {
+	Math_Sweep sweep = {};
+	sweep.reference = reference;
+	sweep.inputs    = Sweep_Float32;
+	sweep.min_input = min_input;
+	sweep.max_input = max_input;
+	
+	if (min_input <= max_input) {
+		sweep.step_count = (u64)get_f32_order_key(max_input) - (u64)get_f32_order_key(min_input) + 1;
+	}
+	
+	return sweep;
+}
+
+static Sweep_Candidate *push_candidate(Math_Sweep *sweep, char const *format, va_list args) {
+	Sweep_Candidate *result = 0;
+	if (sweep->candidate_count < array_count(sweep->candidates)) {
+		result = &sweep->candidates[sweep->candidate_count];
+		sweep->candidate_count += 1;
+		
+		*result = {};
+		vsnprintf(result->label, sizeof(result->label), format, args);
+	} else {
+		fprintf(stderr, "Out of room to store sweep candidates.\n");
+	}
+	
+	return result;
+}
+
+static void add_candidate(Math_Sweep *sweep, Math_Func *func, char const *format, ...) {
+	va_list args;
+	va_start(args, format);
+	Sweep_Candidate *candidate = push_candidate(sweep, format, args);
+	va_end(args);
+	
+	if (candidate) {
+		candidate->func = func;
+	}
+}
+
+static void add_candidate(Math_Sweep *sweep, Math_Func_F32 *func, char const *format, ...) {
+	va_list args;
+	va_start(args, format);
+	Sweep_Candidate *candidate = push_candidate(sweep, format, args);
+	va_end(args);
+	
+	if (candidate) {
+		candidate->func_f32 = func;
+		candidate->precision = Precision_F32;
+	}
+}
+
+static void add_candidate(Math_Sweep *sweep, Math_Func_With_Arg *func, u32 arg, char const *format, ...) {
+	va_list args;
+	va_start(args, format);
+	Sweep_Candidate *candidate = push_candidate(sweep, format, args);
+	va_end(args);
+	
+	if (candidate) {
+		candidate->func_with_arg = func;
+		candidate->arg = arg;
+	}
+}
+
+static void add_candidate(Math_Sweep *sweep, Math_Batch_Func *func, void *param, char const *format, ...) {
+	va_list args;
+	va_start(args, format);
+	Sweep_Candidate *candidate = push_candidate(sweep, format, args);
+	va_end(args);
+	
+	if (candidate) {
+		candidate->batch_func = func;
+		candidate->param = param;
+	}
+}
+
+struct Sweep_Context {
+	Math_Sweep *sweep;
+	Math_Test *thread_results; // candidate_count for every thread
+	
+	volatile u64 next_block;
+	volatile u32 next_thread;
+};
+
+static void eval_candidate(Sweep_Candidate *candidate, f64 *inputs, f64 *outputs, u32 count) {
+	if (candidate->func) {
+		for (u32 index = 0; index < count; index += 1) {
+			outputs[index] = candidate->func(inputs[index]);
+		}
+	} else if (candidate->func_f32) {
+		for (u32 index = 0; index < count; index += 1) {
+			outputs[index] = (f64)candidate->func_f32((f32)inputs[index]);
+		}
+	} else if (candidate->func_with_arg) {
+		for (u32 index = 0; index < count; index += 1) {
+			outputs[index] = candidate->func_with_arg(inputs[index], candidate->arg);
+		}
+	} else if (candidate->batch_func) {
+		candidate->batch_func(inputs, outputs, count, candidate->param);
+	}
+}
+
+static void run_sweep_thread(void *param) {
+	Sweep_Context *context = (Sweep_Context *)param;
+	Math_Sweep *sweep = context->sweep;
+	
+	u32 thread_index = atomic_add_u32(&context->next_thread, 1);
+	Math_Test *results = context->thread_results + (u64)thread_index*sweep->candidate_count;
+	for (u32 candidate_index = 0; candidate_index < sweep->candidate_count; candidate_index += 1) {
+		results[candidate_index].precision = sweep->candidates[candidate_index].precision;
+	}
+	
+	f64 inputs[SWEEP_BLOCK_SIZE];
+	f64 expected[SWEEP_BLOCK_SIZE];
+	f64 outputs[SWEEP_BLOCK_SIZE];
+	
+	u32 min_key = 0;
+	if (sweep->inputs == Sweep_Float32) {
+		min_key = get_f32_order_key((f32)sweep->min_input);
+	}
+	
+	u64 block_count = (sweep->step_count + SWEEP_BLOCK_SIZE - 1) / SWEEP_BLOCK_SIZE;
+	for (;;) {
+		u64 block_index = atomic_add_u64(&context->next_block, 1);
+		if (block_index >= block_count) break;
+		
+		u64 first_step = block_index*SWEEP_BLOCK_SIZE;
+		u32 count = SWEEP_BLOCK_SIZE;
+		if (first_step + count > sweep->step_count) {
+			count = (u32)(sweep->step_count - first_step);
+		}
+		
+		for (u32 index = 0; index < count; index += 1) {
+			u64 step_index = first_step + index;
+			if (sweep->inputs == Sweep_Float32) {
+				inputs[index] = get_f32_from_order_key((u32)(min_key + step_index));
+			} else {
+				f64 t_step = (sweep->step_count > 1) ? (f64)step_index / (f64)(sweep->step_count - 1) : 0;
+				inputs[index] = (1.0 - t_step)*sweep->min_input + t_step*sweep->max_input;
+			}
+			expected[index] = sweep->reference(inputs[index]);
+		}
+		
+		for (u32 candidate_index = 0; candidate_index < sweep->candidate_count; candidate_index += 1) {
+			eval_candidate(&sweep->candidates[candidate_index], inputs, outputs, count);
+			
+			Math_Test *test = &results[candidate_index];
+			for (u32 index = 0; index < count; index += 1) {
+				update_test(test, inputs[index], expected[index], outputs[index]);
+			}
+		}
+	}
+}
+
+static void run_sweep(Math_Tester *tester, Math_Sweep *sweep) {
+	u32 thread_count = sweep->thread_count ? sweep->thread_count : get_processor_count();
+	
+	Sweep_Context context = {};
+	context.sweep = sweep;
+	context.thread_results = (Math_Test *)calloc((u64)thread_count*sweep->candidate_count + 1, sizeof(Math_Test));
+	
+	if (context.thread_results) {
+		run_on_threads(thread_count, run_sweep_thread, &context);
+		
+		// NOTE(ema): Reduce the results of the threads. Ties on the max go to the lowest input, so
+		// that the reported input doesn't depend on the scheduling.
+		for (u32 candidate_index = 0; candidate_index < sweep->candidate_count; candidate_index += 1) {
+			Math_Test *test = &tester->error_test;
+			u32 test_index = tester->completed_test_count + candidate_index;
+			if (test_index < array_count(tester->tests)) {
+				test = &tester->tests[test_index];
+			}
+			
+			*test = {};
+			test->precision = sweep->candidates[candidate_index].precision;
+			memcpy(test->label, sweep->candidates[candidate_index].label, sizeof(test->label));
+			
+			for (u32 thread_index = 0; thread_index < thread_count; thread_index += 1) {
+				Math_Test *result = &context.thread_results[(u64)thread_index*sweep->candidate_count + candidate_index];
+				
+				test->total_diff += result->total_diff;
+				test->diff_count += result->diff_count;
+				if (test->max_diff < result->max_diff ||
+					(test->max_diff == result->max_diff && result->diff_count && result->input_value_at_max_diff < test->input_value_at_max_diff)) {
+					test->max_diff = result->max_diff;
+					test->input_value_at_max_diff = result->input_value_at_max_diff;
+					test->output_value_at_max_diff = result->output_value_at_max_diff;
+					test->expected_value_at_max_diff = result->expected_value_at_max_diff;
+				}
+				
+				test->total_ulp_diff += result->total_ulp_diff;
+				if (test->max_ulp_diff < result->max_ulp_diff ||
+					(test->max_ulp_diff == result->max_ulp_diff && result->diff_count && result->input_value_at_max_ulp_diff < test->input_value_at_max_ulp_diff)) {
+					test->max_ulp_diff = result->max_ulp_diff;
+					test->input_value_at_max_ulp_diff = result->input_value_at_max_ulp_diff;
+				}
+				if (test->max_rel_diff < result->max_rel_diff) {
+					test->max_rel_diff = result->max_rel_diff;
+				}
+				for (u32 bucket = 0; bucket < ULP_HISTOGRAM_BUCKET_COUNT; bucket += 1) {
+					test->ulp_histogram[bucket] += result->ulp_histogram[bucket];
+				}
+			}
+		}
+		
+		free(context.thread_results);
+		complete_tests(tester, sweep->candidate_count);
+	} else {
+		fprintf(stderr, "Out of memory for the sweep.\n");
+	}
+}
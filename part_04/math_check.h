@@ -15,15 +15,32 @@ static void test_against_hardcoded_values(char *name, Math_Func *func, u32 ref_c
 ///////////////////////////
 // Tests against reference implementation
 
+// NOTE(ema): Bucket 0 counts the outputs within half an ulp (correctly rounded), bucket 1 the ones
+// within [0.5, 1) ulp, and bucket n the ones within [2^(n-2), 2^(n-1)) ulp. The last bucket also
+// takes everything bigger, and NaNs.
+#define ULP_HISTOGRAM_BUCKET_COUNT 32
+
+enum Float_Precision : u32 {
+	Precision_F64, // Outputs are compared in ulps of an f64
+	Precision_F32, // Outputs are compared in ulps of an f32
+};
+
 struct Math_Test {
     f64 max_diff;
     f64 total_diff;
-    u32 diff_count;
+    u64 diff_count;
     
     f64 input_value_at_max_diff;
     f64 output_value_at_max_diff;
     f64 expected_value_at_max_diff;
     
+    f64 max_ulp_diff; // In ulps of the expected value
+    f64 total_ulp_diff;
+    f64 input_value_at_max_ulp_diff;
+    f64 max_rel_diff; // diff/|expected|, infinite if expected is 0 and the output isn't
+    u64 ulp_histogram[ULP_HISTOGRAM_BUCKET_COUNT];
+    
+    Float_Precision precision;
     char label[64];
 };
 
@@ -44,6 +61,11 @@ struct Math_Tester {
 static b32  try_start_precision_test(Math_Tester *tester, f64 min_input, f64 max_input, u32 step_count = 1000000);
 static void compare_outputs(Math_Tester *tester, f64 expected, f64 output, char const *format, ...);
 static void print_results(Math_Tester *tester);
+static void print_ulp_histogram(Math_Test *test);
+
+// Checks the test that was completed last against the bounds, and complains on stderr if it is
+// off. Returns whether it was within them.
+static b32  check_last_test(Math_Tester *tester, f64 max_diff, f64 max_ulp_diff = DBL_MAX);
 
 // NOTE(ema): Example:
 //
@@ -60,4 +82,73 @@ static void print_results(Math_Tester *tester);
 //     compare_outputs(tester, tan(tester.input_value), my_tan(tester.input_value), "my_tan");
 // }
 
+///////////////////////////
+// Batched sweeps
+
+// NOTE(ema): Same results as the loop above, but the inputs are split in blocks that worker threads
+// take in turns. Every candidate is evaluated over a whole block at once, the errors are kept per
+// thread and only summed at the end, and the labels are formatted once when the candidates are
+// added. The candidates must be safe to call from several threads at once.
+
+typedef f32  Math_Func_F32(f32 x);
+typedef f64  Math_Func_With_Arg(f64 x, u32 arg);
+typedef void Math_Batch_Func(f64 *inputs, f64 *outputs, u32 count, void *param);
+
+struct Sweep_Candidate {
+	// NOTE(ema): Only one of these is set.
+	Math_Func *func;
+	Math_Func_F32 *func_f32;
+	Math_Func_With_Arg *func_with_arg;
+	Math_Batch_Func *batch_func;
+	
+	u32 arg;
+	void *param;
+	Float_Precision precision; // Precision_F32 for func_f32
+	
+	char label[64];
+};
+
+enum Sweep_Inputs : u32 {
+	Sweep_Steps,   // step_count inputs evenly spaced over [min_input, max_input]
+	Sweep_Float32, // Every f32 in [min_input, max_input], both zeros included
+};
+
+#define SWEEP_BLOCK_SIZE 4096
+#define MAX_SWEEP_CANDIDATES 128
+
+struct Math_Sweep {
+	Math_Func *reference;
+	Sweep_Candidate candidates[MAX_SWEEP_CANDIDATES];
+	u32 candidate_count;
+	
+	Sweep_Inputs inputs;
+	f64 min_input, max_input;
+	u64 step_count;   // Computed for Sweep_Float32
+	u32 thread_count; // 0 for one per processor
+};
+
+static Math_Sweep make_sweep(Math_Func *reference, f64 min_input, f64 max_input, u64 step_count = 100000000);
+static Math_Sweep make_float32_sweep(Math_Func *reference, f32 min_input, f32 max_input);
+
+static void add_candidate(Math_Sweep *sweep, Math_Func *func, char const *format, ...);
+static void add_candidate(Math_Sweep *sweep, Math_Func_F32 *func, char const *format, ...);
+static void add_candidate(Math_Sweep *sweep, Math_Func_With_Arg *func, u32 arg, char const *format, ...);
+static void add_candidate(Math_Sweep *sweep, Math_Batch_Func *func, void *param, char const *format, ...);
+
+// Stores one completed test per candidate in the tester, in the order they were added.
+static void run_sweep(Math_Tester *tester, Math_Sweep *sweep);
+
+// NOTE(ema): Example:
+//
+// Math_Sweep sweep = make_sweep(sin, -Pi, Pi);
+// for (u32 exp = 3; exp < 31; exp += 2) {
+//     add_candidate(&sweep, sin_taylor_horner, exp, "sin_taylor_horner(%u)", exp);
+// }
+// run_sweep(&tester, &sweep);
+//
+// Math_Sweep sweep = make_float32_sweep(sin, -Pi32, Pi32);
+// add_candidate(&sweep, my_sin_f32, "my_sin_f32");
+// run_sweep(&tester, &sweep);
+// check_last_test(&tester, 1e-6, 2.5); // Fails if any f32 in the range is more than 2.5 ulp off
+
 #endif
@@ -0,0 +1,346 @@
+///////////////////////////
+// Double-double
+
+static DD dd_from_f64(f64 x) {
+	DD result = {x, 0};
+	return result;
+}
+
+static DD quick_two_sum(f64 a, f64 b) {
+	// NOTE(ema): Exact if |a| >= |b|.
+	DD result = {};
+	result.hi = a + b;
+	result.lo = b - (result.hi - a);
+	return result;
+}
+
+static DD two_sum(f64 a, f64 b) {
+	DD result = {};
+	result.hi = a + b;
+	f64 b_virtual = result.hi - a;
+	result.lo = (a - (result.hi - b_virtual)) + (b - b_virtual);
+	return result;
+}
+
+static DD add_dd(DD a, DD b) {
+	DD s = two_sum(a.hi, b.hi);
+	DD t = two_sum(a.lo, b.lo);
+	s.lo += t.hi;
+	s = quick_two_sum(s.hi, s.lo);
+	s.lo += t.lo;
+	
+	DD result = quick_two_sum(s.hi, s.lo);
+	return result;
+}
+
+static DD sub_dd(DD a, DD b) {
+	DD minus_b = {-b.hi, -b.lo};
+	DD result = add_dd(a, minus_b);
+	return result;
+}
+
+static DD mul_dd(DD a, DD b) {
+	f64 p = a.hi * b.hi;
+	f64 e = fma(a.hi, b.hi, -p);
+	e += a.hi*b.lo + a.lo*b.hi;
+	
+	DD result = quick_two_sum(p, e);
+	return result;
+}
+
+static DD div_dd(DD a, DD b) {
+	// NOTE(ema): Long division, one f64 digit at a time.
+	f64 q1 = a.hi / b.hi;
+	DD r = sub_dd(a, mul_dd(dd_from_f64(q1), b));
+	f64 q2 = r.hi / b.hi;
+	r = sub_dd(r, mul_dd(dd_from_f64(q2), b));
+	f64 q3 = r.hi / b.hi;
+	
+	DD result = add_dd(quick_two_sum(q1, q2), dd_from_f64(q3));
+	return result;
+}
+
+static DD sin_dd(DD x) {
+	DD x2 = mul_dd(x, x);
+	DD term = x;
+	DD sum = x;
+	for (u32 exp = 3; exp < 64; exp += 2) {
+		term = div_dd(mul_dd(term, x2), dd_from_f64(-(f64)(exp - 1)*(f64)exp));
+		sum = add_dd(sum, term);
+		
+		if (fabs(term.hi) < 1e-36 * fabs(sum.hi)) break;
+	}
+	
+	return sum;
+}
+
+static DD cos_dd(DD x) {
+	DD x2 = mul_dd(x, x);
+	DD term = dd_from_f64(1);
+	DD sum = term;
+	for (u32 exp = 2; exp < 64; exp += 2) {
+		term = div_dd(mul_dd(term, x2), dd_from_f64(-(f64)(exp - 1)*(f64)exp));
+		sum = add_dd(sum, term);
+		
+		if (fabs(term.hi) < 1e-36 * fabs(sum.hi)) break;
+	}
+	
+	return sum;
+}
+
+static DD asin_dd(DD x) {
+	// NOTE(ema): asin() is good to about an ulp already, every step doubles the correct bits.
+	DD y = dd_from_f64(asin(x.hi));
+	for (u32 step = 0; step < 2; step += 1) {
+		DD correction = div_dd(sub_dd(sin_dd(y), x), cos_dd(y));
+		y = sub_dd(y, correction);
+	}
+	
+	return y;
+}
+
+///////////////////////////
+// Remez exchange
+
+static DD get_basis_value(DD x, u32 index, Polynomial_Parity parity) {
+	// NOTE(ema): x^(2*index + 1) for odd polynomials, x^(2*index) for even ones.
+	DD x2 = mul_dd(x, x);
+	DD result = (parity == Parity_Odd) ? x : dd_from_f64(1);
+	for (u32 power = 0; power < index; power += 1) {
+		result = mul_dd(result, x2);
+	}
+	
+	return result;
+}
+
+static DD eval_polynomial_dd(DD *coefficients, u32 count, Polynomial_Parity parity, DD x) {
+	DD x2 = mul_dd(x, x);
+	
+	DD y = coefficients[count - 1];
+	for (u32 index = count - 1; index != 0; index -= 1) {
+		y = add_dd(mul_dd(y, x2), coefficients[index - 1]);
+	}
+	if (parity == Parity_Odd) y = mul_dd(y, x);
+	
+	return y;
+}
+
+static f64 get_fit_error(DD_Func *func, DD *coefficients, u32 count, Polynomial_Parity parity, f64 x) {
+	DD dd_x = dd_from_f64(x);
+	DD error = sub_dd(func(dd_x), eval_polynomial_dd(coefficients, count, parity, dd_x));
+	
+	f64 result = error.hi + error.lo;
+	return result;
+}
+
+static b32 solve_linear_system(DD *matrix, DD *rhs, DD *solution, u32 n) {
+	// NOTE(ema): Gaussian elimination with partial pivoting, matrix is n*n and row-major.
+	// Both matrix and rhs are destroyed.
+	b32 ok = true;
+	
+	for (u32 col = 0; ok && col < n; col += 1) {
+		u32 pivot = col;
+		for (u32 row = col + 1; row < n; row += 1) {
+			if (fabs(matrix[row*n + col].hi) > fabs(matrix[pivot*n + col].hi)) pivot = row;
+		}
+		
+		if (matrix[pivot*n + col].hi == 0) {
+			ok = false;
+			break;
+		}
+		
+		if (pivot != col) {
+			for (u32 k = 0; k < n; k += 1) {
+				DD temp = matrix[col*n + k];
+				matrix[col*n + k] = matrix[pivot*n + k];
+				matrix[pivot*n + k] = temp;
+			}
+			DD temp = rhs[col];
+			rhs[col] = rhs[pivot];
+			rhs[pivot] = temp;
+		}
+		
+		for (u32 row = col + 1; row < n; row += 1) {
+			DD factor = div_dd(matrix[row*n + col], matrix[col*n + col]);
+			for (u32 k = col; k < n; k += 1) {
+				matrix[row*n + k] = sub_dd(matrix[row*n + k], mul_dd(factor, matrix[col*n + k]));
+			}
+			rhs[row] = sub_dd(rhs[row], mul_dd(factor, rhs[col]));
+		}
+	}
+	
+	for (u32 col = n; ok && col-- > 0;) {
+		DD sum = rhs[col];
+		for (u32 k = col + 1; k < n; k += 1) {
+			sum = sub_dd(sum, mul_dd(matrix[col*n + k], solution[k]));
+		}
+		solution[col] = div_dd(sum, matrix[col*n + col]);
+	}
+	
+	return ok;
+}
+
+static f64 refine_extremum(DD_Func *func, DD *coefficients, u32 count, Polynomial_Parity parity, f64 lo, f64 hi) {
+	// NOTE(ema): Golden section search for the max of |error| between two grid points.
+	f64 ratio = 0.6180339887498949;
+	f64 a = hi - ratio*(hi - lo);
+	f64 b = lo + ratio*(hi - lo);
+	f64 error_a = fabs(get_fit_error(func, coefficients, count, parity, a));
+	f64 error_b = fabs(get_fit_error(func, coefficients, count, parity, b));
+	for (u32 step = 0; step < 48 && a < b; step += 1) {
+		if (error_a > error_b) {
+			hi = b;
+			b = a;
+			error_b = error_a;
+			a = hi - ratio*(hi - lo);
+			error_a = fabs(get_fit_error(func, coefficients, count, parity, a));
+		} else {
+			lo = a;
+			a = b;
+			error_a = error_b;
+			b = lo + ratio*(hi - lo);
+			error_b = fabs(get_fit_error(func, coefficients, count, parity, b));
+		}
+	}
+	
+	f64 result = (error_a > error_b) ? a : b;
+	return result;
+}
+
+static Remez_Fit fit_minimax(DD_Func *func, f64 min, f64 max, u32 count, Polynomial_Parity parity) {
+	Remez_Fit fit = {};
+	fit.count  = count;
+	fit.parity = parity;
+	fit.min    = min;
+	fit.max    = max;
+	
+	assert(count > 0 && count < MAX_REMEZ_COEFFICIENT_COUNT);
+	u32 n = count + 1; // The unknowns are the coefficients plus the levelled error
+	
+	// NOTE(ema): Start from the extrema of a Chebyshev polynomial. An odd polynomial on [0, max]
+	// is always exact at 0, so that point is moved away from it.
+	f64 points[MAX_REMEZ_COEFFICIENT_COUNT + 1] = {};
+	for (u32 point_index = 0; point_index < n; point_index += 1) {
+		f64 t = 0.5 - 0.5*cos(PI64*(f64)point_index/(f64)(n - 1));
+		points[point_index] = min + t*(max - min);
+	}
+	if (parity == Parity_Odd && min == 0) {
+		points[0] = 0.5*points[1];
+	}
+	
+	DD coefficients[MAX_REMEZ_COEFFICIENT_COUNT] = {};
+	DD matrix[(MAX_REMEZ_COEFFICIENT_COUNT + 1)*(MAX_REMEZ_COEFFICIENT_COUNT + 1)];
+	DD rhs[MAX_REMEZ_COEFFICIENT_COUNT + 1];
+	DD solution[MAX_REMEZ_COEFFICIENT_COUNT + 1];
+	
+	u32 grid_count = 256*n;
+	for (u32 iteration = 0; iteration < 64; iteration += 1) {
+		fit.iteration_count = iteration + 1;
+		
+		// NOTE(ema): Solve p(x_i) + (-1)^i E = f(x_i) for the coefficients and E.
+		for (u32 row = 0; row < n; row += 1) {
+			DD x = dd_from_f64(points[row]);
+			for (u32 col = 0; col < count; col += 1) {
+				matrix[row*n + col] = get_basis_value(x, col, parity);
+			}
+			matrix[row*n + count] = dd_from_f64((row % 2) ? -1.0 : 1.0);
+			rhs[row] = func(x);
+		}
+		
+		if (!solve_linear_system(matrix, rhs, solution, n)) break;
+		
+		for (u32 index = 0; index < count; index += 1) {
+			coefficients[index] = solution[index];
+		}
+		fit.levelled_error = fabs(solution[count].hi);
+		
+		// NOTE(ema): Find the new reference: one extremum of the error for every run of samples
+		// with the same sign.
+		f64 new_points[4*MAX_REMEZ_COEFFICIENT_COUNT];
+		f64 new_errors[4*MAX_REMEZ_COEFFICIENT_COUNT];
+		u32 new_count = 0;
+		
+		for (u32 grid_index = 0; grid_index <= grid_count; grid_index += 1) {
+			f64 t = (f64)grid_index / (f64)grid_count;
+			f64 x = (grid_index == grid_count) ? max : min + t*(max - min);
+			f64 error = get_fit_error(func, coefficients, count, parity, x);
+			
+			if (error != 0) {
+				b32 same_run = new_count > 0 && ((error > 0) == (new_errors[new_count - 1] > 0));
+				if (!same_run) {
+					if (new_count == array_count(new_points)) break;
+					new_points[new_count] = x;
+					new_errors[new_count] = error;
+					new_count += 1;
+				} else if (fabs(error) > fabs(new_errors[new_count - 1])) {
+					new_points[new_count - 1] = x;
+					new_errors[new_count - 1] = error;
+				}
+			}
+		}
+		
+		// NOTE(ema): The grid only brackets every extremum, polish them between the neighbours.
+		f64 step = (max - min) / (f64)grid_count;
+		for (u32 point_index = 0; point_index < new_count; point_index += 1) {
+			f64 lo = new_points[point_index] - step;
+			f64 hi = new_points[point_index] + step;
+			if (lo < min) lo = min;
+			if (hi > max) hi = max;
+			
+			f64 x = refine_extremum(func, coefficients, count, parity, lo, hi);
+			f64 error = get_fit_error(func, coefficients, count, parity, x);
+			if (fabs(error) > fabs(new_errors[point_index]) && (error > 0) == (new_errors[point_index] > 0)) {
+				new_points[point_index] = x;
+				new_errors[point_index] = error;
+			}
+		}
+		
+		// NOTE(ema): Too few alternations means the system was too ill-conditioned to get this far,
+		// keep what we have. Too many are trimmed from the ends, which keeps them alternating.
+		if (new_count < n) break;
+		
+		u32 first = 0;
+		while (new_count - first > n) {
+			if (fabs(new_errors[first]) < fabs(new_errors[new_count - 1])) {
+				first += 1;
+			} else {
+				new_count -= 1;
+			}
+		}
+		
+		f64 min_error = DBL_MAX;
+		f64 max_error = 0;
+		for (u32 point_index = 0; point_index < n; point_index += 1) {
+			points[point_index] = new_points[first + point_index];
+			
+			f64 error = fabs(new_errors[first + point_index]);
+			if (min_error > error) min_error = error;
+			if (max_error < error) max_error = error;
+		}
+		
+		// NOTE(ema): Once all the extrema are the same size the polynomial is the minimax one.
+		if (max_error - min_error <= 1e-6*max_error) {
+			fit.converged = true;
+			fit.levelled_error = max_error;
+			break;
+		}
+	}
+	
+	for (u32 index = 0; index < count; index += 1) {
+		fit.coefficients[index] = coefficients[index].hi + coefficients[index].lo;
+	}
+	
+	return fit;
+}
+
+static f64 eval_fit(Remez_Fit *fit, f64 x) {
+	f64 x2 = x*x;
+	
+	f64 y = fit->coefficients[fit->count - 1];
+	for (u32 index = fit->count - 1; index != 0; index -= 1) {
+		y = fma(y, x2, fit->coefficients[index - 1]);
+	}
+	if (fit->parity == Parity_Odd) y *= x;
+	
+	return y;
+}
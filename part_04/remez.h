@@ -0,0 +1,53 @@
+#ifndef REMEZ_H
+#define REMEZ_H
+
+///////////////////////////
+// Double-double
+
+// NOTE(ema): An unevaluated sum hi + lo, with lo smaller than half an ulp of hi, for about 106 bits
+// of mantissa. long double would only do on some compilers (on MSVC it's just a double), and
+// the Vandermonde systems of the fitter need all the bits they can get.
+struct DD {
+	f64 hi, lo;
+};
+
+static DD dd_from_f64(f64 x);
+static DD add_dd(DD a, DD b);
+static DD sub_dd(DD a, DD b);
+static DD mul_dd(DD a, DD b);
+static DD div_dd(DD a, DD b);
+
+static DD sin_dd(DD x);  // Taylor series, meant for |x| <= PI
+static DD cos_dd(DD x);  // Taylor series, meant for |x| <= PI
+static DD asin_dd(DD x); // Newton's method on sin_dd(), meant for |x| < 1
+
+///////////////////////////
+// Remez exchange
+
+typedef DD DD_Func(DD x);
+
+enum Polynomial_Parity : u32 {
+	Parity_Odd,  // c[0]*x + c[1]*x^3 + c[2]*x^5 + ...
+	Parity_Even, // c[0] + c[1]*x^2 + c[2]*x^4 + ...
+};
+
+#define MAX_REMEZ_COEFFICIENT_COUNT 32
+
+struct Remez_Fit {
+	f64 coefficients[MAX_REMEZ_COEFFICIENT_COUNT]; // Lowest power first, rounded to f64
+	u32 count;
+	Polynomial_Parity parity;
+	f64 min, max;
+	
+	f64 levelled_error;  // Error of the last exchange, before the coefficients were rounded
+	u32 iteration_count;
+	b32 converged;
+};
+
+// Fits the polynomial with `count` coefficients and the given parity that minimizes the max
+// absolute error from func on [min, max]. For odd polynomials min should not be negative, and
+// for even ones the function should be even too.
+static Remez_Fit fit_minimax(DD_Func *func, f64 min, f64 max, u32 count, Polynomial_Parity parity);
+static f64 eval_fit(Remez_Fit *fit, f64 x);
+
+#endif
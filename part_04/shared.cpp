@@ -37,11 +37,101 @@ static void free_buffer(Buffer *buffer) {
 	*buffer = {};
 }
 
+static Buffer map_file(char *name) {
+	Buffer result = {};
+	
+	HANDLE file = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER size = {};
+		if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+			// NOTE(ema): The view keeps the mapping alive, so both handles can go right away.
+			HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+			void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : 0;
+			if (data) {
+				result.data = (u8 *) data;
+				result.len  = size.QuadPart;
+			} else {
+				fprintf(stderr, "Error: Cannot map file \"%s\".\n", name);
+			}
+			
+			if (mapping) CloseHandle(mapping);
+		} else {
+			fprintf(stderr, "Error: Cannot map file \"%s\", it may be empty.\n", name);
+		}
+		
+		CloseHandle(file);
+	} else {
+		fprintf(stderr, "Error: Cannot open file \"%s\".\n", name);
+	}
+	
+	return result;
+}
+
+static void unmap_file(Buffer *buffer) {
+	if (buffer->data) UnmapViewOfFile(buffer->data);
+	*buffer = {};
+}
+
+struct Thread_Start {
+	Thread_Proc *proc;
+	void *param;
+};
+
+static u32 get_processor_count() {
+	SYSTEM_INFO info = {};
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+}
+
+static u32 atomic_add_u32(volatile u32 *value, u32 addend) {
+	u32 result = (u32)InterlockedExchangeAdd((volatile LONG *)value, (LONG)addend);
+	return result;
+}
+
+static u64 atomic_add_u64(volatile u64 *value, u64 addend) {
+	u64 result = (u64)InterlockedExchangeAdd64((volatile LONG64 *)value, (LONG64)addend);
+	return result;
+}
+
+static DWORD WINAPI thread_entry_point(LPVOID param) {
+	Thread_Start *start = (Thread_Start *)param;
+	start->proc(start->param);
+	return 0;
+}
+
+static void run_on_threads(u32 thread_count, Thread_Proc *proc, void *param) {
+	Thread_Start start = {proc, param};
+	
+	HANDLE *threads = (HANDLE *)calloc(thread_count, sizeof(HANDLE));
+	if (threads) {
+		for (u32 thread_index = 1; thread_index < thread_count; thread_index += 1) {
+			threads[thread_index] = CreateThread(0, 0, thread_entry_point, &start, 0, 0);
+		}
+	}
+	
+	// NOTE(ema): The calling thread is one of the workers, so this still does all the work if
+	// no thread could be started.
+	proc(param);
+	
+	if (threads) {
+		for (u32 thread_index = 1; thread_index < thread_count; thread_index += 1) {
+			if (threads[thread_index]) {
+				WaitForSingleObject(threads[thread_index], INFINITE);
+				CloseHandle(threads[thread_index]);
+			}
+		}
+		free(threads);
+	}
+}
+
 #else
 
 #include <x86intrin.h>
 #include <sys/time.h>
 #include <sys/mman.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 static u64 get_os_timer_frequency() {
 	return 1000000;
@@ -63,18 +153,156 @@ static u64 get_file_size(char *name) {
 
 static Buffer alloc_buffer(u64 size) {
 	Buffer result = {};
-	result.data = (u8 *) mmap(0, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
-	result.len  = size;
+	void *data = mmap(0, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if (data != MAP_FAILED) {
+		result.data = (u8 *) data;
+		result.len  = size;
+	}
 	
 	return result;
 }
 
+static void free_buffer(Buffer *buffer) {
+	munmap(buffer->data, buffer->len);
+	*buffer = {};
+}
+
+static Buffer map_file(char *name) {
+	Buffer result = {};
+	
+	int file = open(name, O_RDONLY);
+	if (file >= 0) {
+		struct stat info = {};
+		if (fstat(file, &info) == 0 && info.st_size > 0) {
+			// NOTE(ema): The mapping keeps the file alive, so it can be closed right away.
+			void *data = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+			if (data != MAP_FAILED) {
+				result.data = (u8 *) data;
+				result.len  = info.st_size;
+			} else {
+				fprintf(stderr, "Error: Cannot map file \"%s\".\n", name);
+			}
+		} else {
+			fprintf(stderr, "Error: Cannot map file \"%s\", it may be empty.\n", name);
+		}
+		
+		close(file);
+	} else {
+		fprintf(stderr, "Error: Cannot open file \"%s\".\n", name);
+	}
+	
+	return result;
+}
+
+static void unmap_file(Buffer *buffer) {
+	if (buffer->data) munmap(buffer->data, buffer->len);
+	*buffer = {};
+}
+
+struct Thread_Start {
+	Thread_Proc *proc;
+	void *param;
+};
+
+static u32 get_processor_count() {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count > 0) ? (u32)count : 1;
+}
+
+static u32 atomic_add_u32(volatile u32 *value, u32 addend) {
+	u32 result = __sync_fetch_and_add(value, addend);
+	return result;
+}
+
+static u64 atomic_add_u64(volatile u64 *value, u64 addend) {
+	u64 result = __sync_fetch_and_add(value, addend);
+	return result;
+}
+
+static void *thread_entry_point(void *param) {
+	Thread_Start *start = (Thread_Start *)param;
+	start->proc(start->param);
+	return 0;
+}
+
+static void run_on_threads(u32 thread_count, Thread_Proc *proc, void *param) {
+	Thread_Start start = {proc, param};
+	
+	pthread_t *threads = (pthread_t *)calloc(thread_count, sizeof(pthread_t));
+	b32 *started = (b32 *)calloc(thread_count, sizeof(b32));
+	if (threads && started) {
+		for (u32 thread_index = 1; thread_index < thread_count; thread_index += 1) {
+			started[thread_index] = pthread_create(&threads[thread_index], 0, thread_entry_point, &start) == 0;
+		}
+	}
+	
+	// NOTE(ema): The calling thread is one of the workers, so this still does all the work if
+	// no thread could be started.
+	proc(param);
+	
+	if (threads && started) {
+		for (u32 thread_index = 1; thread_index < thread_count; thread_index += 1) {
+			if (started[thread_index]) {
+				pthread_join(threads[thread_index], 0);
+			}
+		}
+	}
+	
+	free(threads);
+	free(started);
+}
+
 #endif
 
 static u64 read_cpu_timer() {
 	return __rdtsc();
 }
 
+#if _WIN32
+
+static b32 os_saves_registers(u64 mask) {
+	// NOTE(ema): The CPU having the instructions is not enough, the OS must also save the
+	// wide registers on a context switch.
+	int info[4] = {};
+	__cpuid(info, 1);
+	b32 result = ((info[2] >> 27) & 1) && (_xgetbv(0) & mask) == mask;
+	return result;
+}
+
+static b32 cpu_has_avx2() {
+	int info[4] = {};
+	__cpuid(info, 1);
+	b32 fma = (info[2] >> 12) & 1;
+	__cpuidex(info, 7, 0);
+	b32 avx2 = (info[1] >> 5) & 1;
+	
+	b32 result = fma && avx2 && os_saves_registers(0x6);
+	return result;
+}
+
+static b32 cpu_has_avx512() {
+	int info[4] = {};
+	__cpuidex(info, 7, 0);
+	b32 avx512f = (info[1] >> 16) & 1;
+	
+	b32 result = avx512f && os_saves_registers(0xe6);
+	return result;
+}
+
+#else
+
+static b32 cpu_has_avx2() {
+	b32 result = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	return result;
+}
+
+static b32 cpu_has_avx512() {
+	b32 result = __builtin_cpu_supports("avx512f");
+	return result;
+}
+
+#endif
+
 static u64 estimate_cpu_timer_frequency(u64 milliseconds_to_wait) {
 	u64 os_freq = get_os_timer_frequency();
 	
@@ -101,3 +329,28 @@ static u64 estimate_cpu_timer_frequency(u64 milliseconds_to_wait) {
 static bool is_valid(Buffer buffer) {
 	return buffer.data != 0 || buffer.len == 0;
 }
+
+static Buffer read_entire_file(char *name) {
+	Buffer result = {};
+	
+	u64 file_size = get_file_size(name);
+	FILE *file = fopen(name, "rb");
+	if (file) {
+		result = alloc_buffer(file_size);
+		if (result.data) {
+			if (fread(result.data, 1, result.len, file) != result.len) {
+				fprintf(stderr, "Error: Cannot read file \"%s\".\n", name);
+				free_buffer(&result);
+			}
+		} else {
+			fprintf(stderr, "Error: Out of memory.\n");
+			result = {};
+		}
+		
+		fclose(file);
+	} else {
+		fprintf(stderr, "Error: Cannot open file \"%s\".\n", name);
+	}
+	
+	return result;
+}
@@ -33,6 +33,12 @@ typedef      u32 b32;
 
 #define array_count(a) (sizeof(a)/sizeof((a)[0]))
 
+#if _MSC_VER
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE __attribute__((noinline))
+#endif
+
 struct Buffer {
 	u64 len;
 	u8 *data;
@@ -43,6 +49,12 @@ static void free_buffer(Buffer *buffer);
 static bool is_valid(Buffer buffer);
 
 static u64 get_file_size(char *name);
+static Buffer read_entire_file(char *name); // Returns an empty buffer and prints the reason if it fails
+
+// Maps the file read-only instead of copying it. Returns an empty buffer and prints the reason if it
+// fails, which includes the file being empty (there would be nothing to map).
+static Buffer map_file(char *name);
+static void unmap_file(Buffer *buffer);
 
 ///////////////////////////
 // Platform info
@@ -52,4 +64,19 @@ static u64 read_os_timer();
 static u64 read_cpu_timer();
 static u64 estimate_cpu_timer_frequency(u64 milliseconds_to_wait = 100);
 
+static b32 cpu_has_avx2();   // Includes FMA
+static b32 cpu_has_avx512(); // Foundation only
+
+///////////////////////////
+// Threads
+
+typedef void Thread_Proc(void *param);
+
+static u32  get_processor_count();
+static u32  atomic_add_u32(volatile u32 *value, u32 addend); // Returns the value before the add
+static u64  atomic_add_u64(volatile u64 *value, u64 addend); // Returns the value before the add
+
+// Calls proc(param) on thread_count threads, the calling one included, and waits for all of them.
+static void run_on_threads(u32 thread_count, Thread_Proc *proc, void *param);
+
 #endif